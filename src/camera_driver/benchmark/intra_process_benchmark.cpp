@@ -0,0 +1,143 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-17 15:06:41
+ * @LastEditTime: 2023-06-17 15:06:41
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/benchmark/intra_process_benchmark.cpp
+ */
+#include "../include/fake_driver/fake_cam_node.hpp"
+
+//c++
+#include <algorithm>
+#include <numeric>
+
+/**
+ * @brief 图像传输延迟基准测试
+ * 虚拟相机与若干订阅者放在同一进程中，分别在关闭/开启进程内通信时测量图像从发布到订阅回调的延迟。
+ * 关闭硬件时间戳后图像时间戳即为发布前的时刻，延迟只包含传输部分；
+ * 另统计相机节点从取帧到发布完成的耗时，包含驱动写入图像缓冲区(缓冲区未能复用时的申请及缺页)的开销。
+ * 用法: intra_process_benchmark [frame_num=1000] [sub_num=2] [fps=200] [push_mode=1]
+ */
+namespace camera_driver
+{
+    class LatencySubscriber : public rclcpp::Node
+    {
+    public:
+        LatencySubscriber(const std::string& node_name, const std::string& topic, int frame_num, const rclcpp::NodeOptions& options)
+        : Node(node_name, options), frame_num_(frame_num)
+        {
+            latency_ms_.reserve(frame_num);
+            image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(
+                topic,
+                rclcpp::QoS(1),
+                [this](sensor_msgs::msg::Image::ConstSharedPtr msg)
+                {
+                    if (isDone())
+                        return;
+                    rclcpp::Time stamp = msg->header.stamp;
+                    latency_ms_.emplace_back((this->get_clock()->now() - stamp).nanoseconds() / 1e6);
+                }
+            );
+        }
+
+        bool isDone() const
+        {
+            return (int)latency_ms_.size() >= frame_num_;
+        }
+
+        std::vector<double> latency_ms_;
+
+    private:
+        int frame_num_;
+        rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr image_sub_;
+    };
+
+    void runBenchmark(bool use_intra_process, int frame_num, int sub_num, int fps, bool use_push_mode)
+    {
+        rclcpp::NodeOptions cam_options;
+        cam_options.use_intra_process_comms(use_intra_process);
+        cam_options.parameter_overrides({
+            {"camera_topic", "benchmark_img"},
+            {"image_width", 1280},
+            {"image_height", 1024},
+            {"fps", fps},
+            {"use_port", false},
+            {"use_push_mode", use_push_mode},
+            {"use_hw_timestamp", false},
+            {"publish_raw_bayer", false},
+            {"use_hw_roi", false},
+            {"print_latency", false},
+            {"debug", false}
+        });
+        auto cam_node = std::make_shared<FakeCamNode>(cam_options);
+
+        rclcpp::NodeOptions sub_options;
+        sub_options.use_intra_process_comms(use_intra_process);
+        rclcpp::executors::SingleThreadedExecutor executor;
+        executor.add_node(cam_node);
+        std::vector<std::shared_ptr<LatencySubscriber>> sub_nodes;
+        for (int ii = 0; ii < sub_num; ++ii)
+        {
+            sub_nodes.emplace_back(std::make_shared<LatencySubscriber>(
+                "latency_subscriber_" + std::to_string(ii),
+                "benchmark_img",
+                frame_num,
+                sub_options
+            ));
+            executor.add_node(sub_nodes.back());
+        }
+
+        // 超时按2倍帧数的采集时间计算
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2000 * frame_num / fps + 2000);
+        while (rclcpp::ok() && std::chrono::steady_clock::now() < deadline)
+        {
+            executor.spin_some(std::chrono::milliseconds(10));
+            if (std::all_of(sub_nodes.begin(), sub_nodes.end(), [](const auto& sub) { return sub->isDone(); }))
+                break;
+        }
+
+        std::vector<double> latency_ms;
+        for (const auto& sub : sub_nodes)
+            latency_ms.insert(latency_ms.end(), sub->latency_ms_.begin(), sub->latency_ms_.end());
+        if (latency_ms.empty())
+        {
+            RCLCPP_ERROR(rclcpp::get_logger("benchmark"), "[%s] No frame received!", use_intra_process ? "intra" : "inter");
+            return;
+        }
+
+        std::sort(latency_ms.begin(), latency_ms.end());
+        double mean = std::accumulate(latency_ms.begin(), latency_ms.end(), 0.0) / latency_ms.size();
+        uint64_t published_cnt = std::max<uint64_t>(1, cam_node->published_cnt_.load());
+        RCLCPP_INFO(
+            rclcpp::get_logger("benchmark"),
+            "[%s|%s] subscribers: %d frames: %lu latency(ms) mean: %.3f p50: %.3f p99: %.3f max: %.3f "
+            "acquire->publish(ms) mean: %.3f max: %.3f pooled buffers: %lu",
+            use_intra_process ? "intra" : "inter",
+            use_push_mode ? "push" : "poll",
+            sub_num,
+            latency_ms.size(),
+            mean,
+            latency_ms[latency_ms.size() / 2],
+            latency_ms[std::min(latency_ms.size() - 1, latency_ms.size() * 99 / 100)],
+            latency_ms.back(),
+            cam_node->publish_delay_sum_ns_.load() / 1e6 / published_cnt,
+            cam_node->publish_delay_max_ns_.load() / 1e6,
+            imageBufferPool().size()
+        );
+    }
+} //namespace camera_driver
+
+int main(int argc, char** argv)
+{
+    rclcpp::init(argc, argv);
+    int frame_num = argc > 1 ? std::max(1, atoi(argv[1])) : 1000;
+    int sub_num = argc > 2 ? std::max(1, atoi(argv[2])) : 2;
+    int fps = argc > 3 ? std::max(1, atoi(argv[3])) : 200;
+    bool use_push_mode = argc > 4 ? atoi(argv[4]) != 0 : true;
+
+    camera_driver::runBenchmark(false, frame_num, sub_num, fps, use_push_mode);
+    camera_driver::runBenchmark(true, frame_num, sub_num, fps, use_push_mode);
+    rclcpp::shutdown();
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-13 20:16:45
+ * @LastEditTime: 2023-06-13 20:16:45
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/camera_driver/bag_recorder.hpp
+ */
+#ifndef BAG_RECORDER_HPP_
+#define BAG_RECORDER_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp/serialization.hpp>
+#include <rclcpp/serialized_message.hpp>
+#include <rosbag2_cpp/writer_interfaces/base_writer_interface.hpp>
+#include <rosbag2_storage/serialized_bag_message.hpp>
+
+//c++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+//linux
+#include <semaphore.h>
+
+namespace camera_driver
+{
+    /**
+     * @brief 异步录包器
+     * 生产者(采集线程、串口回调)只把消息的共享指针放入预分配的槽位，序列化与写盘均在独立的写线程中完成；
+     * 槽位均被占用时覆盖最旧的未写入消息(drop-oldest)，生产者无锁且永不阻塞。
+     * 槽位状态以CAS切换，支持多生产者、单消费者；写线程阻塞在信号量上，由生产者提交后唤醒。
+     */
+    class BagRecorder
+    {
+    public:
+        BagRecorder(int slot_num = 16);
+        ~BagRecorder();
+
+        /**
+         * @brief 打开bag并启动写线程
+         *
+         * @param uri bag路径
+         * @param compression_format 压缩格式(如"zstd")，为空时不压缩
+         * @return 是否成功
+         */
+        bool open(const std::string& uri, const std::string& compression_format = "");
+        void close();
+        bool isOpen() const;
+
+        void createTopic(const std::string& topic_name, const std::string& topic_type);
+
+        /**
+         * @brief 将消息入队，由写线程序列化并写盘
+         * 槽位持有msg直至写盘完成，调用方不得再修改其内容
+         *
+         * @param topic_name 话题名
+         * @param msg 消息
+         * @param time_stamp 写入bag的时间戳(ns)
+         * @return 是否取到槽位
+         */
+        template<class MsgT>
+        bool push(const std::string& topic_name, std::shared_ptr<MsgT> msg, int64_t time_stamp)
+        {
+            // 登记后再检查is_open_，close()据此等待进行中的push结束
+            producer_num_.fetch_add(1);
+            if (!is_open_.load())
+            {
+                producer_num_.fetch_sub(1);
+                return false;
+            }
+
+            RecordSlot* slot = acquireSlot();
+            if (slot == nullptr)
+            {   //所有槽位都在写入中，丢弃当前消息
+                ++dropped_;
+                producer_num_.fetch_sub(1);
+                return false;
+            }
+
+            slot->msg = std::move(msg);
+            slot->serialize = &serializeMsg<typename std::remove_const<MsgT>::type>;
+            slot->topic_name = topic_name;
+            slot->time_stamp = time_stamp;
+            slot->seq.store(next_seq_.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            slot->state.store(SLOT_READY, std::memory_order_release);
+            ++pushed_;
+            sem_post(&ready_sem_);
+            producer_num_.fetch_sub(1);
+            return true;
+        }
+
+        /**
+         * @brief 拷贝一份消息后入队，用于串口、相机参数等小消息
+         */
+        template<class MsgT>
+        bool push(const std::string& topic_name, const MsgT& msg, int64_t time_stamp)
+        {
+            if (!is_open_)
+                return false;
+            return push(topic_name, std::make_shared<MsgT>(msg), time_stamp);
+        }
+
+        uint64_t pushed() const { return pushed_.load(std::memory_order_relaxed); }
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+        uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    private:
+        enum SlotState
+        {
+            SLOT_FREE,
+            SLOT_WRITING,   //生产者写入中
+            SLOT_READY,     //等待写盘
+            SLOT_READING    //写线程写盘中
+        };
+
+        using SerializeFunc = void (*)(const void*, rclcpp::SerializedMessage&);
+
+        struct RecordSlot
+        {
+            std::atomic<int> state{SLOT_FREE};
+            std::atomic<uint64_t> seq{0};
+            std::string topic_name;
+            int64_t time_stamp = 0;
+            std::shared_ptr<const void> msg;
+            SerializeFunc serialize = nullptr;
+        };
+
+        template<class MsgT>
+        static void serializeMsg(const void* msg, rclcpp::SerializedMessage& serialized_msg)
+        {
+            static rclcpp::Serialization<MsgT> serializer;
+            serializer.serialize_message(static_cast<const MsgT*>(msg), &serialized_msg);
+        }
+
+        RecordSlot* acquireSlot();
+        RecordSlot* takeOldest();
+        void writeSlot(RecordSlot* slot);
+        void writerThread();
+
+    private:
+        int slot_num_;
+        std::unique_ptr<RecordSlot[]> slots_;
+        std::atomic<uint64_t> next_seq_;
+
+        std::unique_ptr<rosbag2_cpp::writer_interfaces::BaseWriterInterface> writer_;
+        rclcpp::SerializedMessage serialized_msg_;  //写线程复用的序列化缓冲
+        std::thread writer_thread_;
+        std::atomic<bool> is_open_;
+        std::atomic<bool> is_running_;              //置false后写线程写完剩余消息退出
+        std::atomic<int> producer_num_;             //正在push中的生产者数
+        sem_t ready_sem_;                           //生产者每提交一条消息post一次
+
+        std::atomic<uint64_t> pushed_;
+        std::atomic<uint64_t> dropped_;
+        std::atomic<uint64_t> written_;
+        rclcpp::Logger logger_;
+    };
+} //namespace camera_driver
+
+#endif
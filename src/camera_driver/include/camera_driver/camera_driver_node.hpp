@@ -11,16 +11,15 @@
 //ros
 #include <rclcpp/rclcpp.hpp>
 #include <image_transport/image_transport.hpp>
+#include <image_transport/camera_common.hpp>
 #include <cv_bridge/cv_bridge.h>
 #include <sensor_msgs/image_encodings.hpp>
 #include <sensor_msgs/msg/camera_info.hpp>
 #include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/msg/region_of_interest.hpp>
 #include <camera_info_manager/camera_info_manager.hpp>
 #include <rcl_interfaces/msg/set_parameters_result.hpp>
 #include <ament_index_cpp/get_package_share_directory.hpp>
-#include <rosbag2_cpp/writer.hpp>
-#include <rosbag2_cpp/writers/sequential_writer.hpp>
-#include <rosbag2_storage/serialized_bag_message.hpp>
 
 //opencv
 #include <opencv2/opencv.hpp>
@@ -31,11 +30,18 @@
 #include <thread>
 #include <memory>
 #include <iterator>
+#include <chrono>
 
+#include "./frame_queue.hpp"
+#include "./image_allocator.hpp"
+#include "./clock_sync.hpp"
+#include "./bag_recorder.hpp"
 #include "../usb_driver/usb_cam.hpp"
 #include "../hik_driver/hik_camera.hpp"
 #include "../daheng_driver/daheng_camera.hpp"
 #include "../mvs_driver/mvs_camera.hpp"
+#include "../fake_driver/fake_camera.hpp"
+#include "../replay_driver/replay_camera.hpp"
 #include "../../global_user/include/global_user/global_user.hpp"
 #include "global_interface/msg/decision.hpp"
 #include "global_interface/msg/serial.hpp"
@@ -86,8 +92,21 @@ namespace camera_driver
         std::map<std::string, int> param_map_;
         OnSetParametersCallbackHandle::SharedPtr callback_handle_;
         rclcpp::Publisher<sensor_msgs::msg::Image>::SharedPtr image_msg_pub_;
-        image_transport::CameraPublisher camera_pub2buff_node_;
-        image_transport::CameraPublisher camera_pub2armor_node_;
+        // 所有模式共用一路图像流，由各检测节点按模式自行取用
+        image_transport::CameraPublisher camera_pub_;
+
+        // 进程内通信时以unique_ptr发布，同一容器内的订阅者共享同一块图像内存，
+        // 消息析构时图像缓冲区经ImageAllocator归还缓冲池，发布后取回供下一帧写入
+        bool use_intra_process_;
+        rclcpp::Publisher<sensor_msgs::msg::Image, ImageAllocator<>>::SharedPtr image_pub_;
+        rclcpp::Publisher<sensor_msgs::msg::CameraInfo>::SharedPtr info_pub_;
+        void publishFrame(bool has_hw_timestamp, int64_t callback_ns);
+        // 取帧(进入SDK回调或轮询取到图像)至发布完成的耗时统计，包含驱动写入图像缓冲区的时间
+        atomic<uint64_t> published_cnt_{0};
+        atomic<int64_t> publish_delay_sum_ns_{0};
+        atomic<int64_t> publish_delay_max_ns_{0};
+        void recordFrame(const rclcpp::Time& stamp);
+        void showFrame();
 
         sensor_msgs::msg::CameraInfo camera_info_msg_;
         sensor_msgs::msg::Image image_msg_;
@@ -95,18 +114,62 @@ namespace camera_driver
         string camera_topic_;
         cv::Mat frame_;
         atomic<bool> is_cam_open_;
+        atomic<bool> is_running_;
+
+        // 推流模式(SDK回调线程经无锁队列将图像交给发布线程)
+        bool use_push_mode_;
+        bool print_latency_;
+        FrameQueue frame_queue_;
+        int64_t last_frame_ns_;
+        bool takeFrame(uint64_t& device_timestamp, int64_t& callback_ns);
+
+        // 硬件时间戳同步，图像时间戳取曝光中点
+        bool use_hw_timestamp_;
+        bool hw_timestamp_at_exposure_end_;
+        atomic<int> exposure_time_;
+        ClockSync clock_sync_;
+        int64_t exposure_mid_ns_;
+        virtual rclcpp::Time stampFrame(uint64_t device_timestamp, int64_t host_timestamp_ns, bool has_hw_timestamp);
+
+        // 发布原始Bayer图像(bayer_bggr8)，去马赛克推迟到检测节点
+        bool publish_raw_bayer_;
+
+        // 相机硬件ROI，由装甲板检测节点反馈
+        static constexpr int HW_ROI_ALIGN = 32;
+        static constexpr int64_t ROI_REQUEST_TIMEOUT_NS = 200000000;
+        bool use_hw_roi_;
+        mutex roi_mutex_;
+        cv::Rect roi_request_;
+        // 采集线程每帧只读取以下原子量，有新请求或请求超时时才加锁
+        atomic<int64_t> roi_request_ns_;
+        atomic<bool> roi_request_updated_;
+        bool is_roi_expired_;
+        cv::Rect hw_roi_;
+        cv::Point2i frame_offset_;
+        rclcpp::Subscription<sensor_msgs::msg::RegionOfInterest>::SharedPtr roi_request_sub_;
+        void roiRequestCallback(sensor_msgs::msg::RegionOfInterest::SharedPtr msg);
+        void updateHwRoi();
 
         // 图像保存
         bool save_video_;
         bool show_img_;
         bool using_ros2bag_;
         int frame_cnt_;
-        std::unique_ptr<rosbag2_cpp::writers::SequentialWriter> writer_;
+        int record_interval_;
+        uint64_t last_record_dropped_;
+        std::unique_ptr<BagRecorder> recorder_;
+        // 进程内通信时图像缓冲区在发布时移交，录包器以ConstSharedPtr订阅自身发布的图像，与检测节点共享同一块内存；
+        // 采集线程只登记待录制帧的时间戳
+        SpscQueue<int64_t, 16> record_stamps_;
+        int64_t pending_record_ns_;
+        rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr record_image_sub_;
+        void recordImageCallback(sensor_msgs::msg::Image::ConstSharedPtr msg);
 
         void serialMsgCallback(SerialMsg::SharedPtr msg);
         rclcpp::Subscription<SerialMsg>::SharedPtr serial_msg_sub_; 
         SerialMsg serial_msg_;
         mutex serial_mutex_;
+        atomic<int> serial_mode_;
         bool use_serial_;
     };
 
@@ -154,28 +217,66 @@ namespace camera_driver
             string save_path = this->declare_parameter("save_path", "/recorder/video/gyro_video.webm");
             std::string path = pkg_path + save_path + now_string;
 
-            writer_ = std::make_unique<rosbag2_cpp::writers::SequentialWriter>();
-            rosbag2_storage::StorageOptions storage_options({path, "sqlite3"});
-            rosbag2_cpp::ConverterOptions converter_options({
-                rmw_get_serialization_format(),
-                rmw_get_serialization_format()
-            });
-            writer_->open(storage_options, converter_options);
-            writer_->create_topic({
-                camera_topic_,
-                "sensor_msgs::msg::Image",
-                rmw_get_serialization_format(),
-                ""
-            });
+            // 录包在独立写线程中完成，采集线程只做入队
+            int record_queue_size = this->declare_parameter<int>("record_queue_size", 16);
+            string record_compression = this->declare_parameter<string>("record_compression", "");
+            record_interval_ = std::max(1, (int)this->declare_parameter<int>("record_interval", 25));
+            frame_cnt_ = 0;
+            last_record_dropped_ = 0;
+            pending_record_ns_ = -1;
+            recorder_ = std::make_unique<BagRecorder>(record_queue_size);
+            if (recorder_->open(path, record_compression))
+            {
+                recorder_->createTopic(camera_topic_, "sensor_msgs/msg/Image");
+                recorder_->createTopic(image_transport::getCameraInfoTopic(camera_topic_), "sensor_msgs/msg/CameraInfo");
+                recorder_->createTopic("/serial_msg", "global_interface/msg/Serial");
+            }
+            else
+            {
+                RCLCPP_ERROR(this->get_logger(), "Open recorder failed, disable saving video...");
+                recorder_.reset();
+                save_video_ = false;
+            }
         }
         else
             RCLCPP_WARN_ONCE(this->get_logger(), "No save video...");
 
         // Create img publisher.
-        string camera_pub2armor_topic = camera_topic_ + "_armor_node";
-        string camera_pub2buff_topic = camera_topic_ + "_buff_node";
-        this->camera_pub2armor_node_ = image_transport::create_camera_publisher(this, camera_pub2armor_topic, rmw_qos);
-        this->camera_pub2buff_node_ = image_transport::create_camera_publisher(this, camera_pub2buff_topic, rmw_qos);
+        use_intra_process_ = options.use_intra_process_comms();
+        if (use_intra_process_)
+        {   // 话题名与image_transport的raw传输一致，订阅端无需改动
+            rclcpp::QoS image_qos(rclcpp::QoSInitialization::from_rmw(rmw_qos), rmw_qos);
+            rclcpp::PublisherOptionsWithAllocator<ImageAllocator<>> image_options;
+            image_options.allocator = std::make_shared<ImageAllocator<>>();
+            this->image_pub_ = this->create_publisher<sensor_msgs::msg::Image, ImageAllocator<>>(camera_topic_, image_qos, image_options);
+            this->info_pub_ = this->create_publisher<sensor_msgs::msg::CameraInfo>(image_transport::getCameraInfoTopic(camera_topic_), image_qos);
+            if (save_video_)
+            {
+                record_image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(camera_topic_, image_qos,
+                    std::bind(&CameraBaseNode<T>::recordImageCallback, this, std::placeholders::_1));
+            }
+        }
+        else
+        {
+            this->camera_pub_ = image_transport::create_camera_publisher(this, camera_topic_, rmw_qos);
+        }
+        RCLCPP_WARN(this->get_logger(), "Intra process publish: %s", use_intra_process_ ? "on" : "off");
+
+        // Push mode.
+        last_frame_ns_ = FrameQueue::steadyNowNs();
+        if (use_push_mode_ && !cam_driver_->setFrameQueue(&frame_queue_))
+        {
+            RCLCPP_WARN(this->get_logger(), "Push mode is not supported by this camera, fall back to polling...");
+            use_push_mode_ = false;
+        }
+        RCLCPP_WARN(this->get_logger(), "Acquisition mode: %s", use_push_mode_ ? "push" : "poll");
+
+        // Raw bayer transport.
+        if (publish_raw_bayer_ && !cam_driver_->setRawBayer(true))
+        {
+            RCLCPP_WARN(this->get_logger(), "Raw bayer output is not supported by this camera, fall back to bgr8...");
+            publish_raw_bayer_ = false;
+        }
 
         // Open camera.
         if(!cam_driver_->open())
@@ -188,8 +289,27 @@ namespace camera_driver
             is_cam_open_ = true;
         }
 
+        // Hardware roi.
+        roi_request_ns_ = 0;
+        roi_request_updated_ = false;
+        is_roi_expired_ = false;
+        frame_offset_ = cv::Point2i(0, 0);
+        if (use_hw_roi_ && !cam_driver_->setRoi(cv::Rect()))
+        {
+            RCLCPP_WARN(this->get_logger(), "Hardware roi is not supported by this camera...");
+            use_hw_roi_ = false;
+        }
+        if (use_hw_roi_)
+        {
+            roi_request_sub_ = this->create_subscription<sensor_msgs::msg::RegionOfInterest>(
+                "/armor_detector/roi_request",
+                qos,
+                std::bind(&CameraBaseNode::roiRequestCallback, this, _1)
+            );
+        }
+
         image_msg_.header.frame_id = camera_topic_;
-        image_msg_.encoding = "bgr8";
+        image_msg_.encoding = publish_raw_bayer_ ? sensor_msgs::image_encodings::BAYER_BGGR8 : sensor_msgs::image_encodings::BGR8;
         camera_watcher_timer_ = rclcpp::create_timer(
             this, 
             this->get_clock(), 
@@ -197,6 +317,7 @@ namespace camera_driver
             std::bind(&CameraBaseNode::cameraWatcher, this)
         );
 
+        is_running_ = true;
         img_callback_thread_ = std::thread(
             std::bind(&CameraBaseNode::imageCallback, this)
         );
@@ -204,6 +325,7 @@ namespace camera_driver
         this->declare_parameter("use_port", false);
         use_serial_ = this->get_parameter("use_port").as_bool();
         serial_msg_.mode = AUTOAIM_NORMAL;
+        serial_mode_ = AUTOAIM_NORMAL;
         if (use_serial_)
         {
             //串口消息订阅
@@ -218,6 +340,9 @@ namespace camera_driver
     template<class T>
     CameraBaseNode<T>::~CameraBaseNode()
     {
+        is_running_ = false;
+        if (img_callback_thread_.joinable())
+            img_callback_thread_.join();
     }
     
     template<class T>
@@ -226,6 +351,12 @@ namespace camera_driver
         serial_mutex_.lock();
         serial_msg_ = *msg;
         serial_mutex_.unlock();
+        serial_mode_ = msg->mode;
+
+        if (save_video_)
+        {   // 同时录制串口消息，供离线回放使用
+            recorder_->push("/serial_msg", msg, this->get_clock()->now().nanoseconds());
+        }
     }
 
     template<class T>
@@ -246,81 +377,360 @@ namespace camera_driver
                 RCLCPP_INFO(this->get_logger(), "Open Success!");
                 is_cam_open_ = true;
             }
+            // 重连后相机恢复为全幅采集，下一帧按最新请求重新设置
+            hw_roi_ = cv::Rect();
             cam_mutex_.unlock();
+            roi_request_updated_ = true;
+        }
+    }
+
+    template<class T>
+    void CameraBaseNode<T>::roiRequestCallback(sensor_msgs::msg::RegionOfInterest::SharedPtr msg)
+    {
+        roi_mutex_.lock();
+        roi_request_ = cv::Rect(msg->x_offset, msg->y_offset, msg->width, msg->height);
+        roi_mutex_.unlock();
+        roi_request_ns_ = FrameQueue::steadyNowNs();
+        roi_request_updated_ = true;
+    }
+
+    /**
+     * @brief 根据检测节点反馈的ROI更新相机硬件ROI
+     * ROI向外按HW_ROI_ALIGN像素对齐，满足相机步长并为目标运动留出余量；
+     * 非自瞄模式或超过ROI_REQUEST_TIMEOUT_NS未收到反馈时恢复全幅；
+     * 每帧调用一次，无新请求且请求未超时(或超时已处理)时只读取原子量后返回，不加锁也不访问相机
+     */
+    template<class T>
+    void CameraBaseNode<T>::updateHwRoi()
+    {
+        bool is_updated = roi_request_updated_.exchange(false);
+        bool is_alive = (FrameQueue::steadyNowNs() - roi_request_ns_) < ROI_REQUEST_TIMEOUT_NS;
+        if (!is_updated && (is_alive || is_roi_expired_))
+            return;
+        is_roi_expired_ = !is_alive;
+
+        int mode = serial_mode_;
+        bool is_autoaim = (mode == AUTOAIM_TRACKING || mode == AUTOAIM_NORMAL ||
+            mode == AUTOAIM_SLING || mode == OUTPOST_ROTATION_MODE || mode == SENTRY_NORMAL);
+
+        cv::Rect target;
+        if (is_autoaim && is_alive)
+        {
+            roi_mutex_.lock();
+            target = roi_request_;
+            roi_mutex_.unlock();
         }
+
+        cv::Size full_size = cam_driver_->getSensorSize();
+        if (target.area() > 0)
+        {
+            int x0 = (target.x / HW_ROI_ALIGN) * HW_ROI_ALIGN;
+            int y0 = (target.y / HW_ROI_ALIGN) * HW_ROI_ALIGN;
+            int x1 = std::min((target.x + target.width + HW_ROI_ALIGN - 1) / HW_ROI_ALIGN * HW_ROI_ALIGN, full_size.width);
+            int y1 = std::min((target.y + target.height + HW_ROI_ALIGN - 1) / HW_ROI_ALIGN * HW_ROI_ALIGN, full_size.height);
+            target = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+            if (target.width <= 0 || target.height <= 0 || target.size() == full_size)
+                target = cv::Rect();
+        }
+
+        cam_mutex_.lock();
+        if (target != hw_roi_)
+        {
+            if (cam_driver_->setRoi(target))
+            {
+                hw_roi_ = target;
+            }
+            else
+            {   // 下一帧重试
+                RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 1000, "Set hardware roi failed!");
+                roi_request_updated_ = true;
+            }
+        }
+        cam_mutex_.unlock();
+    }
+
+    /**
+     * @brief 推流模式下从帧队列取出最新一帧
+     * 与消息交换缓冲区，消息直接接管SDK线程写好的图像，原消息缓冲归还队列复用，全程无锁无拷贝
+     * 
+     * @param device_timestamp 该帧的相机硬件时间戳
+     * @param callback_ns 该帧进入SDK回调时的主机steady时间
+     * @return 是否取到新帧
+     */
+    template<class T>
+    bool CameraBaseNode<T>::takeFrame(uint64_t& device_timestamp, int64_t& callback_ns)
+    {
+        CameraFrame* frame = frame_queue_.take();
+        if (frame == nullptr)
+        {
+            int64_t now_ns = FrameQueue::steadyNowNs();
+            if (is_cam_open_ && (now_ns - last_frame_ns_) > 1e9)
+            {   // 超过1s未收到回调视为相机掉线，交由cameraWatcher重连
+                RCLCPP_ERROR(this->get_logger(), "No frame pushed from camera in 1s!");
+                is_cam_open_ = false;
+                last_frame_ns_ = now_ns;
+            }
+            return false;
+        }
+
+        image_msg_.data.swap(frame->data);
+        frame_ = cv::Mat(frame->height, frame->width, CV_8UC(frame->channels), image_msg_.data.data());
+        image_msg_.step = static_cast<sensor_msgs::msg::Image::_step_type>(frame_.step);
+        image_msg_.is_bigendian = false;
+        device_timestamp = frame->device_timestamp;
+        callback_ns = frame->host_timestamp_ns;
+        frame_offset_ = cv::Point2i(frame->offset_x, frame->offset_y);
+        frame_queue_.release(frame);
+
+        last_frame_ns_ = FrameQueue::steadyNowNs();
+        return true;
+    }
+
+    /**
+     * @brief 计算图像时间戳
+     * 硬件时间戳经时钟同步换算到主机steady时间后修正到曝光中点，再按当前时刻的时钟差换算为ROS时间；
+     * 不支持硬件时间戳或同步尚未收敛时退化为当前时刻
+     * 
+     * @param device_timestamp 相机硬件时间戳(tick)
+     * @param host_timestamp_ns 主机收到该帧的steady时间(ns)
+     * @param has_hw_timestamp 是否有有效的硬件时间戳
+     * @return rclcpp::Time 
+     */
+    template<class T>
+    rclcpp::Time CameraBaseNode<T>::stampFrame(uint64_t device_timestamp, int64_t host_timestamp_ns, bool has_hw_timestamp)
+    {
+        rclcpp::Time now = this->get_clock()->now();
+        exposure_mid_ns_ = 0;
+        if (!use_hw_timestamp_ || !has_hw_timestamp)
+            return now;
+
+        clock_sync_.setTickFrequency(cam_driver_->getTimestampFrequency());
+        int64_t frame_ns = clock_sync_.update(device_timestamp, host_timestamp_ns);
+        if (!clock_sync_.isConverged())
+            return now;
+
+        // 硬件时间戳默认锁存于曝光开始时刻
+        int64_t half_exposure_ns = (int64_t)exposure_time_ * 500;
+        exposure_mid_ns_ = hw_timestamp_at_exposure_end_ ? (frame_ns - half_exposure_ns) : (frame_ns + half_exposure_ns);
+        int64_t age_ns = FrameQueue::steadyNowNs() - exposure_mid_ns_;
+        return now - rclcpp::Duration::from_nanoseconds(age_ns);
     }
 
     template<class T>
     void CameraBaseNode<T>::imageCallback()
     {
-        while (1)
+        uint64_t device_timestamp = 0;
+        int64_t callback_ns = 0;
+        bool has_hw_timestamp = false;
+        while (is_running_)
         {
-            cam_mutex_.lock();
-            is_cam_open_ = cam_driver_->getImage(frame_, image_msg_);
-            cam_mutex_.unlock();
-            if (!is_cam_open_)
+            if (use_push_mode_)
             {
-                RCLCPP_ERROR(this->get_logger(), "Get frame failed!");
-                sleep(1);
-                continue;
+                if (!takeFrame(device_timestamp, callback_ns))
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    continue;
+                }
+                has_hw_timestamp = (device_timestamp > 0);
+            }
+            else
+            {
+                cam_mutex_.lock();
+                is_cam_open_ = cam_driver_->getImage(frame_, image_msg_);
+                has_hw_timestamp = cam_driver_->getFrameTimestamp(device_timestamp, callback_ns);
+                cam_driver_->getFrameOffset(frame_offset_);
+                cam_mutex_.unlock();
+                if (!is_cam_open_)
+                {
+                    RCLCPP_ERROR(this->get_logger(), "Get frame failed!");
+                    sleep(1);
+                    continue;
+                }
+            }
+
+            if (use_hw_roi_)
+            {   // 仅在取到新帧后检查ROI请求，空转等待时不访问相机
+                updateHwRoi();
             }
 
-            rclcpp::Time now = this->get_clock()->now();
+            rclcpp::Time now = stampFrame(device_timestamp, callback_ns, has_hw_timestamp);
             image_msg_.header.stamp = now;
+            // 硬件ROI仅经camera_info传递：width/height为全幅尺寸，roi全零表示全幅
+            cv::Size full_size = cam_driver_->getSensorSize();
+            bool is_full_frame = (frame_offset_ == cv::Point2i(0, 0) && frame_.size() == full_size);
+            camera_info_msg_.width = full_size.width;
+            camera_info_msg_.height = full_size.height;
+            camera_info_msg_.roi.x_offset = is_full_frame ? 0 : frame_offset_.x;
+            camera_info_msg_.roi.y_offset = is_full_frame ? 0 : frame_offset_.y;
+            camera_info_msg_.roi.width = is_full_frame ? 0 : frame_.size().width;
+            camera_info_msg_.roi.height = is_full_frame ? 0 : frame_.size().height;
             camera_info_msg_.header = image_msg_.header;
             image_msg_.width = frame_.size().width;
             image_msg_.height = frame_.size().height;
+            if (publish_raw_bayer_ && frame_.channels() != 1)
+            {   // 驱动在open()时按相机支持的像素格式协商，协商失败则输出BGR8
+                RCLCPP_WARN(this->get_logger(), "Camera delivers bgr8 frames, raw bayer output is off...");
+                publish_raw_bayer_ = false;
+                image_msg_.encoding = sensor_msgs::image_encodings::BGR8;
+            }
 
-            serial_mutex_.lock();
-            int mode = serial_msg_.mode;
-            serial_mutex_.unlock();
-
-            if (mode == AUTOAIM_TRACKING || mode == AUTOAIM_NORMAL ||
-                mode == AUTOAIM_SLING || mode == OUTPOST_ROTATION_MODE ||
-                mode == SENTRY_NORMAL
-            )
-            {
-                camera_pub2armor_node_.publish(image_msg_, camera_info_msg_);
+            if (use_intra_process_)
+            {   // 发布后图像缓冲区归订阅者所有，显示需在发布前完成；待录制帧须在发布前登记
+                recordFrame(now);
+                showFrame();
+                publishFrame(has_hw_timestamp, callback_ns);
             }
-            else if (mode == SMALL_BUFF || mode == BIG_BUFF)
+            else
+            {   // 录制帧的图像缓冲区移交给录包器，最后进行
+                publishFrame(has_hw_timestamp, callback_ns);
+                showFrame();
+                recordFrame(now);
+            }
+        }
+    }
+
+    /**
+     * @brief 发布图像，每帧只发布一次，无订阅者时跳过
+     * 进程内通信时图像缓冲区直接移交给unique_ptr消息，同一容器内的订阅者以ConstSharedPtr共享，
+     * 不再逐订阅者拷贝；订阅者释放后的缓冲区回到缓冲池，发布后随即取回一块交给驱动写入下一帧，
+     * 稳态下采集线程与SDK回调线程均不申请内存
+     */
+    template<class T>
+    void CameraBaseNode<T>::publishFrame(bool has_hw_timestamp, int64_t callback_ns)
+    {
+        bool is_published = false;
+        if (use_intra_process_)
+        {
+            if (image_pub_->get_subscription_count() + image_pub_->get_intra_process_subscription_count() > 0)
             {
-                camera_pub2buff_node_.publish(image_msg_, camera_info_msg_);
+                ImageMsgPtr image_msg = makeImageMsg();
+                image_msg->header = image_msg_.header;
+                image_msg->height = image_msg_.height;
+                image_msg->width = image_msg_.width;
+                image_msg->encoding = image_msg_.encoding;
+                image_msg->is_bigendian = image_msg_.is_bigendian;
+                image_msg->step = image_msg_.step;
+                image_msg->data.swap(image_msg_.data);
+                frame_ = cv::Mat();
+
+                image_pub_->publish(std::move(image_msg));
+                info_pub_->publish(std::make_unique<sensor_msgs::msg::CameraInfo>(camera_info_msg_));
+                // 池空(启动初期或订阅者积压)时保持为空，由驱动申请
+                imageBufferPool().take(image_msg_.data);
+                is_published = true;
             }
+        }
+        else if (camera_pub_.getNumSubscribers() > 0)
+        {
+            camera_pub_.publish(image_msg_, camera_info_msg_);
+            is_published = true;
+        }
 
-            if (save_video_)
-            {   // Video recorder.
-                ++frame_cnt_;
-                if (frame_cnt_ % 25 == 0)
-                {
-                    sensor_msgs::msg::Image image_msg = image_msg_;
-                    auto serializer = rclcpp::Serialization<sensor_msgs::msg::Image>();
-                    auto serialized_msg = rclcpp::SerializedMessage();
-                    serializer.serialize_message(&image_msg, &serialized_msg);
-                    auto bag_msg = std::make_shared<rosbag2_storage::SerializedBagMessage>();
-                    bag_msg->serialized_data = std::shared_ptr<rcutils_uint8_array_t>(
-                        new rcutils_uint8_array_t,
-                        [this](rcutils_uint8_array_t* msg)
-                        {
-                            if (rcutils_uint8_array_fini(msg) != RCUTILS_RET_OK)
-                            {
-                                RCLCPP_ERROR(this->get_logger(), "RCUTILS_RET_INVALID_ARGUMENT OR RCUTILS_RET_ERROR");
-                            }
-                            delete msg;
-                        }
-                    );
-                    *bag_msg->serialized_data = serialized_msg.release_rcl_serialized_message();
-                    bag_msg->topic_name = camera_topic_;
-                    bag_msg->time_stamp = now.nanoseconds();
-                    writer_->write(bag_msg);
-                }
+        int64_t publish_ns = FrameQueue::steadyNowNs();
+        if (is_published && callback_ns > 0)
+        {
+            int64_t delay_ns = publish_ns - callback_ns;
+            publish_delay_sum_ns_.fetch_add(delay_ns, std::memory_order_relaxed);
+            if (delay_ns > publish_delay_max_ns_.load(std::memory_order_relaxed))
+                publish_delay_max_ns_.store(delay_ns, std::memory_order_relaxed);
+            published_cnt_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (print_latency_)
+        {
+            double callback_latency = has_hw_timestamp ? (publish_ns - callback_ns) / 1e6 : 0.0;
+            double exposure_latency = exposure_mid_ns_ > 0 ? (publish_ns - exposure_mid_ns_) / 1e6 : 0.0;
+            RCLCPP_INFO_THROTTLE(
+                this->get_logger(), 
+                *this->get_clock(), 
+                1000, 
+                "Exposure to publish latency: %.3fms callback to publish: %.3fms transfer jitter: %.3fms drift: %.2fppm dropped: %lu", 
+                exposure_latency,
+                callback_latency, 
+                clock_sync_.getLastDelay() / 1e6,
+                clock_sync_.getDriftPpm(),
+                frame_queue_.dropped()
+            );
+        }
+    }
+
+    template<class T>
+    void CameraBaseNode<T>::recordFrame(const rclcpp::Time& stamp)
+    {
+        if (!save_video_)
+            return;
+
+        ++frame_cnt_;
+        if (frame_cnt_ % record_interval_ == 0)
+        {   // 采集线程不拷贝图像，序列化与写盘均由录包线程完成
+            int64_t stamp_ns = stamp.nanoseconds();
+            if (use_intra_process_)
+            {   // 图像由recordImageCallback在发布后入队
+                record_stamps_.push(stamp_ns);
             }
-            if (show_img_)
-            {
-                cv::namedWindow("frame", cv::WINDOW_AUTOSIZE);
-                cv::imshow("frame", frame_);
-                cv::waitKey(1);
+            else
+            {   // 图像缓冲区移交给录包消息，写盘后经ImageAllocator归还缓冲池
+                auto record_msg = std::allocate_shared<sensor_msgs::msg::Image>(ImageMsgAllocator());
+                record_msg->header = image_msg_.header;
+                record_msg->height = image_msg_.height;
+                record_msg->width = image_msg_.width;
+                record_msg->encoding = image_msg_.encoding;
+                record_msg->is_bigendian = image_msg_.is_bigendian;
+                record_msg->step = image_msg_.step;
+                record_msg->data.swap(image_msg_.data);
+                frame_ = cv::Mat();
+                recorder_->push(camera_topic_, std::move(record_msg), stamp_ns);
+                imageBufferPool().take(image_msg_.data);
             }
+            recorder_->push(image_transport::getCameraInfoTopic(camera_topic_), camera_info_msg_, stamp_ns);
+        }
+
+        uint64_t record_dropped = recorder_->dropped();
+        if (record_dropped != last_record_dropped_)
+        {
+            RCLCPP_WARN_THROTTLE(
+                this->get_logger(), 
+                *this->get_clock(), 
+                1000, 
+                "Recorder can't keep up, dropped: %lu written: %lu", 
+                record_dropped,
+                recorder_->written()
+            );
+            last_record_dropped_ = record_dropped;
+        }
+    }
+
+    /**
+     * @brief 录制采集线程已登记的帧，订阅队列丢弃的帧对应的登记直接跳过
+     */
+    template<class T>
+    void CameraBaseNode<T>::recordImageCallback(sensor_msgs::msg::Image::ConstSharedPtr msg)
+    {
+        int64_t stamp_ns = rclcpp::Time(msg->header.stamp).nanoseconds();
+        while (pending_record_ns_ < stamp_ns && record_stamps_.pop(pending_record_ns_))
+            continue;
+        if (pending_record_ns_ == stamp_ns)
+            recorder_->push(camera_topic_, msg, stamp_ns);
+    }
+
+    template<class T>
+    void CameraBaseNode<T>::showFrame()
+    {
+        if (!show_img_)
+            return;
+
+        cv::namedWindow("frame", cv::WINDOW_AUTOSIZE);
+        if (publish_raw_bayer_)
+        {   // BGGR阵列对应COLOR_BayerRG2BGR
+            cv::Mat show_img;
+            cv::cvtColor(frame_, show_img, cv::COLOR_BayerRG2BGR);
+            cv::imshow("frame", show_img);
+        }
+        else
+        {
+            cv::imshow("frame", frame_);
         }
+        cv::waitKey(1);
     }
 
     template<class T>
@@ -354,6 +764,12 @@ namespace camera_driver
         this->declare_parameter("fps", 30);
         this->declare_parameter("video_path", "/config/camera_ros.yaml");
         this->declare_parameter<bool>("save_video", false);
+        this->declare_parameter<bool>("use_push_mode", false);
+        this->declare_parameter<bool>("print_latency", false);
+        this->declare_parameter<bool>("use_hw_timestamp", true);
+        this->declare_parameter<bool>("hw_timestamp_at_exposure_end", false);
+        this->declare_parameter<bool>("publish_raw_bayer", false);
+        this->declare_parameter<bool>("use_hw_roi", false);
         this->declare_parameter<string>("config_path", "/config/daheng_cam_param.ini");
 
         camera_params_.cam_id = this->get_parameter("cam_id").as_int();
@@ -380,6 +796,13 @@ namespace camera_driver
         
         show_img_ = this->get_parameter("show_img").as_bool();
         save_video_ = this->get_parameter("save_video").as_bool();
+        use_push_mode_ = this->get_parameter("use_push_mode").as_bool();
+        print_latency_ = this->get_parameter("print_latency").as_bool();
+        use_hw_timestamp_ = this->get_parameter("use_hw_timestamp").as_bool();
+        hw_timestamp_at_exposure_end_ = this->get_parameter("hw_timestamp_at_exposure_end").as_bool();
+        exposure_time_ = camera_params_.exposure_time;
+        publish_raw_bayer_ = this->get_parameter("publish_raw_bayer").as_bool();
+        use_hw_roi_ = this->get_parameter("use_hw_roi").as_bool();
 
         string pkg_share_pth = get_package_share_directory("global_user");
         camera_params_.video_path = pkg_share_pth + this->get_parameter("video_path").as_string();
@@ -0,0 +1,85 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-11 14:32:08
+ * @LastEditTime: 2023-06-11 14:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/camera_driver/clock_sync.hpp
+ */
+#ifndef CLOCK_SYNC_HPP_
+#define CLOCK_SYNC_HPP_
+
+//c++
+#include <vector>
+#include <cstdint>
+
+namespace camera_driver
+{
+    /**
+     * @brief 相机硬件时钟与主机steady时钟的在线同步
+     *
+     * 以(设备时间戳, 主机收到该帧的时刻)为观测，拟合 host = device + offset + drift * (device - device0)：
+     * 1.带遗忘因子的加权最小二乘估计漂移与平均偏移；
+     * 2.主机收帧时刻 = 真实时刻 + 传输/调度延迟(非负)，因此取窗口内残差的最小值作为下包络修正，
+     *   得到的映射对应延迟最小的那些帧，剔除了传输与调度抖动。
+     * 设备时间回退或残差异常(如相机重连后时钟复位)时自动重置。
+     */
+    class ClockSync
+    {
+    public:
+        ClockSync(double tick_freq = 1e9, int window_size = 200, double forget_factor = 0.999);
+
+        void reset();
+        void setTickFrequency(double tick_freq);
+
+        /**
+         * @brief 输入一组观测并更新模型
+         *
+         * @param device_ticks 设备时间戳(tick)
+         * @param host_ns 主机收到该帧时的steady时间(ns)
+         * @return int64_t 该设备时间戳对应的主机steady时间(ns)
+         */
+        int64_t update(uint64_t device_ticks, int64_t host_ns);
+
+        // 将设备时间戳换算为主机steady时间(ns)，需先调用过update
+        int64_t toHost(uint64_t device_ticks) const;
+
+        bool isConverged() const;
+        double getDriftPpm() const;
+        // 当前观测相对下包络的延迟(ns)，即传输+调度耗时的估计
+        double getLastDelay() const;
+
+    private:
+        double tickToNs(uint64_t device_ticks) const;
+        double fitOffset(double x) const;
+
+    private:
+        double tick_freq_;
+        int window_size_;
+        double forget_factor_;
+
+        bool is_initialized_;
+        int sample_cnt_;
+        uint64_t device_ticks0_;     // 参考设备时间戳
+        int64_t host_ns0_;           // 参考主机时间
+        uint64_t last_device_ticks_;
+        double x_base_;              // 参考点平移量(ns)
+
+        // 加权最小二乘的充分统计量，x为设备相对时间，y为主机与设备时间之差(相对参考点)
+        double sum_w_;
+        double sum_x_;
+        double sum_y_;
+        double sum_xx_;
+        double sum_xy_;
+        double offset_;
+        double drift_;
+
+        // 最近window_size_个观测，用于计算下包络
+        std::vector<double> window_x_;
+        std::vector<double> window_y_;
+        int window_idx_;
+        double envelope_;
+        double last_delay_;
+    };
+} //namespace camera_driver
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 16:20:31
+ * @LastEditTime: 2023-06-10 16:20:31
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/camera_driver/frame_queue.hpp
+ */
+#ifndef FRAME_QUEUE_HPP_
+#define FRAME_QUEUE_HPP_
+
+//c++
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace camera_driver
+{
+    /**
+     * @brief 无锁单生产者单消费者环形队列
+     * 生产者只写tail_,消费者只写head_,二者分处不同缓存行,容量N须为2的幂
+     */
+    template<typename T, size_t N>
+    class SpscQueue
+    {
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of 2!");
+
+    public:
+        SpscQueue()
+        : head_(0), tail_(0)
+        {
+        }
+
+        // 仅由生产者线程调用,队满返回false
+        bool push(const T& item)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == N)
+                return false;
+            buffer_[tail & (N - 1)] = item;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 仅由消费者线程调用,队空返回false
+        bool pop(T& item)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire))
+                return false;
+            item = buffer_[head & (N - 1)];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t size() const
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+    private:
+        alignas(64) std::atomic<size_t> head_;
+        alignas(64) std::atomic<size_t> tail_;
+        alignas(64) T buffer_[N];
+    };
+
+    /**
+     * @brief SDK回调线程推送给发布线程的一帧图像
+     */
+    struct CameraFrame
+    {
+        std::vector<uint8_t> data;      // 图像数据(bgr8或bayer_bggr8)
+        int width = 0;
+        int height = 0;
+        int channels = 3;
+        int offset_x = 0;               // 硬件ROI在全幅图像中的偏移
+        int offset_y = 0;
+        uint64_t frame_id = 0;          // SDK帧号
+        uint64_t device_timestamp = 0;  // 相机硬件时间戳(tick)
+        int64_t host_timestamp_ns = 0;  // 进入SDK回调时的主机steady时间(ns)
+    };
+
+    /**
+     * @brief 推流模式下的帧交换队列
+     * 由两条SPSC队列组成:free_由发布线程归还空闲帧、SDK线程取用;ready_由SDK线程推入、发布线程取出。
+     * 帧对象全部预分配并循环复用,稳态下不发生内存申请,也不需要互斥锁。
+     */
+    class FrameQueue
+    {
+    public:
+        static constexpr size_t FRAME_NUM = 4;
+
+        FrameQueue()
+        : dropped_(0)
+        {
+            for (auto& frame : frames_)
+                free_.push(&frame);
+        }
+
+        // ---------------- SDK线程(生产者) ----------------
+        // 取出一块空闲帧,发布线程处理不过来时返回nullptr并计为丢帧
+        CameraFrame* acquire()
+        {
+            CameraFrame* frame = nullptr;
+            if (!free_.pop(frame))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return frame;
+        }
+
+        // 填充完成后推送给发布线程
+        void commit(CameraFrame* frame)
+        {
+            ready_.push(frame);
+        }
+
+        // 填充失败时标记为空帧交由发布线程回收(free_只允许发布线程写入)
+        void abort(CameraFrame* frame)
+        {
+            frame->width = frame->height = 0;
+            ready_.push(frame);
+        }
+
+        // ---------------- 发布线程(消费者) ----------------
+        // 取出最新一帧,积压的旧帧直接归还,保证发布的总是最新图像
+        CameraFrame* take()
+        {
+            CameraFrame* latest = nullptr;
+            CameraFrame* frame = nullptr;
+            while (ready_.pop(frame))
+            {
+                if (frame->width == 0)
+                {   // 生产者填充失败的帧
+                    release(frame);
+                    continue;
+                }
+                if (latest != nullptr)
+                {
+                    release(latest);
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                latest = frame;
+            }
+            return latest;
+        }
+
+        // 发布完成后归还帧
+        void release(CameraFrame* frame)
+        {
+            free_.push(frame);
+        }
+
+        uint64_t dropped() const
+        {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        static int64_t steadyNowNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        CameraFrame frames_[FRAME_NUM];
+        SpscQueue<CameraFrame*, FRAME_NUM> free_;
+        SpscQueue<CameraFrame*, FRAME_NUM> ready_;
+        std::atomic<uint64_t> dropped_;
+    };
+
+    /**
+     * @brief 图像缓冲池
+     * 进程内发布时图像缓冲区随消息移交订阅者，消息析构时归还到池中，发布线程再取回供驱动写入下一帧。
+     * 归还发生在各订阅者的回调线程，槽位状态以CAS切换，多生产者多消费者均无锁；池满时归还失败，由调用方释放。
+     */
+    class BufferPool
+    {
+    public:
+        static constexpr size_t BUFFER_NUM = 8;
+
+        // 将buffer放入空槽位(交换后buffer为空)，池满或buffer未分配时返回false
+        bool put(std::vector<uint8_t>& buffer)
+        {
+            if (buffer.capacity() == 0)
+                return false;
+            for (auto& slot : slots_)
+            {
+                int expected = SLOT_EMPTY;
+                if (slot.state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acq_rel))
+                {
+                    slot.buffer.swap(buffer);
+                    slot.state.store(SLOT_FULL, std::memory_order_release);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // 取出一块缓冲区与buffer交换，buffer原有的缓冲区(若已分配)留在池中，池空时返回false
+        bool take(std::vector<uint8_t>& buffer)
+        {
+            for (auto& slot : slots_)
+            {
+                int expected = SLOT_FULL;
+                if (slot.state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acq_rel))
+                {
+                    slot.buffer.swap(buffer);
+                    slot.state.store(slot.buffer.capacity() > 0 ? SLOT_FULL : SLOT_EMPTY, std::memory_order_release);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t size() const
+        {
+            size_t num = 0;
+            for (auto& slot : slots_)
+                num += (slot.state.load(std::memory_order_acquire) == SLOT_FULL);
+            return num;
+        }
+
+    private:
+        enum SlotState
+        {
+            SLOT_EMPTY,
+            SLOT_BUSY,      //放入或取出中
+            SLOT_FULL
+        };
+
+        struct BufferSlot
+        {
+            std::atomic<int> state{SLOT_EMPTY};
+            std::vector<uint8_t> buffer;
+        };
+
+        BufferSlot slots_[BUFFER_NUM];
+    };
+} //namespace camera_driver
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-07-02 15:42:18
+ * @LastEditTime: 2023-07-02 15:42:18
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/camera_driver/image_allocator.hpp
+ */
+#ifndef IMAGE_ALLOCATOR_HPP_
+#define IMAGE_ALLOCATOR_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/image.hpp>
+
+//c++
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "./frame_queue.hpp"
+
+namespace camera_driver
+{
+    /**
+     * @brief 进程内共享的图像缓冲池，各相机节点发布的图像消息析构时归还至此
+     */
+    inline BufferPool& imageBufferPool()
+    {
+        static BufferPool pool;
+        return pool;
+    }
+
+    /**
+     * @brief 图像发布者的分配器
+     * 内存分配同std::allocator，图像消息析构前将数据缓冲区归还imageBufferPool()，
+     * 使进程内发布时移交给订阅者的缓冲区回到采集线程。无状态，任意实例可互换。
+     * 需要消息所有权(unique_ptr回调)的进程内订阅者须与发布者使用同一分配器，
+     * 以ConstSharedPtr接收的订阅者(image_transport)不受限制。
+     */
+    template<typename T = void>
+    class ImageAllocator
+    {
+    public:
+        using value_type = T;
+
+        template<typename U>
+        struct rebind
+        {
+            using other = ImageAllocator<U>;
+        };
+
+        ImageAllocator() noexcept {}
+
+        template<typename U>
+        ImageAllocator(const ImageAllocator<U>&) noexcept {}
+
+        T* allocate(size_t num)
+        {
+            return static_cast<T*>(::operator new(num * sizeof(ValueType)));
+        }
+
+        void deallocate(T* ptr, size_t) noexcept
+        {
+            ::operator delete(ptr);
+        }
+
+        template<typename U>
+        void destroy(U* ptr)
+        {
+            recycle(ptr);
+            ptr->~U();
+        }
+
+    private:
+        // rclcpp以void实例作为rcl分配器，按字节分配
+        using ValueType = typename std::conditional<std::is_void<T>::value, uint8_t, T>::type;
+
+        static void recycle(sensor_msgs::msg::Image* msg)
+        {
+            imageBufferPool().put(msg->data);
+        }
+
+        template<typename U>
+        static void recycle(U*)
+        {
+        }
+    };
+
+    template<typename T, typename U>
+    bool operator==(const ImageAllocator<T>&, const ImageAllocator<U>&) noexcept
+    {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const ImageAllocator<T>&, const ImageAllocator<U>&) noexcept
+    {
+        return false;
+    }
+
+    using ImageMsgAllocator = ImageAllocator<sensor_msgs::msg::Image>;
+    using ImageMsgDeleter = rclcpp::allocator::Deleter<ImageMsgAllocator, sensor_msgs::msg::Image>;
+    using ImageMsgPtr = std::unique_ptr<sensor_msgs::msg::Image, ImageMsgDeleter>;
+
+    /**
+     * @brief 以ImageAllocator创建待发布的图像消息
+     * 删除器指向静态的分配器实例，消息可晚于发布者析构
+     */
+    inline ImageMsgPtr makeImageMsg()
+    {
+        static ImageMsgAllocator allocator;
+        using AllocTraits = std::allocator_traits<ImageMsgAllocator>;
+        sensor_msgs::msg::Image* msg = AllocTraits::allocate(allocator, 1);
+        AllocTraits::construct(allocator, msg);
+        return ImageMsgPtr(msg, ImageMsgDeleter(&allocator));
+    }
+} //namespace camera_driver
+
+#endif
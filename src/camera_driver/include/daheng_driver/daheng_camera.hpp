@@ -22,6 +22,7 @@
 #include <sensor_msgs/msg/image.hpp>
 
 #include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/frame_queue.hpp"
 
 using namespace std;
 using namespace cv;
@@ -43,9 +44,9 @@ namespace camera_driver
         bool                set_color;
         bool                set_saturation;
 
-        int                 timestamp_offset = 0;
         int64_t             m_i64ColorCorrection;       ///< Color correction param
         int64_t             lastImgTimestamp;           ///< timestamp of last img
+        int64_t             lastHostTimestamp;          ///< host steady time(ns) when last img was dequeued
         void*               pGammaLut;                  ///< Gamma look up table
         int                 nLutLength;                 ///< Gamma look up table length
         void*               pContrastLut;             ///< Contrast look up table
@@ -57,6 +58,12 @@ namespace camera_driver
         int64_t             nColorCorrectionParam;
         VxInt16             nSaturation;
 
+        FrameQueue*         frame_queue_ = nullptr;     ///< 推流模式帧队列,为空时使用GXDQBuf轮询
+        bool                raw_bayer_ = false;         ///< 输出原始Bayer图像
+        cv::Rect            base_roi_;                  ///< 配置文件中的采集窗口(全幅)
+        cv::Rect            roi_;                       ///< 当前硬件ROI,相对于base_roi_
+        cv::Point2i         lastFrameOffset;            ///< offset of last img relative to base_roi_
+
         // char *pRGB24Buf;
 
     public:
@@ -88,6 +95,10 @@ namespace camera_driver
         bool setContrast(bool set_status,int dContrastParam);
         // Set_Saturation
         bool setSaturation(bool set_status,int dSaturationParam);
+        //采集回调,在SDK线程中完成Bayer转换并推入帧队列
+        static void GX_STDC onFrameCallback(GX_FRAME_CALLBACK_PARAM* pFrame);
+        //开始/停止采集
+        bool setAcquisition(bool is_on);
     
     public:
         //手动设置曝光值,单位us,正常大小应在2000至8000
@@ -99,14 +110,29 @@ namespace camera_driver
         //手动设置白平衡,value表示平衡通道，value_number表示具体值,0、1、2对应B、G、R，value_number范围为10到80,10表示正常
         bool setBalance(int value, float value_number);
         
-        //采集一次图像,更新时间戳
-        bool updateTimestampOffset(std::chrono::_V2::steady_clock::time_point time_start);
-        
-        //读取相机时间戳
-        int getTimestamp();
+        //读取最近一帧的相机时间戳(tick)及主机取到该帧的steady时间(ns)
+        bool getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns);
+
+        //相机时间戳频率,125MHz
+        double getTimestampFrequency();
 
         //采集图像
         bool getImage(cv::Mat &Src, sensor_msgs::msg::Image& image_msg);
+
+        //设置推流模式帧队列,需在open()之前调用
+        bool setFrameQueue(FrameQueue* frame_queue);
+
+        //设置是否输出原始Bayer图像
+        bool setRawBayer(bool raw_bayer);
+
+        //设置硬件ROI,坐标相对于全幅(配置文件中的采集窗口),宽高为0时恢复全幅
+        bool setRoi(const cv::Rect& roi);
+
+        //全幅尺寸
+        cv::Size getSensorSize();
+
+        //最近一帧在全幅中的偏移
+        bool getFrameOffset(cv::Point2i& offset);
         
         //设备复位
         bool deviceReset();
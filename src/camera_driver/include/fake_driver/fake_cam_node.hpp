@@ -0,0 +1,38 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 17:40:26
+ * @LastEditTime: 2023-06-10 17:40:26
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/fake_driver/fake_cam_node.hpp
+ */
+#ifndef FAKE_CAM_NODE_HPP_
+#define FAKE_CAM_NODE_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+#include <image_transport/image_transport.hpp>
+
+#include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/camera_driver_node.hpp"
+
+using namespace std;
+namespace camera_driver
+{
+    class FakeCamNode : public CameraBaseNode<FakeCam>
+    {
+    public:
+        FakeCamNode(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
+        ~FakeCamNode();
+
+    private:
+        // Update params.
+        bool setParam(rclcpp::Parameter);
+
+        // Params callback.
+        rcl_interfaces::msg::SetParametersResult paramsCallback(const std::vector<rclcpp::Parameter>& params);
+    };
+} //namespace camera_driver
+
+#endif
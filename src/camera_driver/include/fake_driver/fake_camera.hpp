@@ -0,0 +1,103 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 17:05:12
+ * @LastEditTime: 2023-06-10 17:05:12
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/fake_driver/fake_camera.hpp
+ */
+#ifndef FAKE_CAMERA_HPP_
+#define FAKE_CAMERA_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+#include <sensor_msgs/msg/image.hpp>
+
+//c++
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+#include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/frame_queue.hpp"
+
+using namespace global_user;
+namespace camera_driver
+{
+    /**
+     * @brief 虚拟相机，按设定帧率生成合成的BayerBG8图像
+     * 模拟SDK的两种采集方式：getImage轮询，或由内部采集线程(模拟SDK回调线程)推入帧队列，
+     * 用于在没有实体相机的环境下测试采集、发布链路。
+     */
+    class FakeCam
+    {
+    public:
+        // 模拟大恒相机125MHz的硬件时间戳
+        static constexpr double TICK_FREQ = 125e6;
+
+        FakeCam();
+        FakeCam(const CameraParam& cam_params);
+        ~FakeCam();
+
+        bool init();
+        bool open();
+        bool close();
+        bool getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg);
+        bool setFrameQueue(FrameQueue* frame_queue);
+        bool setRawBayer(bool raw_bayer);
+        bool setRoi(const cv::Rect& roi);
+        cv::Size getSensorSize();
+        bool getFrameOffset(cv::Point2i& offset);
+        bool getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns);
+        double getTimestampFrequency();
+
+        bool setExposureTime(int exposure_time);
+        bool setGain(int value, int exp_gain);
+        bool setBalance(int value, float value_number);
+
+    private:
+        // 生成一帧Bayer图像，非raw模式下再转换为BGR
+        void renderFrame(uint8_t* data, const cv::Rect& roi);
+        cv::Rect getRoi();
+        // 等待至下一帧的曝光时刻
+        void waitNextFrame();
+        // 模拟SDK回调线程
+        void captureThread();
+        // 当前帧的设备时间戳
+        uint64_t deviceTimestamp() const;
+
+    public:
+        CameraParam cam_param_;
+
+    private:
+        int width_;
+        int height_;
+        std::chrono::nanoseconds frame_interval_;
+        std::chrono::steady_clock::time_point start_time_;
+        std::chrono::steady_clock::time_point next_frame_time_;
+        uint64_t frame_id_;
+        int exposure_time_;
+        uint64_t last_device_timestamp_;
+        int64_t last_host_timestamp_ns_;
+
+        cv::Mat bgr_scene_;
+        cv::Mat bayer_;
+
+        FrameQueue* frame_queue_ = nullptr;
+        bool raw_bayer_ = false;
+
+        // 硬件ROI，模拟相机只输出全幅中的一块区域
+        std::mutex roi_mutex_;
+        cv::Rect roi_;
+        cv::Point2i last_frame_offset_;
+        std::thread capture_thread_;
+        std::atomic<bool> is_open_;
+        rclcpp::Logger logger_;
+    };
+} //namespace camera_driver
+
+#endif
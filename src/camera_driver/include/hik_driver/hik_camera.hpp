@@ -11,6 +11,7 @@
 #include <sensor_msgs/msg/image.hpp>
 
 //c++
+#include <atomic>
 #include <string>
 #include <vector>
 #include <thread>
@@ -35,6 +36,7 @@
 #include "../../dependencies/hik_sdk/include/CameraParams.h"                         
 
 #include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/frame_queue.hpp"
 
 using namespace global_user;
 namespace camera_driver
@@ -100,6 +102,13 @@ namespace camera_driver
         bool isOpen();
 
         bool getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg);
+        bool setFrameQueue(FrameQueue* frame_queue);
+        bool setRawBayer(bool raw_bayer);
+        bool setRoi(const cv::Rect& roi);
+        cv::Size getSensorSize();
+        bool getFrameOffset(cv::Point2i& offset);
+        bool getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns);
+        double getTimestampFrequency();
         bool setGain(int value, int exp_gain);
         bool setExposureTime(float exposure_time);
         bool setBalance(int value, unsigned int value_num);
@@ -109,14 +118,17 @@ namespace camera_driver
         void startDevice(int serial_number);
         bool setStreamOn();
         bool setResolution(int width, int height);
+        void prepareFrameBuffer(std::vector<unsigned char>& buffer, size_t frame_size);
+        bool selectBayerFormat(unsigned int& pixel_format);
+        bool enableRoiChunk();
+        cv::Point2i frameOffset(const MV_FRAME_OUT_INFO_EX& frame_info);
         bool setAutoBalance();
         bool setGamma(bool set_status, double gamma_param);
         bool colorCorrect(bool value);
         bool setContrast(bool set_status, int contrast_param);
-        bool updateTimestamp(rclcpp::Time time_start);
-        int getTimestamp();
         bool setTriggerMode(TriggerSetting trigger_setting = TriggerSetting());
         bool setDigitalIoControl(IoControlSetting io_control_setting = IoControlSetting());
+        static void __stdcall onFrameCallback(unsigned char* pData, MV_FRAME_OUT_INFO_EX* pFrameInfo, void* pUser);
     
     public:
         // Camera params.
@@ -124,11 +136,13 @@ namespace camera_driver
     
     private:
         bool is_open_; 
-        double timestamp_offset_ = 0;
-        rclcpp::Clock steady_clock_{RCL_STEADY_TIME};
-        rclcpp::Time time_start_;
         rclcpp::Logger logger_;
 
+        // 硬件时间戳
+        uint64_t last_device_timestamp_;
+        int64_t last_host_timestamp_ns_;
+        double timestamp_freq_;
+
     protected:
         int nRet = MV_OK;
         void* handle = NULL;
@@ -140,5 +154,26 @@ namespace camera_driver
 
         MVCC_FLOATVALUE frame_rate;
         MV_IMAGE_BASIC_INFO stFrameInfo;
+
+        // 预分配的帧缓冲环，在setStreamOn时按PayloadSize一次性申请，
+        // 消息缓冲区随进程内发布移交且未能从缓冲池取回时换入，采集线程不申请内存
+        static constexpr int FRAME_BUFFER_NUM = 3;
+        std::vector<std::vector<unsigned char>> frame_buffer_ring_;
+        int frame_buffer_idx_ = 0;
+
+        // 推流模式帧队列，为空时使用MV_CC_GetOneFrameTimeout轮询
+        FrameQueue* frame_queue_ = nullptr;
+
+        // 输出原始Bayer(BGGR)数据，去马赛克推迟到检测节点
+        bool raw_bayer_ = false;
+
+        // 打开相机时的采集窗口(全幅)及当前硬件ROI(相对于全幅)
+        cv::Rect base_roi_;
+        cv::Rect roi_;
+        // 取流中直接修改偏移，回调线程读取，不支持chunk时作为帧偏移
+        std::atomic<int> roi_offset_x_{0};
+        std::atomic<int> roi_offset_y_{0};
+        bool has_roi_chunk_ = false;
+        cv::Point2i last_frame_offset_;
     }; //HikCamera
 } //camera_driver
\ No newline at end of file
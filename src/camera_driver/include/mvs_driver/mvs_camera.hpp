@@ -12,6 +12,7 @@
 #include <sensor_msgs/msg/image.hpp>
 
 //c++
+#include <atomic>
 #include <string>
 #include <vector>
 #include <thread>
@@ -33,6 +34,7 @@
 #include "../../dependencies/mvs_sdk/include/CameraApi.h"
 
 #include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/frame_queue.hpp"
 
 using namespace global_user;
 using namespace cv;
@@ -50,6 +52,13 @@ namespace camera_driver
         bool close();
         bool isOpen();
         bool getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg);
+        bool setFrameQueue(FrameQueue* frame_queue);
+        bool setRawBayer(bool raw_bayer);
+        bool setRoi(const cv::Rect& roi);
+        cv::Size getSensorSize();
+        bool getFrameOffset(cv::Point2i& offset);
+        bool getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns);
+        double getTimestampFrequency();
         
         void setGain(int value, int exp_gain);
         void setExposureTime(float exposure_time);
@@ -57,6 +66,10 @@ namespace camera_driver
         void setResolution(int width, int height); // TODO
         void deviceReset();
 
+    private:
+        bool setBayerMediaType();
+        static void onFrameCallback(CameraHandle hCamera, BYTE* pFrameBuffer, tSdkFrameHead* pFrameHead, PVOID pContext);
+
     public:
         int iCameraCounts = 1;
         int hCamera;
@@ -80,5 +93,21 @@ namespace camera_driver
         rclcpp::Clock steady_clock_{RCL_STEADY_TIME};
         rclcpp::Time time_start_;
         rclcpp::Logger logger_;
+
+        uint64_t last_device_timestamp_ = 0;
+        int64_t last_host_timestamp_ns_ = 0;
+
+        // 推流模式帧队列，为空时使用CameraGetImageBuffer轮询
+        FrameQueue* frame_queue_ = nullptr;
+        uint64_t push_frame_cnt_ = 0;
+
+        // 输出原始Bayer(BGGR)数据，跳过CameraImageProcess
+        bool raw_bayer_ = false;
+
+        // 打开相机时的分辨率窗口及当前硬件ROI(相对于该窗口)
+        tSdkImageResolution base_resolution_;
+        cv::Rect roi_;
+        // 当前ROI窗口(x、y、宽、高各16位)，回调线程整体读取后标注帧偏移，并丢弃尺寸不符的旧窗口帧
+        std::atomic<uint64_t> roi_window_{0};
     };
 }
\ No newline at end of file
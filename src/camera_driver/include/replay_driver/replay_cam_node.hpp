@@ -0,0 +1,59 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-15 21:32:08
+ * @LastEditTime: 2023-06-15 21:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/replay_driver/replay_cam_node.hpp
+ */
+#ifndef REPLAY_CAM_NODE_HPP_
+#define REPLAY_CAM_NODE_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+#include <image_transport/image_transport.hpp>
+#include <rosgraph_msgs/msg/clock.hpp>
+#include <std_srvs/srv/trigger.hpp>
+
+#include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/camera_driver_node.hpp"
+
+using namespace std;
+namespace camera_driver
+{
+    /**
+     * @brief 回放节点：以录制的bag代替相机驱动完整的自瞄链路，用于离线测试与基准测试
+     * 单步模式下通过~/step服务逐帧发布；开启publish_clock时以录制时间戳发布图像与/clock，
+     * 下游节点需设置use_sim_time
+     */
+    class ReplayCamNode : public CameraBaseNode<ReplayCam>
+    {
+        typedef global_interface::msg::Serial SerialMsg;
+
+    public:
+        ReplayCamNode(const rclcpp::NodeOptions &options = rclcpp::NodeOptions());
+        ~ReplayCamNode();
+
+    private:
+        rclcpp::Time stampFrame(uint64_t device_timestamp, int64_t host_timestamp_ns, bool has_hw_timestamp) override;
+
+        // 回放录制的串口消息
+        void replaySerialMsg(const SerialMsg& msg);
+
+        void stepCallback(
+            const std::shared_ptr<std_srvs::srv::Trigger::Request> request,
+            std::shared_ptr<std_srvs::srv::Trigger::Response> response
+        );
+
+    private:
+        ReplayMode replay_mode_;
+        bool publish_clock_;
+        bool publish_serial_;
+        rclcpp::Publisher<rosgraph_msgs::msg::Clock>::SharedPtr clock_pub_;
+        rclcpp::Publisher<SerialMsg>::SharedPtr serial_msg_pub_;
+        rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr step_srv_;
+    };
+} //namespace camera_driver
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-15 21:32:08
+ * @LastEditTime: 2023-06-15 21:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/include/replay_driver/replay_camera.hpp
+ */
+#ifndef REPLAY_CAMERA_HPP_
+#define REPLAY_CAMERA_HPP_
+
+//ros
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/msg/camera_info.hpp>
+#include <rosbag2_storage/serialized_bag_message.hpp>
+
+//c++
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+#include "../../global_user/include/global_user/global_user.hpp"
+#include "../camera_driver/frame_queue.hpp"
+#include "global_interface/msg/serial.hpp"
+
+using namespace global_user;
+namespace camera_driver
+{
+    enum ReplayMode
+    {
+        REPLAY_REALTIME,    //按录制时间间隔(乘以倍率)发布
+        REPLAY_FAST,        //不等待，以最大吞吐发布
+        REPLAY_STEPPED      //每次请求发布一帧
+    };
+
+    /**
+     * @brief 回放相机，从camera_driver录制的rosbag中读取图像
+     * load时将整个bag预加载到内存(保留序列化数据，发布时直接反序列化到图像消息中，不经中间拷贝)，
+     * 按实时、最快或单步方式输出，并按录制时间顺序回调录制的串口消息。
+     * 录制的图像编码原样输出，录制时的硬件ROI由同包的camera_info恢复；不支持设置硬件ROI、推流模式等。
+     */
+    class ReplayCam
+    {
+    public:
+        typedef global_interface::msg::Serial SerialMsg;
+        typedef std::function<void(const SerialMsg&)> SerialCallback;
+
+        // 时间戳以ns为单位
+        static constexpr double TICK_FREQ = 1e9;
+
+        ReplayCam();
+        ReplayCam(const CameraParam& cam_params);
+        ~ReplayCam();
+
+        bool init();
+        bool open();
+        bool close();
+        bool getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg);
+        bool setFrameQueue(FrameQueue* frame_queue);
+        bool setRawBayer(bool raw_bayer);
+        bool setRoi(const cv::Rect& roi);
+        cv::Size getSensorSize();
+        bool getFrameOffset(cv::Point2i& offset);
+        bool getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns);
+        double getTimestampFrequency();
+
+        bool setExposureTime(int exposure_time);
+        bool setGain(int value, int exp_gain);
+        bool setBalance(int value, float value_number);
+
+        /**
+         * @brief 预加载bag(支持逐条压缩的bag)
+         *
+         * @param bag_path bag目录
+         * @param image_topic 图像话题，为空时取bag中第一个sensor_msgs/msg/Image话题
+         * @return 是否加载到图像
+         */
+        bool load(const std::string& bag_path, const std::string& image_topic = "");
+        void setReplayMode(ReplayMode mode);
+        void setRate(double rate);
+        void setLoop(bool loop);
+        void setSerialCallback(SerialCallback callback);
+        // 开始回放，此前getImage阻塞等待
+        void start();
+        // 单步模式下放行n帧
+        void step(int n = 1);
+
+        size_t frameNum() const;
+        size_t frameIdx() const;
+
+    private:
+        // 按回放模式等待当前帧的发布时刻，被关闭时返回false
+        bool waitFrame();
+        // 发布当前帧之前录制的串口消息
+        void flushSerialMsgs(int64_t until_ns);
+        // 回放到末尾时循环或结束
+        bool rewind();
+
+    public:
+        CameraParam cam_param_;
+
+    private:
+        struct SerialRecord
+        {
+            int64_t bag_ns;
+            SerialMsg msg;
+        };
+
+        std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> frames_;
+        // 与frames_一一对应的硬件ROI偏移，无camera_info时为全幅
+        std::vector<cv::Point2i> frame_offsets_;
+        cv::Point2i last_frame_offset_;
+        std::vector<SerialRecord> serial_msgs_;
+        cv::Size sensor_size_;
+
+        ReplayMode mode_;
+        double rate_;
+        bool loop_;
+        SerialCallback serial_callback_;
+
+        std::atomic<size_t> frame_idx_;
+        size_t serial_idx_;
+        int step_cnt_;
+        bool started_;
+        std::mutex step_mutex_;
+        std::condition_variable step_cond_;
+
+        // 实时模式下录制时间与主机时刻的对齐点
+        bool anchored_;
+        std::chrono::steady_clock::time_point replay_start_time_;
+        int64_t replay_start_bag_ns_;
+        int64_t replay_wall_start_ns_;
+        uint64_t replayed_cnt_;
+        bool finished_;
+
+        uint64_t last_stamp_ns_;
+        int64_t last_host_timestamp_ns_;
+        std::atomic<bool> is_open_;
+        rclcpp::Logger logger_;
+    };
+} //namespace camera_driver
+
+#endif
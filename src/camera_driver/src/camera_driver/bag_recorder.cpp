@@ -0,0 +1,248 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-13 20:16:45
+ * @LastEditTime: 2023-06-13 20:16:45
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/camera_driver/bag_recorder.cpp
+ */
+#include "../../include/camera_driver/bag_recorder.hpp"
+
+#include <rosbag2_cpp/writers/sequential_writer.hpp>
+#include <rosbag2_compression/compression_options.hpp>
+#include <rosbag2_compression/sequential_compression_writer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace camera_driver
+{
+    BagRecorder::BagRecorder(int slot_num)
+    : slot_num_(std::max(slot_num, 2)), next_seq_(0), is_open_(false), is_running_(false), producer_num_(0),
+    pushed_(0), dropped_(0), written_(0), logger_(rclcpp::get_logger("bag_recorder"))
+    {
+        slots_.reset(new RecordSlot[slot_num_]);
+        sem_init(&ready_sem_, 0, 0);
+    }
+
+    BagRecorder::~BagRecorder()
+    {
+        close();
+        sem_destroy(&ready_sem_);
+    }
+
+    bool BagRecorder::open(const std::string& uri, const std::string& compression_format)
+    {
+        if (is_open_)
+            return true;
+
+        try
+        {
+            if (compression_format.empty())
+            {
+                writer_ = std::make_unique<rosbag2_cpp::writers::SequentialWriter>();
+            }
+            else
+            {   //逐条消息压缩，压缩在rosbag2内部线程中完成
+                rosbag2_compression::CompressionOptions compression_options;
+                compression_options.compression_format = compression_format;
+                compression_options.compression_mode = rosbag2_compression::CompressionMode::MESSAGE;
+                writer_ = std::make_unique<rosbag2_compression::SequentialCompressionWriter>(compression_options);
+            }
+
+            rosbag2_storage::StorageOptions storage_options;
+            storage_options.uri = uri;
+            storage_options.storage_id = "sqlite3";
+            rosbag2_cpp::ConverterOptions converter_options({
+                rmw_get_serialization_format(),
+                rmw_get_serialization_format()
+            });
+            writer_->open(storage_options, converter_options);
+        }
+        catch(const std::exception& e)
+        {
+            RCLCPP_ERROR(logger_, "Open bag %s failed: %s", uri.c_str(), e.what());
+            writer_.reset();
+            return false;
+        }
+
+        is_running_ = true;
+        is_open_ = true;
+        writer_thread_ = std::thread(&BagRecorder::writerThread, this);
+        RCLCPP_INFO(logger_, "Recording to %s, compression: %s", uri.c_str(), compression_format.empty() ? "none" : compression_format.c_str());
+        return true;
+    }
+
+    void BagRecorder::close()
+    {
+        if (!is_open_)
+            return;
+
+        // 先拒绝新的push，再等待已通过检查的生产者提交完毕，此后所有消息均已处于SLOT_READY
+        is_open_ = false;
+        while (producer_num_.load() > 0)
+            std::this_thread::yield();
+
+        is_running_ = false;
+        sem_post(&ready_sem_);
+        if (writer_thread_.joinable())
+            writer_thread_.join();
+        writer_.reset();
+        RCLCPP_INFO(logger_, "Bag closed, pushed: %lu written: %lu dropped: %lu", pushed(), written(), dropped());
+    }
+
+    bool BagRecorder::isOpen() const
+    {
+        return is_open_;
+    }
+
+    void BagRecorder::createTopic(const std::string& topic_name, const std::string& topic_type)
+    {
+        if (writer_ == nullptr)
+            return;
+
+        writer_->create_topic({
+            topic_name,
+            topic_type,
+            rmw_get_serialization_format(),
+            ""
+        });
+    }
+
+    /**
+     * @brief 生产者取槽位：优先取空闲槽位，否则覆盖最旧的待写入槽位
+     */
+    BagRecorder::RecordSlot* BagRecorder::acquireSlot()
+    {
+        for (int ii = 0; ii < slot_num_; ++ii)
+        {
+            int expected = SLOT_FREE;
+            if (slots_[ii].state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acq_rel))
+                return &slots_[ii];
+        }
+
+        // 队列已满，丢弃最旧的一条(与写线程竞争时重试)
+        for (int retry = 0; retry < slot_num_; ++retry)
+        {
+            RecordSlot* oldest = nullptr;
+            uint64_t oldest_seq = UINT64_MAX;
+            for (int ii = 0; ii < slot_num_; ++ii)
+            {
+                if (slots_[ii].state.load(std::memory_order_acquire) != SLOT_READY)
+                    continue;
+                uint64_t seq = slots_[ii].seq.load(std::memory_order_relaxed);
+                if (seq < oldest_seq)
+                {
+                    oldest_seq = seq;
+                    oldest = &slots_[ii];
+                }
+            }
+            if (oldest == nullptr)
+                return nullptr;
+
+            int expected = SLOT_READY;
+            if (oldest->state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acq_rel))
+            {
+                ++dropped_;
+                return oldest;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 写线程取出最旧的待写入槽位
+     */
+    BagRecorder::RecordSlot* BagRecorder::takeOldest()
+    {
+        while (true)
+        {
+            RecordSlot* oldest = nullptr;
+            uint64_t oldest_seq = UINT64_MAX;
+            for (int ii = 0; ii < slot_num_; ++ii)
+            {
+                if (slots_[ii].state.load(std::memory_order_acquire) != SLOT_READY)
+                    continue;
+                uint64_t seq = slots_[ii].seq.load(std::memory_order_relaxed);
+                if (seq < oldest_seq)
+                {
+                    oldest_seq = seq;
+                    oldest = &slots_[ii];
+                }
+            }
+            if (oldest == nullptr)
+                return nullptr;
+
+            int expected = SLOT_READY;
+            if (oldest->state.compare_exchange_strong(expected, SLOT_READING, std::memory_order_acq_rel))
+            {   //扫描后该槽位可能已被生产者覆盖为更新的消息，此时放回并重新查找，保证按序写盘
+                if (oldest->seq.load(std::memory_order_relaxed) == oldest_seq)
+                    return oldest;
+                oldest->state.store(SLOT_READY, std::memory_order_release);
+            }
+        }
+    }
+
+    void BagRecorder::writeSlot(RecordSlot* slot)
+    {
+        slot->serialize(slot->msg.get(), serialized_msg_);
+        slot->msg.reset();
+
+        const rcl_serialized_message_t& serialized = serialized_msg_.get_rcl_serialized_message();
+        auto bag_msg = std::make_shared<rosbag2_storage::SerializedBagMessage>();
+        bag_msg->serialized_data = std::shared_ptr<rcutils_uint8_array_t>(
+            new rcutils_uint8_array_t,
+            [this](rcutils_uint8_array_t* msg)
+            {
+                if (rcutils_uint8_array_fini(msg) != RCUTILS_RET_OK)
+                {
+                    RCLCPP_ERROR(logger_, "RCUTILS_RET_INVALID_ARGUMENT OR RCUTILS_RET_ERROR");
+                }
+                delete msg;
+            }
+        );
+        *bag_msg->serialized_data = rcutils_get_zero_initialized_uint8_array();
+        rcutils_allocator_t allocator = rcutils_get_default_allocator();
+        if (rcutils_uint8_array_init(bag_msg->serialized_data.get(), serialized.buffer_length, &allocator) != RCUTILS_RET_OK)
+        {
+            RCLCPP_ERROR(logger_, "Allocate bag message failed!");
+            return;
+        }
+        memcpy(bag_msg->serialized_data->buffer, serialized.buffer, serialized.buffer_length);
+        bag_msg->serialized_data->buffer_length = serialized.buffer_length;
+        bag_msg->topic_name = slot->topic_name;
+        bag_msg->time_stamp = slot->time_stamp;
+
+        try
+        {
+            writer_->write(bag_msg);
+            ++written_;
+        }
+        catch(const std::exception& e)
+        {
+            RCLCPP_ERROR_ONCE(logger_, "Write bag failed: %s", e.what());
+        }
+    }
+
+    /**
+     * @brief 写线程：等待生产者提交，按入队顺序序列化并写盘，关闭时写完剩余消息后退出
+     */
+    void BagRecorder::writerThread()
+    {
+        bool is_running = true;
+        while (is_running)
+        {
+            while (sem_wait(&ready_sem_) != 0 && errno == EINTR)
+                continue;
+
+            // 先读取运行标志再取消息：close()置位前提交的消息在本轮必定可见
+            is_running = is_running_.load();
+            RecordSlot* slot = nullptr;
+            while ((slot = takeOldest()) != nullptr)
+            {
+                writeSlot(slot);
+                slot->state.store(SLOT_FREE, std::memory_order_release);
+            }
+        }
+    }
+} //namespace camera_driver
@@ -0,0 +1,158 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-11 14:32:08
+ * @LastEditTime: 2023-06-11 14:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/camera_driver/clock_sync.cpp
+ */
+#include "../../include/camera_driver/clock_sync.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace camera_driver
+{
+    // 残差超过该值视为时钟跳变(ns)
+    static constexpr double MAX_RESIDUAL_NS = 5e7;
+    // 设备相对时间超过该值时平移参考点，避免统计量数值过大(ns)
+    static constexpr double REBASE_INTERVAL_NS = 1e10;
+    static constexpr int MIN_CONVERGED_SAMPLES = 20;
+
+    ClockSync::ClockSync(double tick_freq, int window_size, double forget_factor)
+    : tick_freq_(tick_freq), window_size_(std::max(window_size, 1)), forget_factor_(forget_factor)
+    {
+        reset();
+    }
+
+    void ClockSync::reset()
+    {
+        is_initialized_ = false;
+        sample_cnt_ = 0;
+        device_ticks0_ = 0;
+        host_ns0_ = 0;
+        last_device_ticks_ = 0;
+        x_base_ = 0.0;
+
+        sum_w_ = sum_x_ = sum_y_ = sum_xx_ = sum_xy_ = 0.0;
+        offset_ = 0.0;
+        drift_ = 0.0;
+
+        window_x_.assign(window_size_, 0.0);
+        window_y_.assign(window_size_, 0.0);
+        window_idx_ = 0;
+        envelope_ = 0.0;
+        last_delay_ = 0.0;
+    }
+
+    void ClockSync::setTickFrequency(double tick_freq)
+    {
+        if (tick_freq > 0.0 && tick_freq != tick_freq_)
+        {
+            tick_freq_ = tick_freq;
+            reset();
+        }
+    }
+
+    double ClockSync::tickToNs(uint64_t device_ticks) const
+    {
+        return (double)(device_ticks - device_ticks0_) * 1e9 / tick_freq_ - x_base_;
+    }
+
+    double ClockSync::fitOffset(double x) const
+    {
+        return offset_ + drift_ * x;
+    }
+
+    int64_t ClockSync::update(uint64_t device_ticks, int64_t host_ns)
+    {
+        if (is_initialized_ && device_ticks <= last_device_ticks_)
+        {   // 设备时间回退(相机重连/复位)
+            reset();
+        }
+
+        if (!is_initialized_)
+        {
+            device_ticks0_ = device_ticks;
+            host_ns0_ = host_ns;
+            is_initialized_ = true;
+        }
+        last_device_ticks_ = device_ticks;
+
+        double x = tickToNs(device_ticks);
+        if (x > REBASE_INTERVAL_NS)
+        {   // 平移参考点：x' = x - c，y保持不变
+            double c = x;
+            sum_xx_ = sum_xx_ - 2.0 * c * sum_x_ + c * c * sum_w_;
+            sum_xy_ = sum_xy_ - c * sum_y_;
+            sum_x_ = sum_x_ - c * sum_w_;
+            offset_ = offset_ + drift_ * c;
+            for (auto& wx : window_x_)
+                wx -= c;
+            x_base_ += c;
+            x = 0.0;
+        }
+        double y = (double)(host_ns - host_ns0_) - x_base_ - x;
+
+        if (sample_cnt_ >= MIN_CONVERGED_SAMPLES && std::fabs(y - fitOffset(x) - envelope_) > MAX_RESIDUAL_NS)
+        {   // 残差异常，以当前观测为起点重新拟合
+            reset();
+            return update(device_ticks, host_ns);
+        }
+
+        // 带遗忘因子的加权最小二乘
+        sum_w_ = forget_factor_ * sum_w_ + 1.0;
+        sum_x_ = forget_factor_ * sum_x_ + x;
+        sum_y_ = forget_factor_ * sum_y_ + y;
+        sum_xx_ = forget_factor_ * sum_xx_ + x * x;
+        sum_xy_ = forget_factor_ * sum_xy_ + x * y;
+        ++sample_cnt_;
+
+        double det = sum_w_ * sum_xx_ - sum_x_ * sum_x_;
+        if (sample_cnt_ >= 2 && det > 1e-9 * sum_w_ * sum_xx_)
+        {
+            drift_ = (sum_w_ * sum_xy_ - sum_x_ * sum_y_) / det;
+            offset_ = (sum_y_ - drift_ * sum_x_) / sum_w_;
+        }
+        else
+        {
+            drift_ = 0.0;
+            offset_ = sum_y_ / sum_w_;
+        }
+
+        // 下包络：窗口内相对拟合直线的最小残差
+        window_x_[window_idx_] = x;
+        window_y_[window_idx_] = y;
+        window_idx_ = (window_idx_ + 1) % window_size_;
+        int valid_cnt = std::min(sample_cnt_, window_size_);
+        envelope_ = std::numeric_limits<double>::max();
+        for (int ii = 0; ii < valid_cnt; ++ii)
+        {
+            envelope_ = std::min(envelope_, window_y_[ii] - fitOffset(window_x_[ii]));
+        }
+        last_delay_ = y - fitOffset(x) - envelope_;
+
+        return toHost(device_ticks);
+    }
+
+    int64_t ClockSync::toHost(uint64_t device_ticks) const
+    {
+        double x = tickToNs(device_ticks);
+        return host_ns0_ + (int64_t)std::llround(x_base_ + x + fitOffset(x) + envelope_);
+    }
+
+    bool ClockSync::isConverged() const
+    {
+        return sample_cnt_ >= MIN_CONVERGED_SAMPLES;
+    }
+
+    double ClockSync::getDriftPpm() const
+    {
+        return drift_ * 1e6;
+    }
+
+    double ClockSync::getLastDelay() const
+    {
+        return last_delay_;
+    }
+} //namespace camera_driver
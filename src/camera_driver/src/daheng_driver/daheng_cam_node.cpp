@@ -43,6 +43,7 @@ namespace camera_driver
         {
         case 0:
             this->cam_driver_->setExposureTime(param.as_int());
+            this->exposure_time_ = param.as_int();
             RCLCPP_INFO(this->get_logger(), "Set daheng camera exposure time: %ldus", param.as_int());
             break;
         case 1:
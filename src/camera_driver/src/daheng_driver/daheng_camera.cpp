@@ -56,6 +56,9 @@ namespace camera_driver
     bool DaHengCam::init()
     {
         is_initialized_ = false;
+        lastImgTimestamp = 0;
+        lastHostTimestamp = 0;
+        lastFrameOffset = cv::Point2i(0, 0);
         //初始化库
         status = GXInitLib();
 
@@ -71,7 +74,17 @@ namespace camera_driver
     bool DaHengCam::close()
     {
         //停 采
-        status = GXStreamOff(hDevice);
+        if (frame_queue_ != nullptr)
+        {   //回调模式下不允许调用GXStreamOff
+            status = GXSendCommand(hDevice, GX_COMMAND_ACQUISITION_STOP);
+            if(status != GX_STATUS_SUCCESS)
+                return false;
+            status = GXUnregisterCaptureCallback(hDevice);
+        }
+        else
+        {
+            status = GXStreamOff(hDevice);
+        }
         if(status != GX_STATUS_SUCCESS)
             return false;
         
@@ -118,6 +131,15 @@ namespace camera_driver
         {
             RCLCPP_ERROR(logger_, "Export Config File Failed! Error: [%d]", status);
         }
+
+        // 记录配置文件中的采集窗口，硬件ROI均以该窗口为全幅
+        int64_t offset_x = 0, offset_y = 0, width = 0, height = 0;
+        GXGetInt(hDevice, GX_INT_OFFSET_X, &offset_x);
+        GXGetInt(hDevice, GX_INT_OFFSET_Y, &offset_y);
+        GXGetInt(hDevice, GX_INT_WIDTH, &width);
+        GXGetInt(hDevice, GX_INT_HEIGHT, &height);
+        base_roi_ = cv::Rect((int)offset_x, (int)offset_y, (int)width, (int)height);
+        roi_ = cv::Rect(0, 0, (int)width, (int)height);
         
         // // 设置分辨率
         // if(!setResolution(cam_param_.width_scale, cam_param_.height_scale))
@@ -281,7 +303,20 @@ namespace camera_driver
         }
 
         //开 采
-        status = GXStreamOn(hDevice);
+        if (frame_queue_ != nullptr)
+        {   //推流模式:注册采集回调,由SDK线程推送图像
+            status = GXRegisterCaptureCallback(hDevice, this, onFrameCallback);
+            if (status != GX_STATUS_SUCCESS)
+            {
+                RCLCPP_ERROR(logger_, "注册采集回调失败! Error: [%d]", status);
+                return false;
+            }
+            status = GXSendCommand(hDevice, GX_COMMAND_ACQUISITION_START);
+        }
+        else
+        {
+            status = GXStreamOn(hDevice);
+        }
         if (status == GX_STATUS_SUCCESS)
         {
             RCLCPP_INFO(logger_, "开始采集图像!");
@@ -293,42 +328,6 @@ namespace camera_driver
             return false;
         }
     }
-    /**
-     * @brief DaHengCam::UpdateTimestamp 进行一次采图，更新时间戳
-     * @param Src 引入方式传递
-     * @return bool 返回是否成功
-     */
-    bool DaHengCam::updateTimestampOffset(std::chrono::_V2::steady_clock::time_point time_start)
-    {
-        //清空缓冲队列
-        int64_t nPayLoadSize = 0;
-        //获 取 图 像 buffer 大 小 , 下 面 动 态 申 请 内 存
-        status = GXGetInt(hDevice, GX_INT_PAYLOAD_SIZE, &nPayLoadSize);
-        if (status == GX_STATUS_SUCCESS && nPayLoadSize > 0)
-        {
-            //定 义 GXGetImage 的 传 入 参 数
-            GX_FRAME_DATA stFrameData;
-            //根 据 获 取 的 图 像 buffer 大 小 m_nPayLoadSize 申 请 buffer
-            stFrameData.pImgBuf = malloc((size_t)nPayLoadSize);
-
-            //发 送 开 始 采 集 命 令
-            int64_t nAcqMode = GX_ACQ_MODE_SINGLE_FRAME;
-            status = GXSetEnum(hDevice, GX_ENUM_ACQUISITION_MODE, nAcqMode);
-            status = GXSendCommand(hDevice, GX_COMMAND_ACQUISITION_START);
-            if (status == GX_STATUS_SUCCESS)
-            {
-                //调 用 GXGetImage 取 一 帧 图 像
-                status = GXGetImage(hDevice, &stFrameData, 100);
-                auto time_cam_end = std::chrono::steady_clock::now();
-                lastImgTimestamp = stFrameData.nTimestamp;
-                int program_timestamp = (int)std::chrono::duration<double,std::milli>(time_cam_end - time_start).count();
-                int cam_timestamp = getTimestamp();
-                timestamp_offset = cam_timestamp - program_timestamp;
-                return true;
-            }
-        }
-        return false;
-    }
 
     /**
      * @brief DaHengCam::GetMat 读取图像
@@ -341,39 +340,37 @@ namespace camera_driver
         status = GXDQBuf(hDevice, &pFrameBuffer, 1000);
         if (status == GX_STATUS_SUCCESS && pFrameBuffer->nStatus == GX_FRAME_STATUS_SUCCESS)
         {
-            // if (!is_initialized_)
-            // {
-            //     lastImgTimestamp = pFrameBuffer->nTimestamp;
-            //     is_initialized_ = true;
-            // }
-            // else
-            // {
-            //     uint64_t t = pFrameBuffer->nTimestamp;
-            //     cout << "delay:" << ((t - lastImgTimestamp) / 125000000.0) * 1000 << "ms" << endl;
-            //     lastImgTimestamp = t;
-            // }
+            // 记录硬件时间戳与出队时刻，供时钟同步使用(在Bayer转换之前取主机时间)
+            lastHostTimestamp = FrameQueue::steadyNowNs();
+            lastImgTimestamp = pFrameBuffer->nTimestamp;
+            lastFrameOffset = cv::Point2i(pFrameBuffer->nOffsetX - base_roi_.x, pFrameBuffer->nOffsetY - base_roi_.y);
 
-            char *pRGB24Buf = new char[pFrameBuffer->nWidth * pFrameBuffer->nHeight * 3]; //输 出 图 像 RGB 数 据
-            if (pRGB24Buf == NULL)
-                return false;
-            // else //缓 冲 区 初 始 化
-            //     memset(pRGB24Buf, 0, pFrameBuffer->nWidth * pFrameBuffer->nHeight * 3 * sizeof(char));
+            // 直接将Bayer转换结果写入消息缓冲区，消息对象复用，仅在分辨率变化时重新分配
+            int channels = raw_bayer_ ? 1 : 3;
+            size_t frame_size = (size_t)pFrameBuffer->nWidth * pFrameBuffer->nHeight * channels;
+            if (image_msg.data.size() != frame_size)
+                image_msg.data.resize(frame_size);
 
-            DX_BAYER_CONVERT_TYPE cvtype = RAW2RGB_NEIGHBOUR3; //选 择 插 值 算 法
-            DX_PIXEL_COLOR_FILTER nBayerType = DX_PIXEL_COLOR_FILTER(BAYERBG);
-            //选 择 图 像 Bayer 格 式
-            bool bFlip = false;
-
-            VxInt32 DxStatus = DxRaw8toRGB24(pFrameBuffer->pImgBuf, pRGB24Buf, pFrameBuffer->nWidth, pFrameBuffer->nHeight, cvtype, nBayerType, bFlip);
-            if (DxStatus != DX_OK)
+            if (raw_bayer_)
+            {   // 原始Bayer数据直接发布，去马赛克推迟到检测节点
+                memcpy(image_msg.data.data(), pFrameBuffer->pImgBuf, frame_size);
+            }
+            else
             {
-                RCLCPP_ERROR(logger_, "Raw8 to RGB24 failed!");
-                if (pRGB24Buf != NULL)
+                char *pRGB24Buf = reinterpret_cast<char*>(image_msg.data.data()); //输 出 图 像 RGB 数 据
+
+                DX_BAYER_CONVERT_TYPE cvtype = RAW2RGB_NEIGHBOUR3; //选 择 插 值 算 法
+                DX_PIXEL_COLOR_FILTER nBayerType = DX_PIXEL_COLOR_FILTER(BAYERBG);
+                //选 择 图 像 Bayer 格 式
+                bool bFlip = false;
+
+                VxInt32 DxStatus = DxRaw8toRGB24(pFrameBuffer->pImgBuf, pRGB24Buf, pFrameBuffer->nWidth, pFrameBuffer->nHeight, cvtype, nBayerType, bFlip);
+                if (DxStatus != DX_OK)
                 {
-                    delete[] pRGB24Buf;
-                    pRGB24Buf = NULL;
+                    RCLCPP_ERROR(logger_, "Raw8 to RGB24 failed!");
+                    status = GXQBuf(hDevice, pFrameBuffer);
+                    return false;
                 }
-                return false;
             }
 
             // if (set_contrast)
@@ -397,15 +394,11 @@ namespace camera_driver
             //         cout << "Saturation Set Failed" <<endl;
             // }
 
-            Src = Mat(pFrameBuffer->nHeight, pFrameBuffer->nWidth, CV_8UC3);
-            memcpy(Src.data, pRGB24Buf, pFrameBuffer->nWidth * pFrameBuffer->nHeight * 3);
-            // src.copyTo(Src);
+            // Src仅为消息缓冲区的头部，不发生拷贝
+            Src = Mat(pFrameBuffer->nHeight, pFrameBuffer->nWidth, CV_8UC(channels), image_msg.data.data());
             image_msg.step = static_cast<sensor_msgs::msg::Image::_step_type>(Src.step);  
             image_msg.is_bigendian = false;
-            image_msg.data.assign(Src.datastart, Src.dataend);
 
-            delete[] pRGB24Buf;
-            pRGB24Buf = NULL;
             // //调 用 GXQBuf 将 图 像 buf 放 回 库 中 继 续 采 图
             status = GXQBuf(hDevice, pFrameBuffer);
             return true;
@@ -418,6 +411,175 @@ namespace camera_driver
         }
     }
 
+    /**
+     * @brief 设置是否输出原始Bayer图像(BayerBG8，对应ROS编码bayer_bggr8)，不再在驱动中做去马赛克
+     */
+    bool DaHengCam::setRawBayer(bool raw_bayer)
+    {
+        raw_bayer_ = raw_bayer;
+        return true;
+    }
+
+    /**
+     * @brief 设置推流模式帧队列，open()时据此选择注册采集回调或GXDQBuf轮询
+     * @param frame_queue 帧队列，为空时恢复轮询模式
+     */
+    bool DaHengCam::setFrameQueue(FrameQueue* frame_queue)
+    {
+        frame_queue_ = frame_queue;
+        return true;
+    }
+
+    /**
+     * @brief 采集回调，运行在SDK采集线程中
+     * 直接在SDK线程内完成Bayer转换，写入帧队列的预分配帧后推送给发布线程
+     */
+    void GX_STDC DaHengCam::onFrameCallback(GX_FRAME_CALLBACK_PARAM* pFrame)
+    {
+        int64_t host_timestamp_ns = FrameQueue::steadyNowNs();
+        DaHengCam* cam = static_cast<DaHengCam*>(pFrame->pUserParam);
+        if (cam == nullptr || cam->frame_queue_ == nullptr || pFrame->status != GX_FRAME_STATUS_SUCCESS)
+            return;
+
+        // 发布线程处理不过来时直接丢弃该帧
+        CameraFrame* frame = cam->frame_queue_->acquire();
+        if (frame == nullptr)
+            return;
+
+        int channels = cam->raw_bayer_ ? 1 : 3;
+        size_t frame_size = (size_t)pFrame->nWidth * pFrame->nHeight * channels;
+        if (frame->data.size() != frame_size)
+            frame->data.resize(frame_size);
+
+        if (cam->raw_bayer_)
+        {
+            memcpy(frame->data.data(), pFrame->pImgBuf, frame_size);
+        }
+        else
+        {
+            VxInt32 DxStatus = DxRaw8toRGB24(
+                const_cast<void*>(pFrame->pImgBuf),
+                frame->data.data(),
+                pFrame->nWidth,
+                pFrame->nHeight,
+                RAW2RGB_NEIGHBOUR3,
+                DX_PIXEL_COLOR_FILTER(BAYERBG),
+                false
+            );
+            if (DxStatus != DX_OK)
+            {
+                RCLCPP_ERROR_ONCE(cam->logger_, "Raw8 to RGB24 failed!");
+                cam->frame_queue_->abort(frame);
+                return;
+            }
+        }
+
+        frame->width = pFrame->nWidth;
+        frame->channels = channels;
+        frame->height = pFrame->nHeight;
+        frame->frame_id = pFrame->nFrameID;
+        frame->device_timestamp = pFrame->nTimestamp;
+        frame->host_timestamp_ns = host_timestamp_ns;
+        frame->offset_x = pFrame->nOffsetX - cam->base_roi_.x;
+        frame->offset_y = pFrame->nOffsetY - cam->base_roi_.y;
+        cam->frame_queue_->commit(frame);
+    }
+
+    /**
+     * @brief 开始/停止采集，推流模式下同时注册/注销采集回调
+     */
+    bool DaHengCam::setAcquisition(bool is_on)
+    {
+        if (frame_queue_ != nullptr)
+        {
+            if (is_on)
+            {
+                status = GXRegisterCaptureCallback(hDevice, this, onFrameCallback);
+                if (status == GX_STATUS_SUCCESS)
+                    status = GXSendCommand(hDevice, GX_COMMAND_ACQUISITION_START);
+            }
+            else
+            {
+                status = GXSendCommand(hDevice, GX_COMMAND_ACQUISITION_STOP);
+                if (status == GX_STATUS_SUCCESS)
+                    status = GXUnregisterCaptureCallback(hDevice);
+            }
+        }
+        else
+        {
+            status = is_on ? GXStreamOn(hDevice) : GXStreamOff(hDevice);
+        }
+        return status == GX_STATUS_SUCCESS;
+    }
+
+    /**
+     * @brief 设置相机硬件ROI，坐标相对于配置文件中的采集窗口，宽高为0时恢复全幅
+     * 仅平移时在采集过程中直接修改偏移；宽高变化需停止采集后修改
+     * @param roi 硬件ROI，需满足相机的步长要求(调用方按32像素对齐)
+     * @return bool 返回是否设置成功
+     */
+    bool DaHengCam::setRoi(const cv::Rect& roi)
+    {
+        cv::Rect full_roi(0, 0, base_roi_.width, base_roi_.height);
+        cv::Rect target = (roi.area() > 0) ? (roi & full_roi) : full_roi;
+        if (target.area() == 0)
+            return false;
+        if (target == roi_)
+            return true;
+
+        bool is_resize = (target.size() != roi_.size());
+        if (is_resize && !setAcquisition(false))
+        {
+            RCLCPP_ERROR(logger_, "Stop acquisition failed! Error: [%d]", status);
+            return false;
+        }
+
+        bool is_success = true;
+        if (is_resize)
+        {   //先将偏移移至窗口原点，保证任意宽高均合法
+            is_success &= (GXSetInt(hDevice, GX_INT_OFFSET_X, base_roi_.x) == GX_STATUS_SUCCESS);
+            is_success &= (GXSetInt(hDevice, GX_INT_OFFSET_Y, base_roi_.y) == GX_STATUS_SUCCESS);
+            is_success &= (GXSetInt(hDevice, GX_INT_WIDTH, target.width) == GX_STATUS_SUCCESS);
+            is_success &= (GXSetInt(hDevice, GX_INT_HEIGHT, target.height) == GX_STATUS_SUCCESS);
+        }
+        is_success &= (GXSetInt(hDevice, GX_INT_OFFSET_X, base_roi_.x + target.x) == GX_STATUS_SUCCESS);
+        is_success &= (GXSetInt(hDevice, GX_INT_OFFSET_Y, base_roi_.y + target.y) == GX_STATUS_SUCCESS);
+        
+        if (is_success)
+        {
+            roi_ = target;
+        }
+        else
+        {   //状态未知，下次强制重新设置
+            RCLCPP_ERROR(logger_, "Set roi (%d, %d, %d, %d) failed!", target.x, target.y, target.width, target.height);
+            roi_ = cv::Rect();
+        }
+
+        if (is_resize && !setAcquisition(true))
+        {
+            RCLCPP_ERROR(logger_, "Restart acquisition failed! Error: [%d]", status);
+            return false;
+        }
+        return is_success;
+    }
+
+    /**
+     * @brief 全幅尺寸，即配置文件中的采集窗口
+     */
+    cv::Size DaHengCam::getSensorSize()
+    {
+        return base_roi_.size();
+    }
+
+    /**
+     * @brief 最近一帧在全幅图像中的偏移(轮询模式)
+     */
+    bool DaHengCam::getFrameOffset(cv::Point2i& offset)
+    {
+        offset = lastFrameOffset;
+        return true;
+    }
+
     /**
      * @brief DaHengCam::SetResolution   设置分辨率
      * @param width_scale   宽比例
@@ -699,14 +861,21 @@ namespace camera_driver
     }
 
     /**
-     * @brief DaHengCam::Get_TIMESTAMP   得到时间戳锁存值
-     *                  还有问题没解决，可能是不支持此功能
-     * @return _time 单位ms
+     * @brief DaHengCam::getFrameTimestamp 得到最近一帧的硬件时间戳(帧信息中的nTimestamp)
+     * @param device_timestamp 相机时间戳，单位tick
+     * @param host_timestamp_ns 主机取到该帧时的steady时间，单位ns
+     * @return bool 是否已有有效时间戳
      */
-    int DaHengCam::getTimestamp()
+    bool DaHengCam::getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns)
+    {
+        device_timestamp = (uint64_t)lastImgTimestamp;
+        host_timestamp_ns = lastHostTimestamp;
+        return lastImgTimestamp > 0;
+    }
+
+    double DaHengCam::getTimestampFrequency()
     {
         //更新频率为125000000Hz
-        int _time = ((double)lastImgTimestamp / (1.25 * 1e6)) - timestamp_offset;
-        return _time;
+        return 125e6;
     }
 } //camera_driver
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 17:40:26
+ * @LastEditTime: 2023-06-10 17:40:26
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/fake_driver/fake_cam_node.cpp
+ */
+#include "../../include/fake_driver/fake_cam_node.hpp"
+
+namespace camera_driver
+{
+    FakeCamNode::FakeCamNode(const rclcpp::NodeOptions &options)
+    : CameraBaseNode<FakeCam>("fake_driver", options)
+    {
+        bool debug = false;
+        this->declare_parameter<bool>("debug", false);
+        this->get_parameter("debug", debug);
+        if(debug)
+        {
+            RCLCPP_INFO(this->get_logger(), "Fake camera debug...");
+
+            //动态调参回调
+            callback_handle_ = this->add_on_set_parameters_callback(std::bind(&FakeCamNode::paramsCallback, this, _1));
+        }
+    }
+
+    FakeCamNode::~FakeCamNode()
+    {
+    }
+
+    bool FakeCamNode::setParam(rclcpp::Parameter param)
+    {
+        auto param_idx = param_map_[param.get_name()];
+        switch (param_idx)
+        {
+        case 0:
+            this->cam_driver_->setExposureTime(param.as_int());
+            this->exposure_time_ = param.as_int();
+            RCLCPP_INFO(this->get_logger(), "Set fake camera exposure time: %ldus", param.as_int());
+            break;
+        default:
+            RCLCPP_WARN(this->get_logger(), "No relative param to set...");
+            break;
+        }
+        return true;
+    }
+
+    rcl_interfaces::msg::SetParametersResult FakeCamNode::paramsCallback(const std::vector<rclcpp::Parameter>& params)
+    {
+        rcl_interfaces::msg::SetParametersResult result;
+        result.successful = false;
+        result.reason = "debug";
+        for(const auto& param : params)
+        {
+            result.successful = setParam(param);
+        }
+        return result;
+    }
+} //namespace camera_driver
+
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(camera_driver::FakeCamNode)
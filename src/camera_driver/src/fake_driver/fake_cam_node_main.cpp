@@ -0,0 +1,17 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 17:40:26
+ * @LastEditTime: 2023-06-10 17:40:26
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/fake_driver/fake_cam_node_main.cpp
+ */
+#include "../../include/fake_driver/fake_cam_node.hpp"
+
+int main(int argc, char** argv)
+{
+    rclcpp::init(argc, argv);
+    rclcpp::spin(std::make_shared<camera_driver::FakeCamNode>());
+    rclcpp::shutdown();
+    
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-10 17:05:12
+ * @LastEditTime: 2023-06-10 17:05:12
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/fake_driver/fake_camera.cpp
+ */
+#include "../../include/fake_driver/fake_camera.hpp"
+
+namespace camera_driver
+{
+    FakeCam::FakeCam()
+    : is_open_(false), logger_(rclcpp::get_logger("fake_driver"))
+    {
+        cam_param_.image_width = 1280;
+        cam_param_.image_height = 1024;
+        cam_param_.fps = 30;
+        cam_param_.exposure_time = 6000;
+        init();
+    }
+
+    FakeCam::FakeCam(const CameraParam& cam_params)
+    : is_open_(false), logger_(rclcpp::get_logger("fake_driver"))
+    {
+        this->cam_param_ = cam_params;
+        init();
+    }
+
+    FakeCam::~FakeCam()
+    {
+        close();
+    }
+
+    bool FakeCam::init()
+    {
+        width_ = cam_param_.image_width > 0 ? cam_param_.image_width : 1280;
+        height_ = cam_param_.image_height > 0 ? cam_param_.image_height : 1024;
+        // Bayer阵列按2x2排布，分辨率取偶数
+        width_ &= ~1;
+        height_ &= ~1;
+        int fps = cam_param_.fps > 0 ? cam_param_.fps : 30;
+        frame_interval_ = std::chrono::nanoseconds((int64_t)(1e9 / fps));
+        exposure_time_ = cam_param_.exposure_time;
+        frame_id_ = 0;
+        last_device_timestamp_ = 0;
+        last_host_timestamp_ns_ = 0;
+
+        bgr_scene_.create(height_, width_, CV_8UC3);
+        bayer_.create(height_, width_, CV_8UC1);
+        roi_ = cv::Rect(0, 0, width_, height_);
+        last_frame_offset_ = cv::Point2i(0, 0);
+        RCLCPP_INFO(logger_, "[FAKE CAMERA] %dx%d @ %dfps", width_, height_, fps);
+        return true;
+    }
+
+    bool FakeCam::open()
+    {
+        if (is_open_)
+            return true;
+
+        start_time_ = std::chrono::steady_clock::now();
+        next_frame_time_ = start_time_;
+        is_open_ = true;
+
+        if (frame_queue_ != nullptr)
+        {
+            capture_thread_ = std::thread(&FakeCam::captureThread, this);
+        }
+        return true;
+    }
+
+    bool FakeCam::close()
+    {
+        is_open_ = false;
+        if (capture_thread_.joinable())
+            capture_thread_.join();
+        return true;
+    }
+
+    bool FakeCam::setFrameQueue(FrameQueue* frame_queue)
+    {
+        frame_queue_ = frame_queue;
+        return true;
+    }
+
+    bool FakeCam::setRawBayer(bool raw_bayer)
+    {
+        raw_bayer_ = raw_bayer;
+        return true;
+    }
+
+    bool FakeCam::setRoi(const cv::Rect& roi)
+    {
+        cv::Rect full_roi(0, 0, width_, height_);
+        cv::Rect target = (roi.area() > 0) ? (roi & full_roi) : full_roi;
+        // 保持BGGR相位
+        target.x &= ~1;
+        target.y &= ~1;
+        target.width &= ~1;
+        target.height &= ~1;
+        if (target.area() == 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock(roi_mutex_);
+        roi_ = target;
+        return true;
+    }
+
+    cv::Rect FakeCam::getRoi()
+    {
+        std::lock_guard<std::mutex> lock(roi_mutex_);
+        return roi_;
+    }
+
+    cv::Size FakeCam::getSensorSize()
+    {
+        return cv::Size(width_, height_);
+    }
+
+    bool FakeCam::getFrameOffset(cv::Point2i& offset)
+    {
+        offset = last_frame_offset_;
+        return true;
+    }
+
+    bool FakeCam::setExposureTime(int exposure_time)
+    {
+        exposure_time_ = exposure_time;
+        return true;
+    }
+
+    bool FakeCam::setGain(int value, int exp_gain)
+    {
+        (void)value;
+        (void)exp_gain;
+        return true;
+    }
+
+    bool FakeCam::setBalance(int value, float value_number)
+    {
+        (void)value;
+        (void)value_number;
+        return true;
+    }
+
+    void FakeCam::waitNextFrame()
+    {
+        next_frame_time_ += frame_interval_;
+        auto now = std::chrono::steady_clock::now();
+        if (next_frame_time_ < now)
+        {   // 落后超过一帧时不追帧
+            next_frame_time_ = now;
+        }
+        std::this_thread::sleep_until(next_frame_time_);
+    }
+
+    /**
+     * @brief 生成合成图像：暗背景上一对左右往复运动的蓝色灯条，
+     * 先按BGGR阵列采样为单通道Bayer图，再插值回BGR，走与真实相机一致的转换路径；
+     * raw模式下直接输出Bayer图
+     *
+     * @param data 输出缓冲区，大小为roi面积*3(raw模式为roi面积)
+     * @param roi 输出区域
+     */
+    void FakeCam::renderFrame(uint8_t* data, const cv::Rect& roi)
+    {
+        double t = (double)frame_id_ * frame_interval_.count() / 1e9;
+        int cx = width_ / 2 + (int)(width_ * 0.3 * std::sin(CV_PI * t));
+        int cy = height_ / 2;
+        int brightness = std::min(255, 80 + exposure_time_ / 40);
+
+        bgr_scene_.setTo(cv::Scalar(20, 20, 20));
+        cv::Scalar light_color(brightness, std::min(255, brightness / 2 + 60), 40);
+        cv::rectangle(bgr_scene_, cv::Rect(cx - 70, cy - 30, 12, 60), light_color, cv::FILLED);
+        cv::rectangle(bgr_scene_, cv::Rect(cx + 58, cy - 30, 12, 60), light_color, cv::FILLED);
+
+        // BGGR: (偶,偶)=B (奇,奇)=R 其余为G
+        cv::Mat bayer = raw_bayer_ ? cv::Mat(roi.height, roi.width, CV_8UC1, data) : bayer_(cv::Rect(0, 0, roi.width, roi.height));
+        for (int row = 0; row < roi.height; ++row)
+        {
+            const uint8_t* scene_ptr = bgr_scene_.ptr<uint8_t>(row + roi.y) + roi.x * 3;
+            uint8_t* bayer_ptr = bayer.ptr<uint8_t>(row);
+            int odd_row = (row + roi.y) & 1;
+            for (int col = 0; col < roi.width; ++col)
+            {
+                int odd_col = (col + roi.x) & 1;
+                int channel = (odd_row == 0 && odd_col == 0) ? 0 : ((odd_row && odd_col) ? 2 : 1);
+                bayer_ptr[col] = scene_ptr[col * 3 + channel];
+            }
+        }
+
+        if (!raw_bayer_)
+        {   // OpenCV以第二行第二、三列命名Bayer格式，BGGR阵列对应COLOR_BayerRG2BGR
+            cv::Mat dst(roi.height, roi.width, CV_8UC3, data);
+            cv::cvtColor(bayer, dst, cv::COLOR_BayerRG2BGR);
+        }
+        ++frame_id_;
+    }
+
+    bool FakeCam::getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg)
+    {
+        if (!is_open_)
+            return false;
+
+        waitNextFrame();
+        last_host_timestamp_ns_ = FrameQueue::steadyNowNs();
+        last_device_timestamp_ = deviceTimestamp();
+
+        cv::Rect roi = getRoi();
+        int channels = raw_bayer_ ? 1 : 3;
+        size_t frame_size = (size_t)roi.area() * channels;
+        if (image_msg.data.size() != frame_size)
+            image_msg.data.resize(frame_size);
+        renderFrame(image_msg.data.data(), roi);
+        last_frame_offset_ = roi.tl();
+
+        src = cv::Mat(roi.height, roi.width, CV_8UC(channels), image_msg.data.data());
+        image_msg.step = static_cast<sensor_msgs::msg::Image::_step_type>(src.step);
+        image_msg.is_bigendian = false;
+        return true;
+    }
+
+    /**
+     * @brief 设备时间戳：相机启动后经过的时间，按125MHz计数，并叠加50ppm的时钟漂移
+     */
+    uint64_t FakeCam::deviceTimestamp() const
+    {
+        double elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next_frame_time_ - start_time_).count();
+        return 1 + (uint64_t)(elapsed_ns * (1.0 + 50e-6) * TICK_FREQ / 1e9);
+    }
+
+    bool FakeCam::getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns)
+    {
+        device_timestamp = last_device_timestamp_;
+        host_timestamp_ns = last_host_timestamp_ns_;
+        return last_device_timestamp_ > 0;
+    }
+
+    double FakeCam::getTimestampFrequency()
+    {
+        return TICK_FREQ;
+    }
+
+    /**
+     * @brief 模拟SDK回调线程：按帧率生成图像并推入帧队列，队列满时丢帧
+     */
+    void FakeCam::captureThread()
+    {
+        int channels = raw_bayer_ ? 1 : 3;
+        while (is_open_)
+        {
+            waitNextFrame();
+            int64_t host_timestamp_ns = FrameQueue::steadyNowNs();
+
+            CameraFrame* frame = frame_queue_->acquire();
+            if (frame == nullptr)
+            {
+                ++frame_id_;
+                continue;
+            }
+
+            cv::Rect roi = getRoi();
+            size_t frame_size = (size_t)roi.area() * channels;
+            if (frame->data.size() != frame_size)
+                frame->data.resize(frame_size);
+            uint64_t frame_id = frame_id_;
+            renderFrame(frame->data.data(), roi);
+
+            frame->width = roi.width;
+            frame->height = roi.height;
+            frame->channels = channels;
+            frame->offset_x = roi.x;
+            frame->offset_y = roi.y;
+            frame->frame_id = frame_id;
+            frame->device_timestamp = deviceTimestamp();
+            frame->host_timestamp_ns = host_timestamp_ns;
+            frame_queue_->commit(frame);
+        }
+    }
+} //namespace camera_driver
@@ -36,6 +36,7 @@ namespace camera_driver
         {
         case 0:
             cam_driver_->setExposureTime(param.as_double());
+            exposure_time_ = (int)param.as_double();
             break;
         case 1:
             cam_driver_->setGain(3, param.as_int());
@@ -43,6 +43,9 @@ namespace camera_driver
     bool HikCamera::init()
     {
         g_nPayloadSize = 0;
+        last_device_timestamp_ = 0;
+        last_host_timestamp_ns_ = 0;
+        timestamp_freq_ = 1e9;
         return true;
     }
 
@@ -54,8 +57,30 @@ namespace camera_driver
         startDevice(this->cam_param_.cam_id);
         // 设置分辨率
         setResolution(this->cam_param_.image_width, this->cam_param_.image_height);
-        // 更新时间戳，设置时间戳偏移量
-        updateTimestamp(time_start_);
+        // 记录当前采集窗口，硬件ROI均以该窗口为全幅
+        MVCC_INTVALUE_EX roi_value;
+        int64_t base_roi[4] = {0, 0, this->cam_param_.image_width, this->cam_param_.image_height};
+        const char* roi_keys[4] = {"OffsetX", "OffsetY", "Width", "Height"};
+        for (int ii = 0; ii < 4; ++ii)
+        {
+            memset(&roi_value, 0, sizeof(MVCC_INTVALUE_EX));
+            if (MV_CC_GetIntValueEx(handle, roi_keys[ii], &roi_value) == MV_OK)
+                base_roi[ii] = roi_value.nCurValue;
+        }
+        base_roi_ = cv::Rect((int)base_roi[0], (int)base_roi[1], (int)base_roi[2], (int)base_roi[3]);
+        roi_ = cv::Rect(0, 0, base_roi_.width, base_roi_.height);
+        roi_offset_x_ = 0;
+        roi_offset_y_ = 0;
+        // ROI偏移随帧chunk数据输出，取流中修改偏移时可区分新旧帧
+        has_roi_chunk_ = enableRoiChunk();
+        // 获取时间戳频率(GigE相机支持)，标称值不准时由时钟同步模块的漂移项吸收
+        MVCC_INTVALUE_EX tick_freq;
+        memset(&tick_freq, 0, sizeof(MVCC_INTVALUE_EX));
+        nRet = MV_CC_GetIntValueEx(handle, "GevTimestampTickFrequency", &tick_freq);
+        if (MV_OK == nRet && tick_freq.nCurValue > 0)
+            timestamp_freq_ = (double)tick_freq.nCurValue;
+        else
+            RCLCPP_WARN(logger_, "Get timestamp tick frequency failed, use %.0fHz...", timestamp_freq_);
         // 开始采集帧
         setStreamOn();
         // 设置曝光事件
@@ -77,12 +102,20 @@ namespace camera_driver
 
     bool HikCamera::close() 
     {
+        if (frame_queue_ != nullptr)
+        {   // 停止取流，回调不再触发
+            nRet = MV_CC_StopGrabbing(handle);
+            if(nRet != MV_OK)
+                RCLCPP_ERROR(logger_, "Stop grabbing failed! nRet [%x]", nRet);
+        }
+
         nRet = MV_CC_FreeImageBuffer(handle, (&pFrame));
         if(nRet != MV_OK)
         {
             RCLCPP_ERROR(logger_, "Free image buffer failed!");
             return false;
         }
+        g_nPayloadSize = 0;
         return true;
     }
 
@@ -160,45 +193,266 @@ namespace camera_driver
         if(nRet != MV_OK)
             RCLCPP_ERROR(logger_, "SetEnumValue AcquisitionMode failed! nRet [%x]", nRet);
 
-        // //获取数据包大小
-        // MVCC_INTVALUE stParam;
-        // memset(&stParam, 0, sizeof(MVCC_INTVALUE));
-        // nRet = MV_CC_GetIntValue(handle, "PayloadSize", &stParam);
-        // if (MV_OK != nRet)
-        // {
-        //     printf("Get PayloadSize fail! nRet [0x%x]\n", nRet);
-        //     return false;
-        // }
-        // g_nPayloadSize = stParam.nCurValue;
+        //获取数据包大小
+        MVCC_INTVALUE stParam;
+        memset(&stParam, 0, sizeof(MVCC_INTVALUE));
+        nRet = MV_CC_GetIntValue(handle, "PayloadSize", &stParam);
+        if (MV_OK != nRet)
+        {
+            RCLCPP_ERROR(logger_, "Get PayloadSize fail! nRet [%x]", nRet);
+            return false;
+        }
+        g_nPayloadSize = stParam.nCurValue;
+
+        //据此申请帧缓冲环，已有足够容量的缓冲区保留(重连时不重复申请)
+        frame_buffer_ring_.resize(FRAME_BUFFER_NUM);
+        for (auto& frame_buffer : frame_buffer_ring_)
+        {
+            if (frame_buffer.capacity() < g_nPayloadSize)
+                frame_buffer.assign(g_nPayloadSize, 0);
+        }
+        frame_buffer_idx_ = 0;
+
+        //推流模式下注册图像回调，取代原先的WorkThread轮询线程
+        if (frame_queue_ != nullptr)
+        {
+            nRet = MV_CC_RegisterImageCallBackEx(handle, onFrameCallback, this);
+            if (MV_OK != nRet)
+            {
+                RCLCPP_ERROR(logger_, "Register image callback failed! nRet [%x]", nRet);
+                return false;
+            }
+        }
 
         //开始取流
         nRet = MV_CC_StartGrabbing(handle);
+        if (MV_OK != nRet)
+        {
+            RCLCPP_ERROR(logger_, "StartGrabbing failed! nRet [%x]", nRet);
+            return false;
+        }
 
         return true;
+    }
 
-        // nRetError(nRet, "[Camera] StartGrabbing failed! nRet [%x]\n", nRet);
+    /**
+     * @brief 设置相机硬件ROI，坐标相对于打开相机时的采集窗口，宽高为0时恢复全幅
+     * 宽高不变时在取流中直接写入偏移，帧的实际偏移由chunk数据给出；
+     * 宽高变化时需停止取流后修改，停止取流会清空SDK中的缓存帧，消息缓冲区在下一帧按新的宽高调整
+     */
+    bool HikCamera::setRoi(const cv::Rect& roi)
+    {
+        cv::Rect full_roi(0, 0, base_roi_.width, base_roi_.height);
+        cv::Rect target = (roi.area() > 0) ? (roi & full_roi) : full_roi;
+        if (target.area() == 0)
+            return false;
+        if (target == roi_)
+            return true;
 
-        //创建相机图像采集线程
-        // pthread_t tid;
-        // nRet = pthread_create(&tid, NULL, HikCamera::WorkThread, handle);
-        // if(MV_OK == nRet)
-        // {
-        //     printf("pthread_create succeed!\n");
-        //     return true;
-        // }
-        // else
-        // {
-        //     printf("pthread_create failed! nRet [%d]\n", nRet);
-        //     return false;
-        // }
+        if (target.size() == roi_.size())
+        {
+            bool is_moved = true;
+            is_moved &= (MV_CC_SetIntValue(handle, "OffsetX", base_roi_.x + target.x) == MV_OK);
+            is_moved &= (MV_CC_SetIntValue(handle, "OffsetY", base_roi_.y + target.y) == MV_OK);
+            if (is_moved)
+            {
+                if (!has_roi_chunk_)
+                    RCLCPP_WARN_ONCE(logger_, "Roi chunk is not supported, frames in flight keep the previous offset...");
+                roi_ = target;
+                roi_offset_x_ = target.x;
+                roi_offset_y_ = target.y;
+                return true;
+            }
+            RCLCPP_WARN(logger_, "Move roi while grabbing failed, restart grabbing...");
+        }
+
+        nRet = MV_CC_StopGrabbing(handle);
+        if (nRet != MV_OK)
+        {
+            RCLCPP_ERROR(logger_, "Stop grabbing failed! nRet [%x]", nRet);
+            return false;
+        }
+
+        //先将偏移移至窗口原点，保证任意宽高均合法
+        bool is_success = true;
+        is_success &= (MV_CC_SetIntValue(handle, "OffsetX", base_roi_.x) == MV_OK);
+        is_success &= (MV_CC_SetIntValue(handle, "OffsetY", base_roi_.y) == MV_OK);
+        is_success &= (MV_CC_SetIntValue(handle, "Width", target.width) == MV_OK);
+        is_success &= (MV_CC_SetIntValue(handle, "Height", target.height) == MV_OK);
+        is_success &= (MV_CC_SetIntValue(handle, "OffsetX", base_roi_.x + target.x) == MV_OK);
+        is_success &= (MV_CC_SetIntValue(handle, "OffsetY", base_roi_.y + target.y) == MV_OK);
+        if (is_success)
+        {
+            roi_ = target;
+            roi_offset_x_ = target.x;
+            roi_offset_y_ = target.y;
+        }
+        else
+        {   //状态未知，下次强制重新设置
+            RCLCPP_ERROR(logger_, "Set roi (%d, %d, %d, %d) failed!", target.x, target.y, target.width, target.height);
+            roi_ = cv::Rect();
+        }
+
+        nRet = MV_CC_StartGrabbing(handle);
+        if (nRet != MV_OK)
+        {
+            RCLCPP_ERROR(logger_, "StartGrabbing failed! nRet [%x]", nRet);
+            return false;
+        }
+        return is_success;
+    }
+
+    /**
+     * @brief 开启OffsetX/OffsetY的chunk输出，需在开始取流前调用
+     */
+    bool HikCamera::enableRoiChunk()
+    {
+        if (MV_CC_SetBoolValue(handle, "ChunkModeActive", true) != MV_OK)
+            return false;
+
+        const char* chunk_keys[2] = {"OffsetX", "OffsetY"};
+        for (int ii = 0; ii < 2; ++ii)
+        {
+            if (MV_CC_SetEnumValueByString(handle, "ChunkSelector", chunk_keys[ii]) != MV_OK ||
+                MV_CC_SetBoolValue(handle, "ChunkEnable", true) != MV_OK)
+            {
+                MV_CC_SetBoolValue(handle, "ChunkModeActive", false);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 帧在采集窗口中的偏移，优先使用帧自带的chunk数据
+     */
+    cv::Point2i HikCamera::frameOffset(const MV_FRAME_OUT_INFO_EX& frame_info)
+    {
+        if (has_roi_chunk_)
+            return cv::Point2i((int)frame_info.nOffsetX - base_roi_.x, (int)frame_info.nOffsetY - base_roi_.y);
+        return cv::Point2i(roi_offset_x_, roi_offset_y_);
+    }
+
+    cv::Size HikCamera::getSensorSize()
+    {
+        return base_roi_.size();
+    }
+
+    bool HikCamera::getFrameOffset(cv::Point2i& offset)
+    {   //最近一帧的偏移(轮询模式)
+        offset = last_frame_offset_;
+        return true;
+    }
+
+    /**
+     * @brief 设置是否输出原始Bayer数据，需在open()之前调用
+     * 像素格式在open()时按相机支持的格式协商，传感器非BGGR排布时退回BGR8
+     */
+    bool HikCamera::setRawBayer(bool raw_bayer)
+    {
+        raw_bayer_ = raw_bayer;
+        return true;
+    }
+
+    /**
+     * @brief 查询相机支持的像素格式，选取与传感器排布一致的8bit Bayer格式
+     * 下游按BGGR解析原始数据，其余排布不予输出
+     * @param pixel_format 选中的像素格式
+     * @return 是否找到BayerBG8
+     */
+    bool HikCamera::selectBayerFormat(unsigned int& pixel_format)
+    {
+        MVCC_ENUMVALUE pixel_formats;
+        memset(&pixel_formats, 0, sizeof(MVCC_ENUMVALUE));
+        nRet = MV_CC_GetEnumValue(handle, "PixelFormat", &pixel_formats);
+        if (nRet != MV_OK)
+        {
+            RCLCPP_ERROR(logger_, "Get PixelFormat failed! nRet [%x]", nRet);
+            return false;
+        }
+
+        const char* sensor_pattern = nullptr;
+        for (unsigned int ii = 0; ii < pixel_formats.nSupportedNum; ++ii)
+        {
+            switch (pixel_formats.nSupportValue[ii])
+            {
+            case PixelType_Gvsp_BayerBG8:
+                pixel_format = PixelType_Gvsp_BayerBG8;
+                return true;
+            case PixelType_Gvsp_BayerRG8:
+                sensor_pattern = "RGGB";
+                break;
+            case PixelType_Gvsp_BayerGB8:
+                sensor_pattern = "GBRG";
+                break;
+            case PixelType_Gvsp_BayerGR8:
+                sensor_pattern = "GRBG";
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (sensor_pattern != nullptr)
+            RCLCPP_ERROR(logger_, "Sensor bayer pattern is %s, raw output requires BGGR...", sensor_pattern);
+        else
+            RCLCPP_ERROR(logger_, "Camera has no 8bit bayer pixel format...");
+        return false;
+    }
+
+    bool HikCamera::setFrameQueue(FrameQueue* frame_queue)
+    {   //设置推流模式帧队列，需在open()之前调用
+        frame_queue_ = frame_queue;
+        return true;
+    }
+
+    void __stdcall HikCamera::onFrameCallback(unsigned char* pData, MV_FRAME_OUT_INFO_EX* pFrameInfo, void* pUser)
+    {   //图像回调，运行在SDK取流线程中，将BGR8或原始Bayer图像写入帧队列的预分配帧
+        int64_t host_timestamp_ns = FrameQueue::steadyNowNs();
+        HikCamera* cam = static_cast<HikCamera*>(pUser);
+        if (cam == nullptr || cam->frame_queue_ == nullptr || pData == nullptr || pFrameInfo == nullptr)
+            return;
+
+        // 发布线程处理不过来时直接丢弃该帧
+        CameraFrame* frame = cam->frame_queue_->acquire();
+        if (frame == nullptr)
+            return;
+
+        int channels = cam->raw_bayer_ ? 1 : 3;
+        size_t frame_size = (size_t)pFrameInfo->nWidth * pFrameInfo->nHeight * channels;
+        if (pFrameInfo->nFrameLen < frame_size)
+        {
+            RCLCPP_ERROR_ONCE(cam->logger_, "Unexpected frame length: %u", pFrameInfo->nFrameLen);
+            cam->frame_queue_->abort(frame);
+            return;
+        }
+        cam->prepareFrameBuffer(frame->data, frame_size);
+        memcpy(frame->data.data(), pData, frame_size);
+
+        frame->width = pFrameInfo->nWidth;
+        frame->channels = channels;
+        frame->height = pFrameInfo->nHeight;
+        frame->frame_id = pFrameInfo->nFrameNum;
+        frame->device_timestamp = ((uint64_t)pFrameInfo->nDevTimeStampHigh << 32) | pFrameInfo->nDevTimeStampLow;
+        cv::Point2i offset = cam->frameOffset(*pFrameInfo);
+        frame->offset_x = offset.x;
+        frame->offset_y = offset.y;
+        frame->host_timestamp_ns = host_timestamp_ns;
+        cam->frame_queue_->commit(frame);
     }
 
     bool HikCamera::setResolution(int width, int height)
     {   //TODO:分辨率根据相机采集上限设置，目前设置为1280*1024
         nRet = MV_OK;
 
-        //设置像素格式
-        nRet = MV_CC_SetPixelFormat(handle, PixelType_Gvsp_BGR8_Packed);
+        //设置像素格式，原始Bayer输出不可用时退回BGR8
+        unsigned int pixel_format = PixelType_Gvsp_BGR8_Packed;
+        if (raw_bayer_ && !selectBayerFormat(pixel_format))
+        {
+            RCLCPP_ERROR(logger_, "Raw bayer output is not available, fall back to bgr8...");
+            raw_bayer_ = false;
+        }
+        nRet = MV_CC_SetPixelFormat(handle, pixel_format);
         if(nRet != MV_OK)
         {
             RCLCPP_ERROR(logger_, "setPixelFormat failed! nRet [%x]", nRet);
@@ -348,58 +602,61 @@ namespace camera_driver
         return true;
     }
 
-    bool HikCamera::updateTimestamp(rclcpp::Time time_start)
-    {   //计算时间戳偏移
-        rclcpp::Time time_end = steady_clock_.now();
-        double time_span = (time_end - time_start).nanoseconds();
-        timestamp_offset_ = time_span / 1e9;
-        return true;
+    bool HikCamera::getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns)
+    {   //最近一帧的硬件时间戳及主机取到该帧的时刻
+        device_timestamp = last_device_timestamp_;
+        host_timestamp_ns = last_host_timestamp_ns_;
+        return last_device_timestamp_ > 0;
     }
 
-    int HikCamera::getTimestamp()
-    {   //获取时间戳
-        std::chrono::_V2::steady_clock::time_point time_start = std::chrono::_V2::steady_clock::now();
-
-        nRet = MV_CC_SetCommandValue(handle, "GevTimestampControlLatch");
-        if(MV_OK != nRet)
-            RCLCPP_WARN(logger_, "获取时间戳失败...");
-        
-        MVCC_INTVALUE timestamp;
-        nRet = MV_CC_GetIntValue(handle, "GevTimestampValue", &timestamp);
-        if(MV_OK != nRet)
-            RCLCPP_WARN(logger_, "获取时间戳失败...");
+    double HikCamera::getTimestampFrequency()
+    {
+        return timestamp_freq_;
+    }
 
-        return ((int)time_start.time_since_epoch().count() - timestamp_offset_);
+    /**
+     * @brief 保证buffer可容纳一帧，容量不足时与帧缓冲环中足够大的一块交换
+     * 换出的缓冲区留在环中，下次开流时按PayloadSize补齐；仅在环中也没有足够大的缓冲区时申请内存
+     */
+    void HikCamera::prepareFrameBuffer(std::vector<unsigned char>& buffer, size_t frame_size)
+    {
+        for (int ii = 0; ii < (int)frame_buffer_ring_.size() && buffer.capacity() < frame_size; ++ii)
+        {
+            std::vector<unsigned char>& frame_buffer = frame_buffer_ring_[frame_buffer_idx_];
+            frame_buffer_idx_ = (frame_buffer_idx_ + 1) % frame_buffer_ring_.size();
+            if (frame_buffer.capacity() >= frame_size)
+                buffer.swap(frame_buffer);
+        }
+        if (buffer.size() != frame_size)
+            buffer.resize(frame_size);
     }
 
     bool HikCamera::getImage(::cv::Mat &Src, sensor_msgs::msg::Image& image_msg)
     {
-        // ch:获取数据包大小 | en:Get payload size
-        MVCC_INTVALUE stParam;
-        memset(&stParam, 0, sizeof(MVCC_INTVALUE));
-        nRet = MV_CC_GetIntValue(handle, "PayloadSize", &stParam);
-        if(nRet != MV_OK)
+        if (g_nPayloadSize == 0)
         {
-            RCLCPP_ERROR(logger_, "Get PayloadSize fail! nRet [%x]\n", nRet);
+            RCLCPP_ERROR(logger_, "Stream is not on!");
             return false;
         }
 
+        // SDK直接将图像写入消息缓冲区，容量不足时由帧缓冲环补上
+        int channels = raw_bayer_ ? 1 : 3;
+        size_t frame_size = (size_t)roi_.width * roi_.height * channels;
+        prepareFrameBuffer(image_msg.data, frame_size);
+
         MV_FRAME_OUT_INFO_EX stImageInfo;
         memset(&stImageInfo, 0, sizeof(MV_FRAME_OUT_INFO_EX));
-        unsigned char * pData = (unsigned char *)malloc(sizeof(unsigned char) * stParam.nCurValue);
-        if (NULL == pData)
-        {
-            return NULL;
-        }
-        unsigned int nDataSize = stParam.nCurValue;
         
         //从缓存区读取图像
-        nRet = MV_CC_GetOneFrameTimeout(handle, pData, nDataSize, &stImageInfo, 1000);
+        nRet = MV_CC_GetOneFrameTimeout(handle, image_msg.data.data(), (unsigned int)frame_size, &stImageInfo, 1000);
         if(nRet != MV_OK)
         {
             RCLCPP_ERROR(logger_, "No image data! nRet [%x]", nRet);
             return false;
         }
+        last_host_timestamp_ns_ = FrameQueue::steadyNowNs();
+        last_device_timestamp_ = ((uint64_t)stImageInfo.nDevTimeStampHigh << 32) | stImageInfo.nDevTimeStampLow;
+        last_frame_offset_ = frameOffset(stImageInfo);
 
         // fps
         // nRet = MV_CC_GetFrameRate(handle, &frame_rate);
@@ -412,19 +669,16 @@ namespace camera_driver
         // printf("fps:%f fps_max:%f fps_min:%f\n", stFrameInfo.fFrameRateValue,
         // stFrameInfo.fFrameRateMax, stFrameInfo.fFrameRateMin);
 
-        // cv::Mat src(stImageInfo.nHeight, stImageInfo.nWidth, CV_8UC3, pData);
-        Src = cv::Mat(stImageInfo.nHeight, stImageInfo.nWidth, CV_8UC3);
-        memcpy(Src.data, pData, stImageInfo.nWidth * stImageInfo.nHeight * 3);
-        // src.copyTo(Src);
-        image_msg.step = static_cast<sensor_msgs::msg::Image::_step_type>(Src.step);  
-        image_msg.is_bigendian = false;
-        image_msg.data.assign(Src.datastart, Src.dataend);
-
-        if(pData)
+        if ((size_t)stImageInfo.nWidth * stImageInfo.nHeight * channels != frame_size)
         {
-            delete[] pData;
-            pData = NULL;
+            RCLCPP_ERROR(logger_, "Unexpected frame size: %dx%d", stImageInfo.nWidth, stImageInfo.nHeight);
+            return false;
         }
+
+        // Src仅为消息缓冲区的头部，不发生拷贝
+        Src = cv::Mat(stImageInfo.nHeight, stImageInfo.nWidth, CV_8UC(channels), image_msg.data.data());
+        image_msg.step = static_cast<sensor_msgs::msg::Image::_step_type>(Src.step);  
+        image_msg.is_bigendian = false;
         return true;
     }
 
@@ -2,6 +2,20 @@
 
 namespace camera_driver
 {
+    namespace
+    {
+        uint64_t packRoiWindow(const cv::Rect& roi)
+        {
+            return ((uint64_t)(roi.x & 0xFFFF) << 48) | ((uint64_t)(roi.y & 0xFFFF) << 32)
+                | ((uint64_t)(roi.width & 0xFFFF) << 16) | (uint64_t)(roi.height & 0xFFFF);
+        }
+
+        cv::Rect unpackRoiWindow(uint64_t window)
+        {
+            return cv::Rect((window >> 48) & 0xFFFF, (window >> 32) & 0xFFFF, (window >> 16) & 0xFFFF, window & 0xFFFF);
+        }
+    } //namespace
+
     MvsCamera::MvsCamera()
     : logger_(rclcpp::get_logger("mvs_driver"))
     {
@@ -61,6 +75,7 @@ namespace camera_driver
         UINT FrameBufferSize = tCapability.sResolutionRange.iWidthMax * tCapability.sResolutionRange.iHeightMax * 3;
         // g_pRgbBuffer = (unsigned char*)malloc(tCapability.sResolutionRange.iHeightMax * tCapability.sResolutionRange.iWidthMax * 3);
         g_pRgbBuffer = (BYTE *)CameraAlignMalloc(FrameBufferSize, 16);
+        memset(&base_resolution_, 0, sizeof(tSdkImageResolution));
 
         is_camera_initialized_ = true;
         return is_camera_initialized_;
@@ -90,6 +105,13 @@ namespace camera_driver
             RCLCPP_WARN(logger_, "Read Cam Param failed! Error code: [%d]", status);
         }
 
+        // 原始Bayer输出需将传感器输出格式切换为BayerBG8，取图后跳过ISP
+        if (raw_bayer_ && !setBayerMediaType())
+        {
+            RCLCPP_ERROR(logger_, "Raw bayer output is not available, fall back to bgr8...");
+            raw_bayer_ = false;
+        }
+
         // INT media_type = CAMERA_MEDIA_TYPE_BGR8;
         // status = CameraGetMediaType(hCamera, &media_type);
         // if (status == CAMERA_STATUS_SUCCESS) {
@@ -136,6 +158,27 @@ namespace camera_driver
 
         // CameraGetImageBuffer(hCamera, &sFrameInfo, &pbyBuffer, 500);
         
+        // 记录当前分辨率，硬件ROI均以该窗口为全幅
+        status = CameraGetImageResolution(hCamera, &base_resolution_);
+        if (status != CAMERA_STATUS_SUCCESS)
+        {
+            RCLCPP_WARN(logger_, "Get resolution failed! Error code: [%d]", status);
+            base_resolution_ = tCapability.pImageSizeDesc[0];
+        }
+        roi_ = cv::Rect(0, 0, base_resolution_.iWidth, base_resolution_.iHeight);
+        roi_window_ = packRoiWindow(roi_);
+
+        // 推流模式下注册图像回调，由SDK取图线程完成ISP处理并推入帧队列
+        if (frame_queue_ != nullptr)
+        {
+            status = CameraSetCallbackFunction(hCamera, onFrameCallback, this, NULL);
+            if (status != CAMERA_STATUS_SUCCESS)
+            {
+                RCLCPP_ERROR(logger_, "Set capture callback failed! Error code: [%d]", status);
+                return false;
+            }
+        }
+
         // 让SDK内部取图线程开始工作
         status = CameraPlay(hCamera);
 
@@ -178,6 +221,176 @@ namespace camera_driver
         return is_open_;
     }
 
+    bool MvsCamera::setFrameQueue(FrameQueue* frame_queue)
+    {   //设置推流模式帧队列，需在open()之前调用
+        frame_queue_ = frame_queue;
+        return true;
+    }
+
+    void MvsCamera::onFrameCallback(CameraHandle hCamera, BYTE* pFrameBuffer, tSdkFrameHead* pFrameHead, PVOID pContext)
+    {   //图像回调，运行在SDK取图线程中，ISP输出(或原始Bayer数据)直接写入帧队列的预分配帧；回调返回后原始缓冲由SDK回收
+        int64_t host_timestamp_ns = FrameQueue::steadyNowNs();
+        MvsCamera* cam = static_cast<MvsCamera*>(pContext);
+        if (cam == nullptr || cam->frame_queue_ == nullptr || pFrameBuffer == nullptr || pFrameHead == nullptr)
+            return;
+
+        // 切换ROI前曝光的帧尺寸与当前窗口不符，直接丢弃，避免以新偏移标注旧窗口图像
+        cv::Rect window = unpackRoiWindow(cam->roi_window_.load());
+        if (pFrameHead->iWidth != window.width || pFrameHead->iHeight != window.height)
+            return;
+
+        // 发布线程处理不过来时直接丢弃该帧
+        uint64_t frame_id = cam->push_frame_cnt_++;
+        CameraFrame* frame = cam->frame_queue_->acquire();
+        if (frame == nullptr)
+            return;
+
+        int channels = cam->raw_bayer_ ? 1 : 3;
+        size_t frame_size = (size_t)pFrameHead->iWidth * pFrameHead->iHeight * channels;
+        if (frame->data.size() != frame_size)
+            frame->data.resize(frame_size);
+        if (cam->raw_bayer_)
+        {
+            if (pFrameHead->uiMediaType != CAMERA_MEDIA_TYPE_BAYBG8 || pFrameHead->uBytes < frame_size)
+            {
+                RCLCPP_ERROR_ONCE(cam->logger_, "Unexpected raw frame, media type: %x", pFrameHead->uiMediaType);
+                cam->frame_queue_->abort(frame);
+                return;
+            }
+            memcpy(frame->data.data(), pFrameBuffer, frame_size);
+        }
+        else
+        {
+            if (CameraImageProcess(hCamera, pFrameBuffer, frame->data.data(), pFrameHead) != CAMERA_STATUS_SUCCESS)
+            {
+                RCLCPP_ERROR_ONCE(cam->logger_, "Image process failed!");
+                cam->frame_queue_->abort(frame);
+                return;
+            }
+            cv::Mat img(pFrameHead->iHeight, pFrameHead->iWidth, CV_8UC3, frame->data.data());
+            cv::cvtColor(img, img, COLOR_RGB2BGR);
+        }
+
+        frame->width = pFrameHead->iWidth;
+        frame->height = pFrameHead->iHeight;
+        frame->channels = channels;
+        frame->offset_x = window.x;
+        frame->offset_y = window.y;
+        frame->frame_id = frame_id;
+        frame->device_timestamp = pFrameHead->uiTimeStamp;
+        frame->host_timestamp_ns = host_timestamp_ns;
+        cam->frame_queue_->commit(frame);
+    }
+
+    /**
+     * @brief 设置是否输出原始Bayer数据，需在open()之前调用
+     * 传感器输出格式在open()时切换，不支持BayerBG8时退回BGR8
+     */
+    bool MvsCamera::setRawBayer(bool raw_bayer)
+    {
+        raw_bayer_ = raw_bayer;
+        return true;
+    }
+
+    /**
+     * @brief 在相机支持的输出格式中查找BayerBG8并切换，下游按BGGR解析原始数据
+     */
+    bool MvsCamera::setBayerMediaType()
+    {
+        for (int ii = 0; ii < tCapability.iMediaTypdeDesc; ++ii)
+        {
+            if (tCapability.pMediaTypeDesc[ii].iMediaType != CAMERA_MEDIA_TYPE_BAYBG8)
+                continue;
+
+            status = CameraSetMediaType(hCamera, tCapability.pMediaTypeDesc[ii].iIndex);
+            if (status != CAMERA_STATUS_SUCCESS)
+            {
+                RCLCPP_ERROR(logger_, "Set media type failed! Error code: [%d]", status);
+                return false;
+            }
+            return true;
+        }
+        RCLCPP_ERROR(logger_, "Camera has no BayerBG8 media type...");
+        return false;
+    }
+
+    /**
+     * @brief 设置相机硬件ROI，坐标相对于打开相机时的分辨率窗口，宽高为0时恢复该窗口
+     * 以自定义分辨率(iIndex=0xFF)写入采集视场，切换后清空SDK缓存帧，之后的帧均对应新的ROI；
+     * 窗口带BIN/SKIP或缩放时输出坐标与视场不一致，不支持硬件ROI
+     */
+    bool MvsCamera::setRoi(const cv::Rect& roi)
+    {
+        if (base_resolution_.iWidth != base_resolution_.iWidthFOV || base_resolution_.iHeight != base_resolution_.iHeightFOV)
+        {
+            RCLCPP_ERROR(
+                logger_,
+                "Hardware roi requires an unscaled resolution, current fov %dx%d output %dx%d...",
+                base_resolution_.iWidthFOV, base_resolution_.iHeightFOV,
+                base_resolution_.iWidth, base_resolution_.iHeight
+            );
+            return false;
+        }
+
+        cv::Rect full_roi(0, 0, base_resolution_.iWidth, base_resolution_.iHeight);
+        cv::Rect target = (roi.area() > 0) ? (roi & full_roi) : full_roi;
+        if (target.area() == 0)
+            return false;
+        if (target == roi_)
+            return true;
+
+        tSdkImageResolution resolution = base_resolution_;
+        if (target != full_roi)
+        {
+            resolution.iIndex = 0xFF;
+            resolution.iHOffsetFOV = base_resolution_.iHOffsetFOV + target.x;
+            resolution.iVOffsetFOV = base_resolution_.iVOffsetFOV + target.y;
+            resolution.iWidthFOV = target.width;
+            resolution.iHeightFOV = target.height;
+            resolution.iWidth = target.width;
+            resolution.iHeight = target.height;
+        }
+        status = CameraSetImageResolution(hCamera, &resolution);
+        if (status != CAMERA_STATUS_SUCCESS)
+        {   //状态未知，下次强制重新设置
+            RCLCPP_ERROR(logger_, "Set roi (%d, %d, %d, %d) failed! Error code: [%d]", target.x, target.y, target.width, target.height, status);
+            roi_ = cv::Rect();
+            return false;
+        }
+        // 先清空旧窗口的缓存帧再发布新窗口，回调线程不会以新偏移标注旧窗口图像
+        status = CameraClearBuffer(hCamera);
+        if (status != CAMERA_STATUS_SUCCESS)
+            RCLCPP_WARN(logger_, "Clear buffer failed! Error code: [%d]", status);
+        roi_ = target;
+        roi_window_ = packRoiWindow(target);
+        return true;
+    }
+
+    cv::Size MvsCamera::getSensorSize()
+    {
+        return cv::Size(base_resolution_.iWidth, base_resolution_.iHeight);
+    }
+
+    bool MvsCamera::getFrameOffset(cv::Point2i& offset)
+    {
+        cv::Rect window = unpackRoiWindow(roi_window_.load());
+        offset = cv::Point2i(window.x, window.y);
+        return true;
+    }
+
+    bool MvsCamera::getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns)
+    {
+        device_timestamp = last_device_timestamp_;
+        host_timestamp_ns = last_host_timestamp_ns_;
+        return last_device_timestamp_ > 0;
+    }
+
+    double MvsCamera::getTimestampFrequency()
+    {
+        // uiTimeStamp单位为0.1ms
+        return 1e4;
+    }
+
     void MvsCamera::setResolution(int width, int height)
     {
         // TODO: Set Resolution
@@ -228,9 +441,33 @@ namespace camera_driver
                 RCLCPP_WARN(logger_, "Get image buffer failed! Error code: %d", status);
                 return false;
             }
+            last_host_timestamp_ns_ = FrameQueue::steadyNowNs();
+            last_device_timestamp_ = sFrameInfo.uiTimeStamp;
+            if (raw_bayer_)
+            {   // 原始Bayer数据直接发布，去马赛克推迟到检测节点
+                size_t frame_size = (size_t)sFrameInfo.iWidth * sFrameInfo.iHeight;
+                bool is_valid = (sFrameInfo.uiMediaType == CAMERA_MEDIA_TYPE_BAYBG8 && sFrameInfo.uBytes >= frame_size);
+                if (is_valid)
+                {
+                    image_msg.data.assign(pbyBuffer, pbyBuffer + frame_size);
+                    Src = cv::Mat(sFrameInfo.iHeight, sFrameInfo.iWidth, CV_8UC1, image_msg.data.data());
+                    image_msg.step = static_cast<sensor_msgs::msg::Image::_step_type>(Src.step);
+                    image_msg.is_bigendian = false;
+                }
+                else
+                {
+                    RCLCPP_ERROR(logger_, "Unexpected raw frame, media type: %x", sFrameInfo.uiMediaType);
+                }
+
+                status = CameraReleaseImageBuffer(hCamera, pbyBuffer);
+                if (status != CAMERA_STATUS_SUCCESS) {
+                    RCLCPP_WARN(logger_, "Release image buffer failed! Error code: %d", status);
+                }
+                return is_valid;
+            }
             if (CameraImageProcess(hCamera, pbyBuffer, g_pRgbBuffer, &sFrameInfo) == CAMERA_STATUS_SUCCESS) {
-                Src = cv::Mat(tCapability.pImageSizeDesc->iHeight, tCapability.pImageSizeDesc->iWidth, CV_8UC3);
-                memcpy(Src.data, g_pRgbBuffer, tCapability.pImageSizeDesc->iWidth * tCapability.pImageSizeDesc->iHeight * 3 * sizeof(unsigned char));
+                Src = cv::Mat(sFrameInfo.iHeight, sFrameInfo.iWidth, CV_8UC3);
+                memcpy(Src.data, g_pRgbBuffer, sFrameInfo.iWidth * sFrameInfo.iHeight * 3 * sizeof(unsigned char));
                 cvtColor(Src, Src, COLOR_RGB2BGR);
                 
                 // for (int ii = 0; ii < 10; ii++)
@@ -0,0 +1,139 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-15 21:32:08
+ * @LastEditTime: 2023-06-15 21:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/replay_driver/replay_cam_node.cpp
+ */
+#include "../../include/replay_driver/replay_cam_node.hpp"
+
+namespace camera_driver
+{
+    ReplayCamNode::ReplayCamNode(const rclcpp::NodeOptions &options)
+    : CameraBaseNode<ReplayCam>("replay_driver", options)
+    {
+        string bag_path = this->declare_parameter<string>("bag_path", "");
+        string replay_topic = this->declare_parameter<string>("replay_topic", "");
+        string replay_mode = this->declare_parameter<string>("replay_mode", "realtime");
+        double replay_rate = this->declare_parameter<double>("replay_rate", 1.0);
+        bool replay_loop = this->declare_parameter<bool>("replay_loop", false);
+        publish_clock_ = this->declare_parameter<bool>("publish_clock", false);
+        publish_serial_ = this->declare_parameter<bool>("publish_serial", true);
+
+        if (replay_mode == "fast")
+            replay_mode_ = REPLAY_FAST;
+        else if (replay_mode == "stepped")
+            replay_mode_ = REPLAY_STEPPED;
+        else
+            replay_mode_ = REPLAY_REALTIME;
+
+        if (!bag_path.empty() && bag_path[0] != '/')
+        {   // 相对路径与录包路径(save_path)一致，位于camera_driver包目录下
+            bag_path = get_package_share_directory("camera_driver") + "/" + bag_path;
+        }
+
+        if (publish_clock_)
+        {
+            clock_pub_ = this->create_publisher<rosgraph_msgs::msg::Clock>("/clock", rclcpp::ClockQoS());
+        }
+        if (publish_serial_)
+        {
+            rclcpp::QoS qos(0);
+            qos.keep_last(5);
+            qos.best_effort();
+            serial_msg_pub_ = this->create_publisher<SerialMsg>("/serial_msg", qos);
+        }
+        step_srv_ = this->create_service<std_srvs::srv::Trigger>(
+            "~/step",
+            std::bind(&ReplayCamNode::stepCallback, this, std::placeholders::_1, std::placeholders::_2)
+        );
+
+        cam_driver_->setReplayMode(replay_mode_);
+        cam_driver_->setRate(replay_rate);
+        cam_driver_->setLoop(replay_loop);
+        cam_driver_->setSerialCallback(std::bind(&ReplayCamNode::replaySerialMsg, this, _1));
+        if (!cam_driver_->load(bag_path, replay_topic))
+        {
+            RCLCPP_ERROR(this->get_logger(), "Load bag failed, nothing to replay...");
+            return;
+        }
+
+        RCLCPP_WARN(
+            this->get_logger(),
+            "Replay mode: %s rate: %.2f loop: %d publish clock: %d",
+            replay_mode.c_str(),
+            replay_rate,
+            replay_loop,
+            publish_clock_
+        );
+        cam_driver_->start();
+    }
+
+    ReplayCamNode::~ReplayCamNode()
+    {   // 唤醒阻塞在等待下一帧的图像线程
+        cam_driver_->close();
+    }
+
+    /**
+     * @brief 开启publish_clock时以录制时间戳作为图像时间戳，并在发布图像前发布/clock，
+     * 使下游在任意回放速度下看到与录制时一致的时间间隔
+     */
+    rclcpp::Time ReplayCamNode::stampFrame(uint64_t device_timestamp, int64_t host_timestamp_ns, bool has_hw_timestamp)
+    {
+        (void)host_timestamp_ns;
+        exposure_mid_ns_ = 0;
+        if (!publish_clock_ || !has_hw_timestamp)
+            return this->get_clock()->now();
+
+        rclcpp::Time stamp((int64_t)device_timestamp, RCL_ROS_TIME);
+        rosgraph_msgs::msg::Clock clock_msg;
+        clock_msg.clock = stamp;
+        clock_pub_->publish(clock_msg);
+        return stamp;
+    }
+
+    /**
+     * @brief 串口消息在其后的第一帧图像发布前回放，同时更新本节点的模式
+     */
+    void ReplayCamNode::replaySerialMsg(const SerialMsg& msg)
+    {
+        serial_mutex_.lock();
+        serial_msg_ = msg;
+        serial_mutex_.unlock();
+
+        if (publish_serial_)
+        {
+            if (publish_clock_)
+            {
+                serial_msg_pub_->publish(msg);
+            }
+            else
+            {
+                SerialMsg serial_msg = msg;
+                serial_msg.header.stamp = this->get_clock()->now();
+                serial_msg.imu.header.stamp = serial_msg.header.stamp;
+                serial_msg_pub_->publish(serial_msg);
+            }
+        }
+    }
+
+    void ReplayCamNode::stepCallback(
+        const std::shared_ptr<std_srvs::srv::Trigger::Request> request,
+        std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+    {
+        (void)request;
+        if (replay_mode_ != REPLAY_STEPPED)
+        {
+            response->success = false;
+            response->message = "Not in stepped mode";
+            return;
+        }
+
+        cam_driver_->step();
+        response->success = true;
+        response->message = "Frame " + std::to_string(cam_driver_->frameIdx() + 1) + "/" + std::to_string(cam_driver_->frameNum());
+    }
+} //namespace camera_driver
+
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(camera_driver::ReplayCamNode)
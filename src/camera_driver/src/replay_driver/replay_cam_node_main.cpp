@@ -0,0 +1,17 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-15 21:32:08
+ * @LastEditTime: 2023-06-15 21:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/replay_driver/replay_cam_node_main.cpp
+ */
+#include "../../include/replay_driver/replay_cam_node.hpp"
+
+int main(int argc, char** argv)
+{
+    rclcpp::init(argc, argv);
+    rclcpp::spin(std::make_shared<camera_driver::ReplayCamNode>());
+    rclcpp::shutdown();
+    
+    return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-15 21:32:08
+ * @LastEditTime: 2023-06-15 21:32:08
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/src/replay_driver/replay_camera.cpp
+ */
+#include "../../include/replay_driver/replay_camera.hpp"
+
+#include <rmw/rmw.h>
+#include <rosidl_typesupport_cpp/message_type_support.hpp>
+#include <rosbag2_cpp/readers/sequential_reader.hpp>
+#include <rosbag2_compression/sequential_compression_reader.hpp>
+#include <rosbag2_storage/metadata_io.hpp>
+
+namespace camera_driver
+{
+    namespace
+    {
+        /**
+         * @brief 直接从bag中的序列化数据反序列化，省去构造rclcpp::SerializedMessage时的拷贝
+         */
+        template<class MsgT>
+        bool deserializeBagMsg(const rcutils_uint8_array_t* serialized_data, MsgT& msg)
+        {
+            static const rosidl_message_type_support_t* type_support = rosidl_typesupport_cpp::get_message_type_support_handle<MsgT>();
+            return rmw_deserialize(serialized_data, type_support, &msg) == RMW_RET_OK;
+        }
+    }
+
+    ReplayCam::ReplayCam()
+    : mode_(REPLAY_REALTIME), rate_(1.0), loop_(false), frame_idx_(0), serial_idx_(0),
+    step_cnt_(0), started_(false), is_open_(false), logger_(rclcpp::get_logger("replay_driver"))
+    {
+        init();
+    }
+
+    ReplayCam::ReplayCam(const CameraParam& cam_params)
+    : mode_(REPLAY_REALTIME), rate_(1.0), loop_(false), frame_idx_(0), serial_idx_(0),
+    step_cnt_(0), started_(false), is_open_(false), logger_(rclcpp::get_logger("replay_driver"))
+    {
+        this->cam_param_ = cam_params;
+        init();
+    }
+
+    ReplayCam::~ReplayCam()
+    {
+        close();
+    }
+
+    bool ReplayCam::init()
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        frame_idx_ = 0;
+        serial_idx_ = 0;
+        step_cnt_ = 0;
+        anchored_ = false;
+        replayed_cnt_ = 0;
+        replay_wall_start_ns_ = 0;
+        finished_ = false;
+        last_stamp_ns_ = 0;
+        last_frame_offset_ = cv::Point2i(0, 0);
+        last_host_timestamp_ns_ = 0;
+        return true;
+    }
+
+    bool ReplayCam::open()
+    {
+        is_open_ = true;
+        return true;
+    }
+
+    bool ReplayCam::close()
+    {
+        is_open_ = false;
+        step_cond_.notify_all();
+        return true;
+    }
+
+    bool ReplayCam::load(const std::string& bag_path, const std::string& image_topic)
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        frames_.clear();
+        frame_offsets_.clear();
+        serial_msgs_.clear();
+
+        try
+        {
+            rosbag2_storage::MetadataIo metadata_io;
+            if (!metadata_io.metadata_file_exists(bag_path))
+            {
+                RCLCPP_ERROR(logger_, "No bag found at %s", bag_path.c_str());
+                return false;
+            }
+            rosbag2_storage::BagMetadata metadata = metadata_io.read_metadata(bag_path);
+
+            std::unique_ptr<rosbag2_cpp::reader_interfaces::BaseReaderInterface> reader;
+            if (metadata.compression_format.empty())
+                reader = std::make_unique<rosbag2_cpp::readers::SequentialReader>();
+            else
+                reader = std::make_unique<rosbag2_compression::SequentialCompressionReader>();
+
+            rosbag2_storage::StorageOptions storage_options;
+            storage_options.uri = bag_path;
+            storage_options.storage_id = metadata.storage_identifier;
+            rosbag2_cpp::ConverterOptions converter_options({
+                rmw_get_serialization_format(),
+                rmw_get_serialization_format()
+            });
+            reader->open(storage_options, converter_options);
+
+            std::string replay_topic = image_topic;
+            std::string serial_topic;
+            std::string info_topic;
+            for (const auto& topic : reader->get_all_topics_and_types())
+            {
+                if (replay_topic.empty() && topic.type == "sensor_msgs/msg/Image")
+                    replay_topic = topic.name;
+                if (topic.type == "global_interface/msg/Serial")
+                    serial_topic = topic.name;
+                if (info_topic.empty() && topic.type == "sensor_msgs/msg/CameraInfo")
+                    info_topic = topic.name;
+            }
+
+            // 录制时camera_info与图像以相同时间戳入包，据此恢复每帧的硬件ROI
+            std::unordered_map<int64_t, cv::Point2i> info_offsets;
+            cv::Size info_size;
+
+            while (reader->has_next())
+            {
+                auto bag_msg = reader->read_next();
+                if (bag_msg->topic_name == replay_topic)
+                {   // 图像保留序列化数据，发布时再反序列化
+                    frames_.emplace_back(bag_msg);
+                }
+                else if (!info_topic.empty() && bag_msg->topic_name == info_topic)
+                {
+                    sensor_msgs::msg::CameraInfo info;
+                    if (deserializeBagMsg(bag_msg->serialized_data.get(), info))
+                    {
+                        info_offsets[bag_msg->time_stamp] = cv::Point2i(info.roi.x_offset, info.roi.y_offset);
+                        if (info_size.area() == 0 && info.width > 0 && info.height > 0)
+                            info_size = cv::Size(info.width, info.height);
+                    }
+                }
+                else if (!serial_topic.empty() && bag_msg->topic_name == serial_topic)
+                {
+                    SerialRecord record;
+                    record.bag_ns = bag_msg->time_stamp;
+                    if (deserializeBagMsg(bag_msg->serialized_data.get(), record.msg))
+                        serial_msgs_.emplace_back(record);
+                }
+            }
+
+            if (frames_.empty())
+            {
+                RCLCPP_ERROR(logger_, "No image found in topic '%s' of %s", replay_topic.c_str(), bag_path.c_str());
+                return false;
+            }
+
+            sensor_msgs::msg::Image first_frame;
+            if (!deserializeBagMsg(frames_.front()->serialized_data.get(), first_frame))
+            {
+                RCLCPP_ERROR(logger_, "Deserialize image failed!");
+                frames_.clear();
+                return false;
+            }
+            sensor_size_ = info_size.area() > 0 ? info_size : cv::Size(first_frame.width, first_frame.height);
+            frame_offsets_.reserve(frames_.size());
+            for (const auto& frame : frames_)
+            {
+                auto offset = info_offsets.find(frame->time_stamp);
+                frame_offsets_.emplace_back(offset != info_offsets.end() ? offset->second : cv::Point2i(0, 0));
+            }
+
+            double duration = (frames_.back()->time_stamp - frames_.front()->time_stamp) / 1e9;
+            RCLCPP_INFO(
+                logger_,
+                "[REPLAY CAMERA] Loaded %s: %lu frames (%s %dx%d) and %lu serial msgs in %.2fs",
+                bag_path.c_str(),
+                frames_.size(),
+                first_frame.encoding.c_str(),
+                sensor_size_.width,
+                sensor_size_.height,
+                serial_msgs_.size(),
+                duration
+            );
+        }
+        catch(const std::exception& e)
+        {
+            RCLCPP_ERROR(logger_, "Load bag %s failed: %s", bag_path.c_str(), e.what());
+            frames_.clear();
+            frame_offsets_.clear();
+            serial_msgs_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void ReplayCam::setReplayMode(ReplayMode mode)
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        mode_ = mode;
+        step_cnt_ = 0;
+        anchored_ = false;
+    }
+
+    void ReplayCam::setRate(double rate)
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        rate_ = rate > 0.0 ? rate : 1.0;
+        anchored_ = false;
+    }
+
+    void ReplayCam::setLoop(bool loop)
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        loop_ = loop;
+    }
+
+    void ReplayCam::setSerialCallback(SerialCallback callback)
+    {
+        std::lock_guard<std::mutex> lock(step_mutex_);
+        serial_callback_ = callback;
+    }
+
+    void ReplayCam::start()
+    {
+        {
+            std::lock_guard<std::mutex> lock(step_mutex_);
+            started_ = true;
+            anchored_ = false;
+        }
+        step_cond_.notify_all();
+    }
+
+    void ReplayCam::step(int n)
+    {
+        {
+            std::lock_guard<std::mutex> lock(step_mutex_);
+            step_cnt_ += n;
+        }
+        step_cond_.notify_all();
+    }
+
+    size_t ReplayCam::frameNum() const
+    {
+        return frames_.size();
+    }
+
+    size_t ReplayCam::frameIdx() const
+    {
+        return frame_idx_;
+    }
+
+    /**
+     * @brief 回放到末尾：循环模式下从头开始，否则输出统计并停止
+     */
+    bool ReplayCam::rewind()
+    {
+        int64_t wall_ns = FrameQueue::steadyNowNs() - replay_wall_start_ns_;
+        double wall_time = wall_ns / 1e9;
+        if (!finished_)
+        {
+            RCLCPP_INFO(
+                logger_,
+                "[REPLAY CAMERA] Replayed %lu frames in %.3fs, %.1ffps",
+                replayed_cnt_,
+                wall_time,
+                wall_time > 0.0 ? replayed_cnt_ / wall_time : 0.0
+            );
+        }
+
+        if (!loop_)
+        {
+            finished_ = true;
+            return false;
+        }
+
+        frame_idx_ = 0;
+        serial_idx_ = 0;
+        replayed_cnt_ = 0;
+        replay_wall_start_ns_ = 0;
+        anchored_ = false;
+        return true;
+    }
+
+    bool ReplayCam::waitFrame()
+    {
+        std::unique_lock<std::mutex> lock(step_mutex_);
+        while (true)
+        {
+            if (!is_open_)
+                return false;
+
+            bool ready = started_;
+            if (ready && frame_idx_ >= frames_.size())
+                ready = !frames_.empty() && rewind();
+            if (ready && mode_ == REPLAY_STEPPED)
+                ready = step_cnt_ > 0;
+
+            if (ready)
+                break;
+            step_cond_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        if (mode_ == REPLAY_STEPPED)
+            --step_cnt_;
+        if (replay_wall_start_ns_ == 0)
+            replay_wall_start_ns_ = FrameQueue::steadyNowNs();
+        if (mode_ != REPLAY_REALTIME)
+            return true;
+
+        // 按录制时间间隔等待，落后超过100ms时重新对齐，不追帧
+        int64_t bag_ns = frames_[frame_idx_]->time_stamp;
+        auto now = std::chrono::steady_clock::now();
+        if (!anchored_)
+        {
+            replay_start_time_ = now;
+            replay_start_bag_ns_ = bag_ns;
+            anchored_ = true;
+        }
+        auto offset = std::chrono::nanoseconds((int64_t)((bag_ns - replay_start_bag_ns_) / rate_));
+        auto target = replay_start_time_ + offset;
+        if (now - target > std::chrono::milliseconds(100))
+        {
+            replay_start_time_ = now - offset;
+            target = now;
+        }
+        lock.unlock();
+        std::this_thread::sleep_until(target);
+        return is_open_;
+    }
+
+    void ReplayCam::flushSerialMsgs(int64_t until_ns)
+    {
+        while (serial_idx_ < serial_msgs_.size() && serial_msgs_[serial_idx_].bag_ns <= until_ns)
+        {
+            if (serial_callback_)
+                serial_callback_(serial_msgs_[serial_idx_].msg);
+            ++serial_idx_;
+        }
+    }
+
+    bool ReplayCam::getImage(cv::Mat &src, sensor_msgs::msg::Image& image_msg)
+    {
+        if (!is_open_ || !waitFrame())
+            return false;
+
+        const auto& bag_msg = frames_[frame_idx_];
+        flushSerialMsgs(bag_msg->time_stamp);
+
+        // image_msg的缓冲区容量在帧间复用，只有一次拷贝
+        if (!deserializeBagMsg(bag_msg->serialized_data.get(), image_msg))
+        {
+            RCLCPP_ERROR(logger_, "Deserialize frame %lu failed!", frame_idx_.load());
+            ++frame_idx_;
+            return false;
+        }
+        int channels = sensor_msgs::image_encodings::numChannels(image_msg.encoding);
+        src = cv::Mat(image_msg.height, image_msg.width, CV_8UC(channels), image_msg.data.data(), image_msg.step);
+        last_frame_offset_ = frame_offsets_[frame_idx_];
+
+        last_stamp_ns_ = rclcpp::Time(image_msg.header.stamp).nanoseconds();
+        last_host_timestamp_ns_ = FrameQueue::steadyNowNs();
+        ++frame_idx_;
+        ++replayed_cnt_;
+        return true;
+    }
+
+    bool ReplayCam::setFrameQueue(FrameQueue* frame_queue)
+    {   // 回放节奏由getImage控制，不支持推流模式
+        (void)frame_queue;
+        return false;
+    }
+
+    bool ReplayCam::setRawBayer(bool raw_bayer)
+    {   // 图像编码与录制时一致
+        (void)raw_bayer;
+        return false;
+    }
+
+    bool ReplayCam::setRoi(const cv::Rect& roi)
+    {   // 录制时的ROI偏移由录制的camera_info恢复，经getFrameOffset输出
+        (void)roi;
+        return false;
+    }
+
+    cv::Size ReplayCam::getSensorSize()
+    {
+        return sensor_size_;
+    }
+
+    bool ReplayCam::getFrameOffset(cv::Point2i& offset)
+    {
+        offset = last_frame_offset_;
+        return true;
+    }
+
+    /**
+     * @brief 以录制的图像时间戳作为设备时间戳
+     */
+    bool ReplayCam::getFrameTimestamp(uint64_t& device_timestamp, int64_t& host_timestamp_ns)
+    {
+        device_timestamp = last_stamp_ns_;
+        host_timestamp_ns = last_host_timestamp_ns_;
+        return last_stamp_ns_ > 0;
+    }
+
+    double ReplayCam::getTimestampFrequency()
+    {
+        return TICK_FREQ;
+    }
+
+    bool ReplayCam::setExposureTime(int exposure_time)
+    {
+        (void)exposure_time;
+        return true;
+    }
+
+    bool ReplayCam::setGain(int value, int exp_gain)
+    {
+        (void)value;
+        (void)exp_gain;
+        return true;
+    }
+
+    bool ReplayCam::setBalance(int value, float value_number)
+    {
+        (void)value;
+        (void)value_number;
+        return true;
+    }
+} //namespace camera_driver
@@ -0,0 +1,235 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-29 20:12:45
+ * @LastEditTime: 2023-06-29 20:12:45
+ * @FilePath: /TUP-Vision-2023-Based/src/camera_driver/test/test_push_mode.cpp
+ */
+#include <gtest/gtest.h>
+
+//c++
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../include/camera_driver/frame_queue.hpp"
+#include "../include/camera_driver/image_allocator.hpp"
+#include "../include/fake_driver/fake_camera.hpp"
+
+using namespace camera_driver;
+
+namespace
+{
+    // 模拟SDK回调线程推入一帧
+    bool pushFrame(FrameQueue& queue, uint64_t frame_id)
+    {
+        CameraFrame* frame = queue.acquire();
+        if (frame == nullptr)
+            return false;
+        frame->data.assign(16, (uint8_t)frame_id);
+        frame->width = 4;
+        frame->height = 4;
+        frame->channels = 1;
+        frame->frame_id = frame_id;
+        queue.commit(frame);
+        return true;
+    }
+
+    CameraParam fakeParam(int fps)
+    {
+        CameraParam param;
+        param.image_width = 64;
+        param.image_height = 48;
+        param.fps = fps;
+        param.exposure_time = 3000;
+        return param;
+    }
+
+    // 轮询取帧直至超时
+    CameraFrame* waitFrame(FrameQueue& queue, std::chrono::milliseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            CameraFrame* frame = queue.take();
+            if (frame != nullptr)
+                return frame;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return nullptr;
+    }
+} //namespace
+
+TEST(FrameQueueTest, TakeReturnsFramesInOrder)
+{
+    FrameQueue queue;
+    for (uint64_t ii = 0; ii < 10; ++ii)
+    {
+        ASSERT_TRUE(pushFrame(queue, ii));
+        CameraFrame* frame = queue.take();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(frame->frame_id, ii);
+        EXPECT_EQ(frame->data[0], (uint8_t)ii);
+        queue.release(frame);
+    }
+    EXPECT_EQ(queue.take(), nullptr);
+    EXPECT_EQ(queue.dropped(), 0u);
+}
+
+TEST(FrameQueueTest, TakeKeepsLatestAndDropsBacklog)
+{
+    FrameQueue queue;
+    ASSERT_TRUE(pushFrame(queue, 0));
+    ASSERT_TRUE(pushFrame(queue, 1));
+    ASSERT_TRUE(pushFrame(queue, 2));
+
+    CameraFrame* frame = queue.take();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->frame_id, 2u);
+    EXPECT_EQ(queue.dropped(), 2u);
+    queue.release(frame);
+
+    // 积压帧已归还，全部帧可再次取用
+    for (size_t ii = 0; ii < FrameQueue::FRAME_NUM; ++ii)
+        EXPECT_TRUE(pushFrame(queue, 3 + ii));
+}
+
+TEST(FrameQueueTest, AcquireDropsWhenConsumerStalls)
+{
+    FrameQueue queue;
+    for (size_t ii = 0; ii < FrameQueue::FRAME_NUM; ++ii)
+        ASSERT_TRUE(pushFrame(queue, ii));
+
+    // 发布线程未取帧时生产者拿不到空闲帧，当帧计为丢帧
+    EXPECT_FALSE(pushFrame(queue, FrameQueue::FRAME_NUM));
+    EXPECT_EQ(queue.dropped(), 1u);
+
+    CameraFrame* frame = queue.take();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->frame_id, FrameQueue::FRAME_NUM - 1);
+    EXPECT_EQ(queue.dropped(), FrameQueue::FRAME_NUM);
+    queue.release(frame);
+}
+
+TEST(FrameQueueTest, AbortedFramesAreRecycled)
+{
+    FrameQueue queue;
+    CameraFrame* frame = queue.acquire();
+    ASSERT_NE(frame, nullptr);
+    queue.abort(frame);
+    EXPECT_EQ(queue.take(), nullptr);
+    EXPECT_EQ(queue.dropped(), 0u);
+
+    for (size_t ii = 0; ii < FrameQueue::FRAME_NUM; ++ii)
+        EXPECT_TRUE(pushFrame(queue, ii));
+}
+
+TEST(BufferPoolTest, PutAndTakeSwapBuffers)
+{
+    BufferPool pool;
+    std::vector<uint8_t> buffer;
+    EXPECT_FALSE(pool.put(buffer));
+    EXPECT_FALSE(pool.take(buffer));
+
+    buffer.resize(1024);
+    const uint8_t* data = buffer.data();
+    ASSERT_TRUE(pool.put(buffer));
+    EXPECT_EQ(buffer.capacity(), 0u);
+    EXPECT_EQ(pool.size(), 1u);
+
+    ASSERT_TRUE(pool.take(buffer));
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_EQ(pool.size(), 0u);
+
+    // 池满后归还失败，缓冲区仍归调用方
+    std::vector<std::vector<uint8_t>> buffers(BufferPool::BUFFER_NUM + 1, std::vector<uint8_t>(16));
+    for (size_t ii = 0; ii < BufferPool::BUFFER_NUM; ++ii)
+        EXPECT_TRUE(pool.put(buffers[ii]));
+    EXPECT_FALSE(pool.put(buffers.back()));
+    EXPECT_EQ(buffers.back().size(), 16u);
+}
+
+TEST(BufferPoolTest, ReleasedImageMessageReturnsBuffer)
+{
+    std::vector<uint8_t> drained;
+    while (imageBufferPool().take(drained))
+        drained = std::vector<uint8_t>();
+
+    ImageMsgPtr image_msg = makeImageMsg();
+    image_msg->data.resize(640 * 512 * 3);
+    const uint8_t* data = image_msg->data.data();
+    {   // 进程内发布时订阅者以shared_ptr持有消息，最后一个引用释放时归还缓冲区
+        std::shared_ptr<const sensor_msgs::msg::Image> shared_msg = std::move(image_msg);
+    }
+    ASSERT_EQ(imageBufferPool().size(), 1u);
+
+    std::vector<uint8_t> buffer;
+    ASSERT_TRUE(imageBufferPool().take(buffer));
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_EQ(buffer.size(), (size_t)640 * 512 * 3);
+}
+
+TEST(FakeCamPushTest, FramesArriveInOrder)
+{
+    FrameQueue queue;
+    FakeCam cam(fakeParam(200));
+    ASSERT_TRUE(cam.setFrameQueue(&queue));
+    ASSERT_TRUE(cam.open());
+
+    bool has_last = false;
+    uint64_t last_id = 0;
+    uint64_t last_device_timestamp = 0;
+    int64_t last_host_timestamp = 0;
+    for (int ii = 0; ii < 20; ++ii)
+    {
+        CameraFrame* frame = waitFrame(queue, std::chrono::milliseconds(500));
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(frame->width, 64);
+        EXPECT_EQ(frame->height, 48);
+        EXPECT_EQ(frame->channels, 3);
+        EXPECT_EQ(frame->data.size(), (size_t)64 * 48 * 3);
+        if (has_last)
+        {
+            EXPECT_GT(frame->frame_id, last_id);
+            EXPECT_GT(frame->device_timestamp, last_device_timestamp);
+            EXPECT_GE(frame->host_timestamp_ns, last_host_timestamp);
+        }
+        has_last = true;
+        last_id = frame->frame_id;
+        last_device_timestamp = frame->device_timestamp;
+        last_host_timestamp = frame->host_timestamp_ns;
+        queue.release(frame);
+    }
+    cam.close();
+}
+
+TEST(FakeCamPushTest, StalledConsumerDropsFrames)
+{
+    FrameQueue queue;
+    FakeCam cam(fakeParam(500));
+    ASSERT_TRUE(cam.setFrameQueue(&queue));
+    ASSERT_TRUE(cam.setRawBayer(true));
+    ASSERT_TRUE(cam.open());
+
+    CameraFrame* frame = waitFrame(queue, std::chrono::milliseconds(500));
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->channels, 1);
+    uint64_t first_id = frame->frame_id;
+    queue.release(frame);
+
+    // 停止取帧约20帧的时间，生产者在空闲帧耗尽后丢帧
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    frame = waitFrame(queue, std::chrono::milliseconds(500));
+    ASSERT_NE(frame, nullptr);
+    uint64_t backlog_id = frame->frame_id;
+    EXPECT_GT(backlog_id, first_id);
+    queue.release(frame);
+    EXPECT_GT(queue.dropped(), 0u);
+
+    // 恢复取帧后帧号继续递增，中间跳过被丢弃的帧
+    frame = waitFrame(queue, std::chrono::milliseconds(500));
+    ASSERT_NE(frame, nullptr);
+    EXPECT_GT(frame->frame_id, backlog_id + 1);
+    queue.release(frame);
+    cam.close();
+}
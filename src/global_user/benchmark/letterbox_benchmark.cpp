@@ -0,0 +1,335 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-18 16:02:17
+ * @LastEditTime: 2023-06-18 16:02:17
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/benchmark/letterbox_benchmark.cpp
+ */
+/**
+ * @brief 网络输入预处理耗时对比
+ * 原实现：resize + copyMakeBorder + convertTo + split + memcpy；
+ * 融合实现：letterboxToTensor一次写入float张量(仅保留在本文件中作对照，生产代码已不再使用)；
+ * u8输入：letterboxToImage写入u8 NHWC张量，类型与布局转换由模型中的PrePostProcessor完成。
+ * 同时输出与原实现的最大差值。
+ *
+ * 用法：ros2 run global_user letterbox_benchmark [iterations]
+ */
+#include "../include/global_user/preprocess.hpp"
+
+//c++
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define PREPROCESS_USE_X86
+#endif
+
+namespace
+{
+    typedef void (*BlendRowFunc)(const float* row0, const float* row1, float fy, float* dst, int len);
+
+    /**
+     * @brief 纵向插值并取整：dst = round(row0 + fy * (row1 - row0))
+     * 取整保证与先缩放为8位图像再转float的输入一致
+     */
+    void blendRowScalar(const float* row0, const float* row1, float fy, float* dst, int len)
+    {
+        for (int ii = 0; ii < len; ++ii)
+        {
+            dst[ii] = std::nearbyint(row0[ii] + fy * (row1[ii] - row0[ii]));
+        }
+    }
+
+#ifdef PREPROCESS_USE_X86
+    void blendRowSSE2(const float* row0, const float* row1, float fy, float* dst, int len)
+    {
+        const __m128 vfy = _mm_set1_ps(fy);
+        int ii = 0;
+        for (; ii + 4 <= len; ii += 4)
+        {
+            __m128 r0 = _mm_loadu_ps(row0 + ii);
+            __m128 r1 = _mm_loadu_ps(row1 + ii);
+            __m128 val = _mm_add_ps(r0, _mm_mul_ps(vfy, _mm_sub_ps(r1, r0)));
+            _mm_storeu_ps(dst + ii, _mm_cvtepi32_ps(_mm_cvtps_epi32(val)));
+        }
+        blendRowScalar(row0 + ii, row1 + ii, fy, dst + ii, len - ii);
+    }
+
+#if defined(__GNUC__)
+    __attribute__((target("avx2,fma")))
+    void blendRowAVX2(const float* row0, const float* row1, float fy, float* dst, int len)
+    {
+        const __m256 vfy = _mm256_set1_ps(fy);
+        int ii = 0;
+        for (; ii + 8 <= len; ii += 8)
+        {
+            __m256 r0 = _mm256_loadu_ps(row0 + ii);
+            __m256 r1 = _mm256_loadu_ps(row1 + ii);
+            __m256 val = _mm256_fmadd_ps(vfy, _mm256_sub_ps(r1, r0), r0);
+            _mm256_storeu_ps(dst + ii, _mm256_round_ps(val, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        }
+        blendRowSSE2(row0 + ii, row1 + ii, fy, dst + ii, len - ii);
+    }
+#endif
+#endif
+
+    BlendRowFunc selectBlendRow()
+    {
+#ifdef PREPROCESS_USE_X86
+#if defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return blendRowAVX2;
+#endif
+        return blendRowSSE2;
+#else
+        return blendRowScalar;
+#endif
+    }
+
+    // 启动时按CPU特性选择一次
+    const BlendRowFunc blend_row = selectBlendRow();
+
+    /**
+     * @brief 计算目标坐标对应的源坐标及插值权重，像素中心对齐方式与cv::resize(INTER_LINEAR)一致
+     */
+    inline void mapCoord(int dst, double scale, int src_len, int& s0, int& s1, float& f)
+    {
+        float s = (float)((dst + 0.5) * scale - 0.5);
+        int si = (int)std::floor(s);
+        f = s - si;
+        if (si < 0)
+        {
+            si = 0;
+            f = 0.f;
+        }
+        if (si >= src_len - 1)
+        {
+            si = src_len - 1;
+            f = 0.f;
+        }
+        s0 = si;
+        s1 = std::min(si + 1, src_len - 1);
+    }
+
+    /**
+     * @brief 横向插值，同时将BGR交错像素拆分为三个float平面
+     * 横向为按查找表的非连续访问，保持标量实现
+     */
+    void resizeRowH(const uchar* src, const int* xofs0, const int* xofs1, const float* alpha, int len, float* dst)
+    {
+        float* b = dst;
+        float* g = dst + len;
+        float* r = dst + 2 * len;
+        for (int ii = 0; ii < len; ++ii)
+        {
+            const uchar* p0 = src + xofs0[ii];
+            const uchar* p1 = src + xofs1[ii];
+            float a = alpha[ii];
+            b[ii] = p0[0] + a * (p1[0] - p0[0]);
+            g[ii] = p0[1] + a * (p1[1] - p0[1]);
+            r[ii] = p0[2] + a * (p1[2] - p0[2]);
+        }
+    }
+
+    // 查找表及行缓存按线程复用，避免每帧分配
+    struct ResizeBuffer
+    {
+        std::vector<int> xofs0;
+        std::vector<int> xofs1;
+        std::vector<float> alpha;
+        std::vector<float> rows[2];
+    };
+
+    /**
+     * @brief letterbox缩放(双线性)、补边、转float与HWC->CHW一次完成，直接写入float张量。
+     * 检测器已改为u8输入(letterboxToImage)，该实现不再用于生产代码，仅保留作耗时对照。
+     * 纵向插值使用AVX2/SSE2(运行时检测)，其余平台退化为标量实现。
+     */
+    void letterboxToTensor(const cv::Mat& src, int dst_w, int dst_h, float* dst, Eigen::Matrix<float, 3, 3>& transform_matrix)
+    {
+        CV_Assert(src.type() == CV_8UC3);
+
+        float r = std::min(dst_w / (src.cols * 1.0), dst_h / (src.rows * 1.0));
+        int unpad_w = r * src.cols;
+        int unpad_h = r * src.rows;
+
+        int dw = dst_w - unpad_w;
+        int dh = dst_h - unpad_h;
+
+        dw /= 2;
+        dh /= 2;
+
+        transform_matrix << 1.0 / r, 0, -dw / r,
+                            0, 1.0 / r, -dh / r,
+                            0, 0, 1;
+
+        const int plane = dst_w * dst_h;
+        const int right_pad = dst_w - dw - unpad_w;
+        for (int c = 0; c < 3; ++c)
+        {   //上下补边
+            float* dst_plane = dst + c * plane;
+            memset(dst_plane, 0, (size_t)dh * dst_w * sizeof(float));
+            memset(dst_plane + (dh + unpad_h) * dst_w, 0, (size_t)(dst_h - dh - unpad_h) * dst_w * sizeof(float));
+        }
+        if (unpad_w <= 0 || unpad_h <= 0)
+            return;
+
+        thread_local ResizeBuffer buffer;
+        buffer.xofs0.resize(unpad_w);
+        buffer.xofs1.resize(unpad_w);
+        buffer.alpha.resize(unpad_w);
+        buffer.rows[0].resize(3 * unpad_w);
+        buffer.rows[1].resize(3 * unpad_w);
+
+        double scale_x = (double)src.cols / unpad_w;
+        double scale_y = (double)src.rows / unpad_h;
+        for (int dx = 0; dx < unpad_w; ++dx)
+        {
+            int sx0, sx1;
+            mapCoord(dx, scale_x, src.cols, sx0, sx1, buffer.alpha[dx]);
+            buffer.xofs0[dx] = sx0 * 3;
+            buffer.xofs1[dx] = sx1 * 3;
+        }
+
+        // 缓存最近两行的横向插值结果，相邻输出行共用源行时不重复计算
+        int cached_y[2] = {-1, -1};
+        auto fetchRow = [&](int y, int keep_y) -> const float*
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                if (cached_y[k] == y)
+                    return buffer.rows[k].data();
+            }
+            int k = (cached_y[0] == keep_y) ? 1 : 0;
+            resizeRowH(src.ptr<uchar>(y), buffer.xofs0.data(), buffer.xofs1.data(), buffer.alpha.data(), unpad_w, buffer.rows[k].data());
+            cached_y[k] = y;
+            return buffer.rows[k].data();
+        };
+
+        for (int dy = 0; dy < unpad_h; ++dy)
+        {
+            int sy0, sy1;
+            float fy;
+            mapCoord(dy, scale_y, src.rows, sy0, sy1, fy);
+            const float* h0 = fetchRow(sy0, sy1);
+            const float* h1 = fetchRow(sy1, sy0);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                float* dst_row = dst + c * plane + (dy + dh) * dst_w;
+                memset(dst_row, 0, dw * sizeof(float));
+                blend_row(h0 + c * unpad_w, h1 + c * unpad_w, fy, dst_row + dw, unpad_w);
+                memset(dst_row + dw + unpad_w, 0, right_pad * sizeof(float));
+            }
+        }
+    }
+
+    // 与检测器中原有的预处理一致
+    void letterboxReference(cv::Mat& img, int dst_w, int dst_h, float* dst, Eigen::Matrix<float, 3, 3>& transform_matrix)
+    {
+        float r = std::min(dst_w / (img.cols * 1.0), dst_h / (img.rows * 1.0));
+        int unpad_w = r * img.cols;
+        int unpad_h = r * img.rows;
+
+        int dw = dst_w - unpad_w;
+        int dh = dst_h - unpad_h;
+
+        dw /= 2;
+        dh /= 2;
+
+        transform_matrix << 1.0 / r, 0, -dw / r,
+                            0, 1.0 / r, -dh / r,
+                            0, 0, 1;
+
+        cv::Mat re;
+        cv::resize(img, re, cv::Size(unpad_w, unpad_h));
+        cv::Mat out;
+        cv::copyMakeBorder(re, out, dh, dh, dw, dw, cv::BORDER_CONSTANT);
+
+        cv::Mat pre;
+        cv::Mat pre_split[3];
+        out.convertTo(pre, CV_32F);
+        cv::split(pre, pre_split);
+        for (int c = 0; c < 3; c++)
+        {
+            memcpy(dst, pre_split[c].data, dst_w * dst_h * sizeof(float));
+            dst += dst_w * dst_h;
+        }
+    }
+
+    void runCase(const cv::Size& src_size, int dst_size, int iterations)
+    {
+        cv::Mat src(src_size, CV_8UC3);
+        cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        std::vector<float> ref(3 * dst_size * dst_size);
+        std::vector<float> fused(3 * dst_size * dst_size);
+        cv::Mat u8_tensor(dst_size, dst_size, CV_8UC3);
+        Eigen::Matrix<float, 3, 3> ref_matrix;
+        Eigen::Matrix<float, 3, 3> fused_matrix;
+        Eigen::Matrix<float, 3, 3> u8_matrix;
+
+        // 预热，排除首次分配的影响
+        letterboxReference(src, dst_size, dst_size, ref.data(), ref_matrix);
+        letterboxToTensor(src, dst_size, dst_size, fused.data(), fused_matrix);
+        global_user::letterboxToImage(src, u8_tensor, u8_matrix);
+
+        auto st = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            letterboxReference(src, dst_size, dst_size, ref.data(), ref_matrix);
+        }
+        auto mid = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            letterboxToTensor(src, dst_size, dst_size, fused.data(), fused_matrix);
+        }
+        auto end = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            global_user::letterboxToImage(src, u8_tensor, u8_matrix);
+        }
+        auto u8_end = std::chrono::steady_clock::now();
+
+        float max_diff = 0.0f;
+        float u8_max_diff = 0.0f;
+        const int plane = dst_size * dst_size;
+        for (size_t ii = 0; ii < ref.size(); ++ii)
+        {
+            max_diff = std::max(max_diff, std::abs(ref[ii] - fused[ii]));
+            // CHW下标转换为HWC
+            int c = ii / plane;
+            int pixel = ii % plane;
+            u8_max_diff = std::max(u8_max_diff, std::abs(ref[ii] - (float)u8_tensor.data[pixel * 3 + c]));
+        }
+        double ref_ms = std::chrono::duration<double, std::milli>(mid - st).count() / iterations;
+        double fused_ms = std::chrono::duration<double, std::milli>(end - mid).count() / iterations;
+        double u8_ms = std::chrono::duration<double, std::milli>(u8_end - end).count() / iterations;
+        printf(
+            "%4dx%-4d -> %dx%d  reference: %.3fms  fused: %.3fms(%.2fx, max_diff: %.1f)  u8: %.3fms(%.2fx, max_diff: %.1f)  matrix_equal: %d\n",
+            src_size.width, src_size.height, dst_size, dst_size,
+            ref_ms, fused_ms, ref_ms / fused_ms, max_diff, u8_ms, ref_ms / u8_ms, u8_max_diff,
+            (int)(ref_matrix.isApprox(fused_matrix) && ref_matrix.isApprox(u8_matrix))
+        );
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 500;
+
+    // 装甲板检测(416)与能量机关检测(640)的典型输入
+    runCase(cv::Size(1280, 1024), 416, iterations);
+    runCase(cv::Size(1440, 1080), 416, iterations);
+    runCase(cv::Size(720, 720), 416, iterations);
+    runCase(cv::Size(1280, 1024), 640, iterations);
+    runCase(cv::Size(1440, 1080), 640, iterations);
+    return 0;
+}
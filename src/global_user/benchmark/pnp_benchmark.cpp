@@ -0,0 +1,186 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-28 22:18:35
+ * @LastEditTime: 2023-06-28 22:18:35
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/benchmark/pnp_benchmark.cpp
+ */
+/**
+ * @brief 装甲板PnP精度与耗时对比
+ * 随机生成装甲板位姿(距离1~8m，yaw±60°，pitch±20°)，按相机模型投影并叠加高斯噪声，
+ * 分别使用cv::solvePnP(IPPE + ITERATIVE，与原CoordSolver::pnp一致)与solvePlanarPnP解算，
+ * 输出两者平移/旋转差值、各自相对真值的误差、像素重投影误差及单次耗时。
+ * 旋转差值超过5°记为平面二义性分歧，此时两解重投影误差应相当。
+ *
+ * 用法：ros2 run global_user pnp_benchmark [samples] [noise_px]
+ */
+#include "../include/global_user/planar_pnp.hpp"
+
+//c++
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+//opencv
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/eigen.hpp>
+
+using namespace global_user;
+
+namespace
+{
+    struct Stat
+    {
+        double sum = 0.0;
+        double max = 0.0;
+        int count = 0;
+
+        void add(double value)
+        {
+            sum += value;
+            max = std::max(max, value);
+            ++count;
+        }
+
+        double mean() const { return count ? sum / count : 0.0; }
+    };
+
+    double rotationDiff(const Eigen::Matrix3d& lhs, const Eigen::Matrix3d& rhs)
+    {
+        return Eigen::AngleAxisd(lhs.transpose() * rhs).angle() * 180.0 / CV_PI;
+    }
+
+    // 像素重投影误差(RMS)
+    double reprojectError(const std::vector<cv::Point3d>& points_world, const std::vector<cv::Point2f>& points_pic,
+        const Eigen::Matrix3d& rmat, const Eigen::Vector3d& tvec, const cv::Mat& intrinsic, const cv::Mat& dis_coeff)
+    {
+        cv::Mat rmat_cv, rvec, tvec_cv;
+        cv::eigen2cv(rmat, rmat_cv);
+        cv::eigen2cv(tvec, tvec_cv);
+        cv::Rodrigues(rmat_cv, rvec);
+        std::vector<cv::Point2f> points_reproj;
+        cv::projectPoints(points_world, rvec, tvec_cv, intrinsic, dis_coeff, points_reproj);
+        double error = 0.0;
+        for (size_t ii = 0; ii < points_pic.size(); ++ii)
+        {
+            cv::Point2f diff = points_reproj[ii] - points_pic[ii];
+            error += diff.dot(diff);
+        }
+        return std::sqrt(error / points_pic.size());
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    int samples = (argc > 1) ? atoi(argv[1]) : 10000;
+    double noise = (argc > 2) ? atof(argv[2]) : 0.5;
+
+    // 与config/camera.yaml中的标定结果同量级
+    CameraModel camera;
+    camera.fx = 1675.042871;
+    camera.fy = 1674.696037;
+    camera.cx = 623.481121;
+    camera.cy = 556.002821;
+    camera.k1 = -0.0671908;
+    camera.k2 = 0.0877159;
+    camera.p1 = 0.0;
+    camera.p2 = 0.000905638;
+    camera.k3 = -0.00460445;
+    cv::Mat intrinsic = (cv::Mat_<double>(3, 3) << camera.fx, 0, camera.cx, 0, camera.fy, camera.cy, 0, 0, 1);
+    cv::Mat dis_coeff = (cv::Mat_<double>(1, 5) << camera.k1, camera.k2, camera.p1, camera.p2, camera.k3);
+    cv::Rect image_rect(0, 0, 1280, 1024);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> gauss(0.0, noise);
+
+    Stat t_diff, r_diff, cv_t_err, planar_t_err, cv_reproj, planar_reproj;
+    int ambiguous = 0, planar_failed = 0, skipped = 0;
+    double cv_time = 0.0, planar_time = 0.0;
+    std::vector<cv::Point3d> points_world(4);
+    std::vector<cv::Point2f> points_pic;
+    for (int ii = 0; ii < samples; ++ii)
+    {
+        TargetType type = (ii % 2) ? BIG : SMALL;
+        const Eigen::Vector2d* points_armor = armorObjectPoints(type);
+        for (int jj = 0; jj < 4; ++jj)
+            points_world[jj] = cv::Point3d(points_armor[jj](0), points_armor[jj](1), 0.0);
+
+        double dist = 1.0 + 3.5 * (uniform(rng) + 1.0);
+        Eigen::Matrix3d rmat_gt = (Eigen::AngleAxisd(0.05 * uniform(rng), Eigen::Vector3d::UnitZ())
+            * Eigen::AngleAxisd(CV_PI / 3 * uniform(rng), Eigen::Vector3d::UnitY())
+            * Eigen::AngleAxisd(CV_PI / 9 * uniform(rng), Eigen::Vector3d::UnitX())).toRotationMatrix();
+        Eigen::Vector3d tvec_gt(0.3 * dist * uniform(rng), 0.25 * dist * uniform(rng), dist);
+
+        cv::Mat rmat_cv, rvec_gt, tvec_gt_cv;
+        cv::eigen2cv(rmat_gt, rmat_cv);
+        cv::eigen2cv(tvec_gt, tvec_gt_cv);
+        cv::Rodrigues(rmat_cv, rvec_gt);
+        cv::projectPoints(points_world, rvec_gt, tvec_gt_cv, intrinsic, dis_coeff, points_pic);
+        bool is_inside = true;
+        for (auto& point : points_pic)
+        {
+            point.x += gauss(rng);
+            point.y += gauss(rng);
+            is_inside &= image_rect.contains(point);
+        }
+        if (!is_inside)
+        {
+            ++skipped;
+            continue;
+        }
+
+        // cv::solvePnP
+        cv::Mat rvec, tvec;
+        auto st = std::chrono::steady_clock::now();
+        cv::solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, false, cv::SOLVEPNP_IPPE);
+        cv::solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, true, cv::SOLVEPNP_ITERATIVE);
+        auto mid = std::chrono::steady_clock::now();
+
+        // solvePlanarPnP
+        Eigen::Matrix3d rmat_planar;
+        Eigen::Vector3d tvec_planar;
+        bool is_solved = solvePlanarPnP(points_pic.data(), type, camera, 10, rmat_planar, tvec_planar);
+        auto end = std::chrono::steady_clock::now();
+        cv_time += std::chrono::duration<double, std::micro>(mid - st).count();
+        planar_time += std::chrono::duration<double, std::micro>(end - mid).count();
+        if (!is_solved)
+        {
+            ++planar_failed;
+            continue;
+        }
+
+        cv::Mat rmat_cv_result;
+        cv::Rodrigues(rvec, rmat_cv_result);
+        Eigen::Matrix3d rmat_ref;
+        Eigen::Vector3d tvec_ref;
+        cv::cv2eigen(rmat_cv_result, rmat_ref);
+        cv::cv2eigen(tvec, tvec_ref);
+
+        double rotation_diff = rotationDiff(rmat_ref, rmat_planar);
+        if (rotation_diff > 5.0)
+            ++ambiguous;
+        r_diff.add(rotation_diff);
+        t_diff.add((tvec_ref - tvec_planar).norm() * 1000.0);
+        cv_t_err.add((tvec_ref - tvec_gt).norm() * 1000.0);
+        planar_t_err.add((tvec_planar - tvec_gt).norm() * 1000.0);
+        cv_reproj.add(reprojectError(points_world, points_pic, rmat_ref, tvec_ref, intrinsic, dis_coeff));
+        planar_reproj.add(reprojectError(points_world, points_pic, rmat_planar, tvec_planar, intrinsic, dis_coeff));
+    }
+
+    int solved = samples - skipped;
+    printf("samples: %d (out of image: %d), noise: %.2fpx, planar failed: %d\n", samples, skipped, noise, planar_failed);
+    printf("planar vs cv   translation diff: mean %.3fmm max %.3fmm  rotation diff: mean %.4fdeg max %.4fdeg  ambiguous: %d\n",
+        t_diff.mean(), t_diff.max, r_diff.mean(), r_diff.max, ambiguous);
+    printf("translation err (vs truth)  cv: mean %.2fmm max %.2fmm  planar: mean %.2fmm max %.2fmm\n",
+        cv_t_err.mean(), cv_t_err.max, planar_t_err.mean(), planar_t_err.max);
+    printf("reprojection rms            cv: mean %.4fpx max %.4fpx  planar: mean %.4fpx max %.4fpx\n",
+        cv_reproj.mean(), cv_reproj.max, planar_reproj.mean(), planar_reproj.max);
+    printf("time per solve              cv: %.2fus  planar: %.2fus (%.1fx)\n",
+        cv_time / std::max(1, solved), planar_time / std::max(1, solved), cv_time / std::max(1e-9, planar_time));
+    return 0;
+}
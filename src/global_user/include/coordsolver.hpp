@@ -24,6 +24,7 @@
 #include <opencv2/core/eigen.hpp>
 
 #include "global_user/global_user.hpp"
+#include "global_user/planar_pnp.hpp"
 
 using namespace global_user;
 using namespace cv;
@@ -77,6 +78,8 @@ namespace coordsolver
         int R_K_iter;
         cv::Mat intrinsic = cv::Mat(3, 3, CV_64FC1);
         cv::Mat dis_coeff = cv::Mat(1, 5, CV_64FC1);
+        CameraModel camera_model_;                  //装甲板平面PnP使用的内参及畸变系数
+        const int PLANAR_PNP_ITERATIONS = 10;       //平面PnP的Gauss-Newton最大迭代次数
         Eigen::Vector3d xyz_offset;
         Eigen::Vector2d angle_offset;
         Eigen::Vector3d t_iw;
@@ -185,6 +185,8 @@ namespace global_user
         cv::Mat img;
         Eigen::Quaterniond quat;
         int64_t timestamp; 
+        cv::Point2i img_offset;     // 图像左上角在全幅图像中的偏移(相机硬件ROI)
+        cv::Size2i sensor_size;     // 全幅图像尺寸，为空时即为图像尺寸
         
         TaskData()
         {
@@ -0,0 +1,203 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-19 20:41:06
+ * @LastEditTime: 2023-06-19 20:41:06
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/include/global_user/model_cache.hpp
+ */
+#ifndef MODEL_CACHE_HPP_
+#define MODEL_CACHE_HPP_
+
+//c++
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+//linux
+#include <sys/stat.h>
+#include <sys/types.h>
+
+//openvino
+#include <openvino/openvino.hpp>
+
+// 仅依赖OpenVINO的头文件实现，global_user库本身不链接OpenVINO
+namespace global_user
+{
+    namespace model_cache
+    {
+        // FNV-1a 64
+        inline uint64_t hashBytes(const char* data, size_t len, uint64_t seed = 1469598103934665603ULL)
+        {
+            uint64_t hash = seed;
+            for (size_t ii = 0; ii < len; ++ii)
+            {
+                hash ^= (unsigned char)data[ii];
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        inline bool hashFile(const std::string& path, uint64_t& hash)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+                return false;
+
+            char buffer[1 << 16];
+            while (file)
+            {
+                file.read(buffer, sizeof(buffer));
+                hash = hashBytes(buffer, file.gcount(), hash);
+            }
+            return true;
+        }
+
+        /**
+         * @brief CPU指令集，编译产物与指令集相关(AVX512/AVX2内核不可互换)
+         */
+        inline std::string cpuIsa()
+        {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return "avx512";
+            if (__builtin_cpu_supports("avx2"))
+                return "avx2";
+            if (__builtin_cpu_supports("sse4.2"))
+                return "sse42";
+            return "x86";
+#elif defined(__aarch64__)
+            return "aarch64";
+#else
+            return "generic";
+#endif
+        }
+
+        inline bool makeDirs(const std::string& dir)
+        {
+            size_t pos = 0;
+            do
+            {
+                pos = dir.find('/', pos + 1);
+                std::string sub = dir.substr(0, pos);
+                if (mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST)
+                    return false;
+            } while (pos != std::string::npos);
+            return true;
+        }
+
+        /**
+         * @brief 缓存文件路径：<cache_dir>/<模型名>_<key>.blob
+         * key由模型xml/bin内容、OpenVINO版本、设备名、CPU型号及指令集、编译配置共同决定，任一变化即重新编译
+         *
+         * @param model_path 模型xml路径
+         * @param device 推理设备
+         * @param config_tag 预处理、性能提示等影响编译结果的配置描述
+         * @return 模型文件不存在时返回空
+         */
+        inline std::string blobPath(ov::Core& core, const std::string& cache_dir, const std::string& model_path, const std::string& device, const std::string& config_tag)
+        {
+            uint64_t hash = hashBytes(nullptr, 0);
+            std::string bin_path = model_path.substr(0, model_path.find_last_of('.')) + ".bin";
+            if (!hashFile(model_path, hash) || !hashFile(bin_path, hash))
+                return "";
+
+            std::string cpu_name;
+            try
+            {
+                cpu_name = core.get_property(device, ov::device::full_name);
+            }
+            catch(const std::exception&)
+            {
+                cpu_name = "unknown";
+            }
+            std::string env = std::string(ov::get_openvino_version().buildNumber) + "|" + device + "|" + cpu_name + "|" + cpuIsa() + "|" + config_tag;
+            hash = hashBytes(env.data(), env.size(), hash);
+
+            std::string model_name = model_path.substr(model_path.find_last_of('/') + 1);
+            model_name = model_name.substr(0, model_name.find_last_of('.'));
+            char key[17];
+            snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+            return cache_dir + "/" + model_name + "_" + key + ".blob";
+        }
+
+        /**
+         * @brief 优先由缓存import_model，未命中(或缓存损坏)时读取并编译模型，再export到缓存
+         *
+         * @param core OpenVINO core
+         * @param model_path 模型xml路径
+         * @param cache_dir 缓存目录，为空时不使用缓存
+         * @param device 推理设备
+         * @param config_tag 影响编译结果的配置描述，参与缓存key
+         * @param build_model 读取模型并构建预处理的回调，仅在未命中时调用
+         * @param config 编译属性
+         * @param is_cache_hit 是否命中缓存
+         * @return ov::CompiledModel
+         */
+        inline ov::CompiledModel compileModel(
+            ov::Core& core,
+            const std::string& model_path,
+            const std::string& cache_dir,
+            const std::string& device,
+            const std::string& config_tag,
+            const std::function<std::shared_ptr<ov::Model>()>& build_model,
+            const ov::AnyMap& config,
+            bool* is_cache_hit = nullptr)
+        {
+            if (is_cache_hit != nullptr)
+                *is_cache_hit = false;
+
+            std::string blob_path = cache_dir.empty() ? "" : blobPath(core, cache_dir, model_path, device, config_tag);
+            if (!blob_path.empty())
+            {
+                std::ifstream blob(blob_path, std::ios::binary);
+                if (blob)
+                {
+                    try
+                    {
+                        ov::CompiledModel compiled_model = core.import_model(blob, device, config);
+                        if (is_cache_hit != nullptr)
+                            *is_cache_hit = true;
+                        return compiled_model;
+                    }
+                    catch(const std::exception& e)
+                    {   //缓存损坏或不兼容，删除后重新编译
+                        std::cout << "Import cached model " << blob_path << " failed: " << e.what() << std::endl;
+                        blob.close();
+                        std::remove(blob_path.c_str());
+                    }
+                }
+            }
+
+            ov::CompiledModel compiled_model = core.compile_model(build_model(), device, config);
+            if (!blob_path.empty())
+            {   //先写临时文件再重命名，避免中途退出(如被WatchDog重启)留下不完整的缓存
+                std::string tmp_path = blob_path + ".tmp";
+                try
+                {
+                    if (!makeDirs(cache_dir))
+                        throw std::runtime_error("cannot create " + cache_dir);
+                    std::ofstream blob(tmp_path, std::ios::binary);
+                    compiled_model.export_model(blob);
+                    blob.close();
+                    if (!blob || std::rename(tmp_path.c_str(), blob_path.c_str()) != 0)
+                        throw std::runtime_error("cannot write " + tmp_path);
+                }
+                catch(const std::exception& e)
+                {
+                    std::cout << "Export compiled model failed: " << e.what() << std::endl;
+                    std::remove(tmp_path.c_str());
+                }
+            }
+            return compiled_model;
+        }
+    } //namespace model_cache
+} //namespace global_user
+
+#endif
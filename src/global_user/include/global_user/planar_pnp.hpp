@@ -0,0 +1,58 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-28 21:40:12
+ * @LastEditTime: 2023-06-28 21:40:12
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/include/global_user/planar_pnp.hpp
+ */
+#ifndef PLANAR_PNP_HPP_
+#define PLANAR_PNP_HPP_
+
+//eigen
+#include <Eigen/Core>
+#include <Eigen/Dense>
+
+//opencv
+#include <opencv2/core/types.hpp>
+
+#include "global_user.hpp"
+
+namespace global_user
+{
+    /**
+     * @brief 针孔相机内参及畸变系数(k1, k2, p1, p2, k3)
+     */
+    struct CameraModel
+    {
+        double fx = 1.0, fy = 1.0;
+        double cx = 0.0, cy = 0.0;
+        double k1 = 0.0, k2 = 0.0, p1 = 0.0, p2 = 0.0, k3 = 0.0;
+    };
+
+    /**
+     * @brief 装甲板角点在装甲板坐标系下的坐标(z=0平面)，顺序与图像角点一致
+     *
+     * @param type 装甲板类型(SMALL/BIG)
+     * @return 四个角点的(x, y)，其他类型返回nullptr
+     */
+    const Eigen::Vector2d* armorObjectPoints(TargetType type);
+
+    /**
+     * @brief 四点平面装甲板位姿解算(IPPE)
+     * 角点去畸变后由四点单应的雅可比闭式求出两组候选旋转(平面位姿二义性)，各自最小二乘求平移，
+     * 取重投影误差较小者，再以Gauss-Newton在归一化平面上迭代优化。
+     * 物体点预先计算，全部使用定长Eigen矩阵，无堆上分配。
+     *
+     * @param points_pic 四个图像角点(像素)
+     * @param type 装甲板类型(SMALL/BIG)
+     * @param camera 相机模型
+     * @param refine_iterations Gauss-Newton最大迭代次数，0为不优化
+     * @param rmat 装甲板坐标系到相机坐标系的旋转
+     * @param tvec 装甲板中心在相机坐标系下的坐标
+     * @return 类型不支持或解算退化(如角点共线、目标位于相机后方)时返回false
+     */
+    bool solvePlanarPnP(const cv::Point2f* points_pic, TargetType type, const CameraModel& camera, int refine_iterations,
+        Eigen::Matrix3d& rmat, Eigen::Vector3d& tvec);
+} //namespace global_user
+
+#endif
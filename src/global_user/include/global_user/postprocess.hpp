@@ -0,0 +1,28 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-21 20:15:33
+ * @LastEditTime: 2023-06-21 20:15:33
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/include/global_user/postprocess.hpp
+ */
+#ifndef POSTPROCESS_HPP_
+#define POSTPROCESS_HPP_
+
+namespace global_user
+{
+    /**
+     * @brief 网络输出置信度预筛选：按固定步长读取每个anchor的置信度，返回不低于阈值的anchor下标。
+     * 只有通过预筛选的anchor才需要完整解码。
+     * 使用AVX2 gather(运行时检测)，否则SSE2，其余平台退化为标量实现。
+     *
+     * @param data 第一个anchor的置信度地址
+     * @param num anchor数量
+     * @param stride 相邻anchor间隔(float个数)
+     * @param thresh 置信度阈值
+     * @param indices 输出下标，容量不小于num
+     * @return 通过的anchor数量
+     */
+    int selectAboveThreshold(const float* data, int num, int stride, float thresh, int* indices);
+} //namespace global_user
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-18 15:20:41
+ * @LastEditTime: 2023-06-18 15:20:41
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/include/global_user/preprocess.hpp
+ */
+#ifndef PREPROCESS_HPP_
+#define PREPROCESS_HPP_
+
+//opencv
+#include <opencv2/opencv.hpp>
+
+//eigen
+#include <Eigen/Core>
+
+namespace global_user
+{
+    /**
+     * @brief letterbox缩放写入已分配的8位图像(可直接包装u8 NHWC输入张量的内存)，补边置零。
+     * 缩放由cv::resize完成，结果直接写入dst，无中间图像。
+     *
+     * @param src 8UC3图像
+     * @param dst 8UC3输出图像，尺寸即为网络输入尺寸
+     * @param transform_matrix 网络输入坐标到原图坐标的变换矩阵
+     */
+    void letterboxToImage(const cv::Mat& src, cv::Mat& dst, Eigen::Matrix<float, 3, 3>& transform_matrix);
+} //namespace global_user
+
+#endif
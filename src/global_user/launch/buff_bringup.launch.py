@@ -93,29 +93,29 @@ def generate_launch_description():
         camera_params = daheng_cam_params
         camera_plugin = "camera_driver::DahengCamNode"
         camera_node = "daheng_driver"
-        armor_camera_remappings = [("/image", "/daheng_img_armor_node")]
-        buff_camera_remappings = [("/image", "/daheng_img_buff_node")]
+        armor_camera_remappings = [("/image", "/daheng_img")]
+        buff_camera_remappings = [("/image", "/daheng_img")]
 
     elif camera_type == "usb":
         camera_params = usb_cam_params
         camera_plugin = "camera_driver::UsbCamNode"
         camera_node = "usb_driver"
         armor_camera_remappings = [("/image", "/usb_img_armor_node")]
-        buff_camera_remappings = [("/image", "/usb_img_buff_node")]
+        buff_camera_remappings = [("/image", "/usb_img_armor_node")]
 
     elif camera_type == "mvs":
         camera_params = mvs_cam_params
         camera_plugin = "camera_driver::MvsCamNode"
         camera_node = "mvs_driver"
-        armor_camera_remappings = [("/image", "/mvs_img_armor_node")]
-        buff_camera_remappings = [("/image", "/mvs_img_buff_node")]
+        armor_camera_remappings = [("/image", "/mvs_img")]
+        buff_camera_remappings = [("/image", "/mvs_img")]
 
     elif camera_type == "hik":
         camera_params = hik_cam_params
         camera_plugin = "camera_driver::HikCamNode"
         camera_node = "hik_driver"
-        armor_camera_remappings = [("/image", "/hik_img_armor_node")]
-        buff_camera_remappings = [("/image", "/hik_img_buff_node")]
+        armor_camera_remappings = [("/image", "/hik_img")]
+        buff_camera_remappings = [("/image", "/hik_img")]
 
     else:
         raise BaseException("Invalid Cam Type!!!") 
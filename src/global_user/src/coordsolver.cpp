@@ -60,6 +60,16 @@ namespace coordsolver
         initMatrix(mat_coeff,read_vector);
         eigen2cv(mat_coeff,dis_coeff);
 
+        camera_model_.fx = mat_intrinsic(0, 0);
+        camera_model_.fy = mat_intrinsic(1, 1);
+        camera_model_.cx = mat_intrinsic(0, 2);
+        camera_model_.cy = mat_intrinsic(1, 2);
+        camera_model_.k1 = mat_coeff(0, 0);
+        camera_model_.k2 = mat_coeff(0, 1);
+        camera_model_.p1 = mat_coeff(0, 2);
+        camera_model_.p2 = mat_coeff(0, 3);
+        camera_model_.k3 = mat_coeff(0, 4);
+
         read_vector = config[param_name]["T_iw"].as<std::vector<float>>();
         initMatrix(mat_t_iw,read_vector);
         t_iw = mat_t_iw.transpose();
@@ -97,31 +107,8 @@ namespace coordsolver
         std::vector<cv::Point3d> points_world;
         PnPInfo result;
 
-        //长度为4进入装甲板模式
-        //大于长宽比阈值使用大装甲板世界坐标
-        if (type == BIG)
-        {
-            points_world = 
-            {
-                {-0.1125, 0.027, 0},
-                {-0.1125, -0.027, 0},
-                {0.1125, -0.027, 0},
-                {0.1125, 0.027, 0}
-            };
-        }
-        else if (type == SMALL)
-        {
-            points_world = 
-            {
-                {-0.066, 0.027, 0},
-                {-0.066, -0.027, 0},
-                {0.066, -0.027, 0},
-                {0.066, 0.027, 0}
-            };
-        }
-        
         //长度为5进入大符模式
-        else if (type == BUFF)
+        if (type == BUFF)
         {
             points_world = 
             {
@@ -150,9 +137,6 @@ namespace coordsolver
             //     {0.1125,0.027,0}
             // };
         }
-        cv::Mat rvec = cv::Mat(1, 3, CV_64FC1);
-        cv::Mat rmat = cv::Mat(3, 3, CV_64FC1);
-        cv::Mat tvec = cv::Mat(1, 3, CV_64FC1);
         Eigen::Matrix3d rmat_eigen;
         Eigen::Vector3d R_center_world = {0, -0.7, -0.05};
         Eigen::Vector3d tvec_eigen;
@@ -160,32 +144,53 @@ namespace coordsolver
 
         // RCLCPP_INFO_THROTTLE(logger_, this->steady_clock_, 500, "Armor type: %d", (int)(type));
         
-        // 1.首先使用SOLVEPNP_IPPE来初始化相机位姿;
-        // 2.然后通过非线性优化算法(SOLVEPNP_ITERATIVE)（如Levenberg-Marquardt算法等）对相机位姿进行优化，以达到更精确的结果。
+        // 长度为4进入装甲板模式：四点平面目标使用闭式IPPE并以Gauss-Newton优化(无堆上分配)，
+        // 仅在解算退化时回退至cv::solvePnP
         result.is_solver_success = true;
-        if (type != BUFF)
+        bool is_planar_solved = (type != BUFF && points_pic.size() == 4)
+            && solvePlanarPnP(points_pic.data(), type, camera_model_, PLANAR_PNP_ITERATIONS, rmat_eigen, tvec_eigen);
+        if (!is_planar_solved)
         {
-            if (!solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, false, SOLVEPNP_IPPE))
-            {   
-                result.is_solver_success = false;
-                RCLCPP_WARN(logger_, "Initialize camera pose failed...");
+            cv::Mat rvec = cv::Mat(1, 3, CV_64FC1);
+            cv::Mat rmat = cv::Mat(3, 3, CV_64FC1);
+            cv::Mat tvec = cv::Mat(1, 3, CV_64FC1);
+            if (type != BUFF)
+            {
+                //大于长宽比阈值使用大装甲板世界坐标，仅大小装甲板有对应的世界坐标
+                const Eigen::Vector2d* points_armor = armorObjectPoints(type);
+                if (points_armor == nullptr || points_pic.size() != 4)
+                {
+                    result.is_solver_success = false;
+                    RCLCPP_WARN(logger_, "Unsupported target type for armor pnp: %d", (int)type);
+                    return result;
+                }
+                for (int ii = 0; ii < 4; ++ii)
+                    points_world.emplace_back(points_armor[ii](0), points_armor[ii](1), 0);
+
+                // 1.首先使用SOLVEPNP_IPPE来初始化相机位姿;
+                // 2.然后通过非线性优化算法(SOLVEPNP_ITERATIVE)（如Levenberg-Marquardt算法等）对相机位姿进行优化，以达到更精确的结果。
+                if (!solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, false, SOLVEPNP_IPPE))
+                {   
+                    result.is_solver_success = false;
+                    RCLCPP_WARN(logger_, "Initialize camera pose failed...");
+                }
+                if (!solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, true, SOLVEPNP_ITERATIVE))
+                {
+                    result.is_solver_success = false;
+                    RCLCPP_WARN(logger_, "Optimize camera pose failed...");
+                }
             }
-            if (!solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, true, SOLVEPNP_ITERATIVE))
+            else
             {
-                result.is_solver_success = false;
-                RCLCPP_WARN(logger_, "Optimize camera pose failed...");
+                solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, false, SOLVEPNP_EPNP);
+                solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, true, SOLVEPNP_ITERATIVE);
             }
-        }
-        else
-        {
-            solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, false, SOLVEPNP_EPNP);
-            solvePnP(points_world, points_pic, intrinsic, dis_coeff, rvec, tvec, true, SOLVEPNP_ITERATIVE);
-        }
 
-        //Pc = R * Pw + T
-        Rodrigues(rvec, rmat);
-        cv2eigen(rmat, rmat_eigen);
-        cv2eigen(tvec, tvec_eigen);
+            //Pc = R * Pw + T
+            Rodrigues(rvec, rmat);
+            cv2eigen(rmat, rmat_eigen);
+            cv2eigen(tvec, tvec_eigen);
+        }
 
         if (type == BIG || type == SMALL)
         {
@@ -0,0 +1,272 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-28 21:40:12
+ * @LastEditTime: 2023-06-28 21:40:12
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/src/planar_pnp.cpp
+ */
+#include "../include/global_user/planar_pnp.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace global_user
+{
+    namespace
+    {
+        typedef Eigen::Matrix<double, 2, 4> Points2x4;
+
+        // 与CoordSolver::pnp中装甲板世界坐标一致：左上、左下、右下、右上
+        const Eigen::Vector2d SMALL_ARMOR_POINTS[4] =
+        {
+            {-0.066, 0.027},
+            {-0.066, -0.027},
+            {0.066, -0.027},
+            {0.066, 0.027}
+        };
+
+        const Eigen::Vector2d BIG_ARMOR_POINTS[4] =
+        {
+            {-0.1125, 0.027},
+            {-0.1125, -0.027},
+            {0.1125, -0.027},
+            {0.1125, 0.027}
+        };
+
+        const int UNDISTORT_ITERATIONS = 8;
+
+        /**
+         * @brief 像素坐标去畸变到归一化平面(与cv::undistortPoints相同的不动点迭代)
+         */
+        Eigen::Vector2d undistortPoint(const cv::Point2f& point, const CameraModel& camera)
+        {
+            double x0 = (point.x - camera.cx) / camera.fx;
+            double y0 = (point.y - camera.cy) / camera.fy;
+            double x = x0, y = y0;
+            for (int ii = 0; ii < UNDISTORT_ITERATIONS; ++ii)
+            {
+                double r2 = x * x + y * y;
+                double icdist = 1.0 / (1.0 + ((camera.k3 * r2 + camera.k2) * r2 + camera.k1) * r2);
+                double dx = 2.0 * camera.p1 * x * y + camera.p2 * (r2 + 2.0 * x * x);
+                double dy = camera.p1 * (r2 + 2.0 * y * y) + 2.0 * camera.p2 * x * y;
+                x = (x0 - dx) * icdist;
+                y = (y0 - dy) * icdist;
+            }
+            return Eigen::Vector2d(x, y);
+        }
+
+        /**
+         * @brief 四点DLT单应(H22=1)，物体平面坐标 -> 归一化图像坐标
+         */
+        bool computeHomography(const Eigen::Vector2d* object, const Points2x4& image, Eigen::Matrix3d& H)
+        {
+            Eigen::Matrix<double, 8, 8> A;
+            Eigen::Matrix<double, 8, 1> b;
+            for (int ii = 0; ii < 4; ++ii)
+            {
+                double X = object[ii](0), Y = object[ii](1);
+                double x = image(0, ii), y = image(1, ii);
+                A.row(2 * ii) << X, Y, 1.0, 0.0, 0.0, 0.0, -x * X, -x * Y;
+                A.row(2 * ii + 1) << 0.0, 0.0, 0.0, X, Y, 1.0, -y * X, -y * Y;
+                b(2 * ii) = x;
+                b(2 * ii + 1) = y;
+            }
+            Eigen::FullPivLU<Eigen::Matrix<double, 8, 8>> lu(A);
+            if (!lu.isInvertible())
+                return false;
+            Eigen::Matrix<double, 8, 1> h = lu.solve(b);
+            H << h(0), h(1), h(2),
+                 h(3), h(4), h(5),
+                 h(6), h(7), 1.0;
+            return true;
+        }
+
+        /**
+         * @brief IPPE：由单应在物体原点处的雅可比求两组候选旋转
+         * (Collins & Bartoli, Infinitesimal Plane-based Pose Estimation, 2014)
+         *
+         * @param J 雅可比
+         * @param v 物体原点的归一化图像坐标
+         */
+        bool computeRotations(const Eigen::Matrix2d& J, const Eigen::Vector2d& v, Eigen::Matrix3d& R1, Eigen::Matrix3d& R2)
+        {
+            // Rv将视线(v, 1)旋转至z轴
+            Eigen::Vector3d ray(v(0), v(1), 1.0);
+            Eigen::Matrix3d Rv = Eigen::Quaterniond::FromTwoVectors(ray, Eigen::Vector3d::UnitZ()).toRotationMatrix().transpose();
+
+            Eigen::Matrix2d B;
+            B << Rv(0, 0) - v(0) * Rv(2, 0), Rv(0, 1) - v(0) * Rv(2, 1),
+                 Rv(1, 0) - v(1) * Rv(2, 0), Rv(1, 1) - v(1) * Rv(2, 1);
+            double det = B.determinant();
+            if (std::fabs(det) < std::numeric_limits<double>::epsilon())
+                return false;
+            Eigen::Matrix2d A = B.inverse() * J;
+
+            // A的最大奇异值
+            Eigen::Matrix2d AAt = A * A.transpose();
+            double diff = AAt(0, 0) - AAt(1, 1);
+            double gamma2 = 0.5 * (AAt(0, 0) + AAt(1, 1) + std::sqrt(diff * diff + 4.0 * AAt(0, 1) * AAt(0, 1)));
+            double gamma = std::sqrt(std::max(0.0, gamma2));
+            if (gamma < std::numeric_limits<float>::epsilon())
+                return false;
+
+            Eigen::Matrix2d R_tilde = A / gamma;
+            double b0 = std::sqrt(std::max(0.0, 1.0 - R_tilde.col(0).squaredNorm()));
+            double b1 = std::sqrt(std::max(0.0, 1.0 - R_tilde.col(1).squaredNorm()));
+            if (-R_tilde.col(0).dot(R_tilde.col(1)) < 0)
+                b1 = -b1;
+
+            // 两解的前两列仅第三分量符号相反，第三列为前两列叉乘
+            Eigen::Matrix3d M;
+            M.block<2, 2>(0, 0) = R_tilde;
+            M(2, 0) = b0;
+            M(2, 1) = b1;
+            M.col(2) = M.col(0).cross(M.col(1));
+            R1 = Rv * M;
+
+            M(2, 0) = -b0;
+            M(2, 1) = -b1;
+            M.col(2) = M.col(0).cross(M.col(1));
+            R2 = Rv * M;
+            return true;
+        }
+
+        /**
+         * @brief 给定旋转，线性最小二乘求平移(最小化归一化平面上的代数误差)
+         */
+        Eigen::Vector3d computeTranslation(const Eigen::Vector2d* object, const Points2x4& image, const Eigen::Matrix3d& R)
+        {
+            // 每点两行：t_x - u * t_z = u * r_z - r_x, t_y - v * t_z = v * r_z - r_y
+            Eigen::Matrix3d AtA = Eigen::Matrix3d::Zero();
+            Eigen::Vector3d Atb = Eigen::Vector3d::Zero();
+            for (int ii = 0; ii < 4; ++ii)
+            {
+                Eigen::Vector3d r = R.leftCols<2>() * object[ii];
+                double u = image(0, ii), v = image(1, ii);
+                Eigen::Vector3d row_u(1.0, 0.0, -u);
+                Eigen::Vector3d row_v(0.0, 1.0, -v);
+                AtA += row_u * row_u.transpose() + row_v * row_v.transpose();
+                Atb += row_u * (u * r(2) - r(0)) + row_v * (v * r(2) - r(1));
+            }
+            return AtA.ldlt().solve(Atb);
+        }
+
+        /**
+         * @brief 归一化平面上的重投影误差平方和
+         */
+        double reprojectError(const Eigen::Vector2d* object, const Points2x4& image, const Eigen::Matrix3d& R, const Eigen::Vector3d& t)
+        {
+            double error = 0.0;
+            for (int ii = 0; ii < 4; ++ii)
+            {
+                Eigen::Vector3d point_cam = R.leftCols<2>() * object[ii] + t;
+                if (point_cam(2) <= 0.0)
+                    return std::numeric_limits<double>::max();
+                error += (point_cam.head<2>() / point_cam(2) - image.col(ii)).squaredNorm();
+            }
+            return error;
+        }
+
+        /**
+         * @brief Gauss-Newton最小化归一化平面重投影误差，旋转以左乘扰动exp(w^)更新
+         */
+        void refinePose(const Eigen::Vector2d* object, const Points2x4& image, int iterations, Eigen::Matrix3d& R, Eigen::Vector3d& t)
+        {
+            double error = reprojectError(object, image, R, t);
+            for (int iter = 0; iter < iterations; ++iter)
+            {
+                Eigen::Matrix<double, 6, 6> JtJ = Eigen::Matrix<double, 6, 6>::Zero();
+                Eigen::Matrix<double, 6, 1> Jtr = Eigen::Matrix<double, 6, 1>::Zero();
+                for (int ii = 0; ii < 4; ++ii)
+                {
+                    Eigen::Vector3d point_rot = R.leftCols<2>() * object[ii];
+                    Eigen::Vector3d point_cam = point_rot + t;
+                    double inv_z = 1.0 / point_cam(2);
+                    Eigen::Vector2d residual = point_cam.head<2>() * inv_z - image.col(ii);
+
+                    Eigen::Matrix<double, 2, 3> J_proj;
+                    J_proj << inv_z, 0.0, -point_cam(0) * inv_z * inv_z,
+                              0.0, inv_z, -point_cam(1) * inv_z * inv_z;
+                    // d(point_cam)/dw = -[R * P]^, d(point_cam)/dt = I
+                    Eigen::Matrix3d skew;
+                    skew << 0.0, -point_rot(2), point_rot(1),
+                            point_rot(2), 0.0, -point_rot(0),
+                            -point_rot(1), point_rot(0), 0.0;
+                    Eigen::Matrix<double, 2, 6> J;
+                    J.leftCols<3>() = -J_proj * skew;
+                    J.rightCols<3>() = J_proj;
+                    JtJ += J.transpose() * J;
+                    Jtr += J.transpose() * residual;
+                }
+                Eigen::Matrix<double, 6, 1> delta = -JtJ.ldlt().solve(Jtr);
+                if (!delta.allFinite())
+                    break;
+
+                double angle = delta.head<3>().norm();
+                Eigen::Matrix3d R_new = (angle > 0.0)
+                    ? Eigen::AngleAxisd(angle, delta.head<3>() / angle).toRotationMatrix() * R
+                    : R;
+                Eigen::Vector3d t_new = t + delta.tail<3>();
+                double error_new = reprojectError(object, image, R_new, t_new);
+                if (error_new >= error)
+                    break;
+                R = R_new;
+                t = t_new;
+                error = error_new;
+                if (delta.squaredNorm() < 1e-20)
+                    break;
+            }
+        }
+    } //namespace
+
+    const Eigen::Vector2d* armorObjectPoints(TargetType type)
+    {
+        if (type == SMALL)
+            return SMALL_ARMOR_POINTS;
+        else if (type == BIG)
+            return BIG_ARMOR_POINTS;
+        return nullptr;
+    }
+
+    bool solvePlanarPnP(const cv::Point2f* points_pic, TargetType type, const CameraModel& camera, int refine_iterations,
+        Eigen::Matrix3d& rmat, Eigen::Vector3d& tvec)
+    {
+        const Eigen::Vector2d* object = armorObjectPoints(type);
+        if (object == nullptr)
+            return false;
+
+        Points2x4 image;
+        for (int ii = 0; ii < 4; ++ii)
+            image.col(ii) = undistortPoint(points_pic[ii], camera);
+
+        Eigen::Matrix3d H;
+        if (!computeHomography(object, image, H))
+            return false;
+
+        // 物体原点(装甲板中心)处的单应雅可比
+        Eigen::Matrix2d J;
+        J << H(0, 0) - H(2, 0) * H(0, 2), H(0, 1) - H(2, 1) * H(0, 2),
+             H(1, 0) - H(2, 0) * H(1, 2), H(1, 1) - H(2, 1) * H(1, 2);
+        Eigen::Matrix3d R1, R2;
+        if (!computeRotations(J, Eigen::Vector2d(H(0, 2), H(1, 2)), R1, R2))
+            return false;
+
+        Eigen::Vector3d t1 = computeTranslation(object, image, R1);
+        Eigen::Vector3d t2 = computeTranslation(object, image, R2);
+        if (reprojectError(object, image, R1, t1) <= reprojectError(object, image, R2, t2))
+        {
+            rmat = R1;
+            tvec = t1;
+        }
+        else
+        {
+            rmat = R2;
+            tvec = t2;
+        }
+        if (!(tvec(2) > 0.0) || !tvec.allFinite())
+            return false;
+
+        refinePose(object, image, refine_iterations, rmat, tvec);
+        return true;
+    }
+} //namespace global_user
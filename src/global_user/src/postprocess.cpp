@@ -0,0 +1,105 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-21 20:15:33
+ * @LastEditTime: 2023-06-21 20:15:33
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/src/postprocess.cpp
+ */
+#include "../include/global_user/postprocess.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define POSTPROCESS_USE_X86
+#endif
+
+namespace global_user
+{
+    namespace
+    {
+        typedef int (*SelectFunc)(const float* data, int num, int stride, float thresh, int* indices);
+
+        // 标量处理[begin, num)，结果追加在indices[count]之后
+        inline int selectRange(const float* data, int begin, int num, int stride, float thresh, int* indices, int count)
+        {
+            for (int ii = begin; ii < num; ++ii)
+            {
+                if (data[(long)ii * stride] >= thresh)
+                    indices[count++] = ii;
+            }
+            return count;
+        }
+
+#ifndef POSTPROCESS_USE_X86
+        int selectScalar(const float* data, int num, int stride, float thresh, int* indices)
+        {
+            return selectRange(data, 0, num, stride, thresh, indices, 0);
+        }
+#else
+        // 将比较掩码中置位的lane转换为anchor下标
+        inline int appendMask(int mask, int base, int* indices, int count)
+        {
+            while (mask)
+            {
+                indices[count++] = base + __builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+            return count;
+        }
+
+        int selectSSE2(const float* data, int num, int stride, float thresh, int* indices)
+        {
+            const __m128 vthresh = _mm_set1_ps(thresh);
+            int count = 0;
+            int ii = 0;
+            for (; ii + 4 <= num; ii += 4)
+            {
+                const float* p = data + (long)ii * stride;
+                __m128 val = _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+                int mask = _mm_movemask_ps(_mm_cmpge_ps(val, vthresh));
+                count = appendMask(mask, ii, indices, count);
+            }
+            return selectRange(data, ii, num, stride, thresh, indices, count);
+        }
+
+#if defined(__GNUC__)
+        __attribute__((target("avx2")))
+        int selectAVX2(const float* data, int num, int stride, float thresh, int* indices)
+        {
+            const __m256 vthresh = _mm256_set1_ps(thresh);
+            const __m256i voffset = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+            int count = 0;
+            int ii = 0;
+            for (; ii + 8 <= num; ii += 8)
+            {
+                __m256 val = _mm256_i32gather_ps(data + (long)ii * stride, voffset, 4);
+                int mask = _mm256_movemask_ps(_mm256_cmp_ps(val, vthresh, _CMP_GE_OQ));
+                count = appendMask(mask, ii, indices, count);
+            }
+            return selectRange(data, ii, num, stride, thresh, indices, count);
+        }
+#endif
+#endif
+
+        SelectFunc selectImpl()
+        {
+#ifdef POSTPROCESS_USE_X86
+#if defined(__GNUC__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return selectAVX2;
+#endif
+            return selectSSE2;
+#else
+            return selectScalar;
+#endif
+        }
+
+        // 启动时按CPU特性选择一次
+        const SelectFunc select_impl = selectImpl();
+    } //namespace
+
+    int selectAboveThreshold(const float* data, int num, int stride, float thresh, int* indices)
+    {
+        return select_impl(data, num, stride, thresh, indices);
+    }
+} //namespace global_user
@@ -0,0 +1,50 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-18 15:20:41
+ * @LastEditTime: 2023-06-18 15:20:41
+ * @FilePath: /TUP-Vision-2023-Based/src/global_user/src/preprocess.cpp
+ */
+#include "../include/global_user/preprocess.hpp"
+
+#include <algorithm>
+
+namespace global_user
+{
+    void letterboxToImage(const cv::Mat& src, cv::Mat& dst, Eigen::Matrix<float, 3, 3>& transform_matrix)
+    {
+        CV_Assert(src.type() == CV_8UC3 && dst.type() == CV_8UC3);
+
+        float r = std::min(dst.cols / (src.cols * 1.0), dst.rows / (src.rows * 1.0));
+        int unpad_w = r * src.cols;
+        int unpad_h = r * src.rows;
+
+        int dw = dst.cols - unpad_w;
+        int dh = dst.rows - unpad_h;
+
+        dw /= 2;
+        dh /= 2;
+
+        transform_matrix << 1.0 / r, 0, -dw / r,
+                            0, 1.0 / r, -dh / r,
+                            0, 0, 1;
+
+        if (unpad_w <= 0 || unpad_h <= 0)
+        {
+            dst.setTo(cv::Scalar::all(0));
+            return;
+        }
+
+        // 尺寸与类型一致时cv::resize不重新分配，直接写入dst的对应区域
+        cv::Mat dst_roi = dst(cv::Rect(dw, dh, unpad_w, unpad_h));
+        uchar* roi_data = dst_roi.data;
+        cv::resize(src, dst_roi, dst_roi.size());
+        CV_Assert(dst_roi.data == roi_data);
+
+        // 补边
+        dst.rowRange(0, dh).setTo(cv::Scalar::all(0));
+        dst.rowRange(dh + unpad_h, dst.rows).setTo(cv::Scalar::all(0));
+        dst(cv::Rect(0, dh, dw, unpad_h)).setTo(cv::Scalar::all(0));
+        dst(cv::Rect(dw + unpad_w, dh, dst.cols - dw - unpad_w, unpad_h)).setTo(cv::Scalar::all(0));
+    }
+} //namespace global_user
@@ -0,0 +1,199 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-23 20:31:47
+ * @LastEditTime: 2023-06-23 20:31:47
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/benchmark/alloc_check.cpp
+ */
+/**
+ * @brief 检测流程稳态堆分配检查
+ * 替换malloc系列函数(glibc)统计分配次数，OpenCV、OpenVINO等库内的分配同样计入：
+ * decode: 对随机生成的网络输出反复decodeOutputs，稳态下应无任何分配；
+ * detect: 指定模型时对随机BGR图像及原始Bayer图像反复detect，分别统计调用线程及推理线程池中的分配次数。
+ * 预热若干帧后开始统计，调用线程上存在分配时返回非零；不指定模型时只检查decode，作为alloc_check_decode测试运行。
+ *
+ * 用法：ros2 run armor_detector alloc_check [model.xml] [iterations]
+ */
+#include "../include/inference/inference_api2.hpp"
+
+//c++
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+//linux
+#include <malloc.h>
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t num, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace
+{
+    std::atomic<bool> is_counting{false};
+    std::atomic<long> caller_alloc_num{0};  //调用线程中的分配次数
+    std::atomic<long> other_alloc_num{0};   //其他线程(如推理线程池)中的分配次数
+    __thread bool is_caller = false;
+
+    inline void countAlloc()
+    {
+        if (is_counting.load(std::memory_order_relaxed))
+        {
+            if (is_caller)
+                caller_alloc_num.fetch_add(1, std::memory_order_relaxed);
+            else
+                other_alloc_num.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+} //namespace
+
+// 与glibc声明的异常说明一致
+extern "C"
+{
+    void* malloc(size_t size) noexcept
+    {
+        countAlloc();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t num, size_t size) noexcept
+    {
+        countAlloc();
+        return __libc_calloc(num, size);
+    }
+
+    void* realloc(void* ptr, size_t size) noexcept
+    {
+        countAlloc();
+        return __libc_realloc(ptr, size);
+    }
+
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        countAlloc();
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        countAlloc();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+    {
+        countAlloc();
+        *ptr = __libc_memalign(alignment, size);
+        return (*ptr == nullptr) ? ENOMEM : 0;
+    }
+}
+
+using namespace armor_detector;
+
+namespace
+{
+    constexpr int FEAT_LEN = 25;
+
+    void startCounting()
+    {
+        caller_alloc_num = 0;
+        other_alloc_num = 0;
+        is_counting = true;
+    }
+
+    void stopCounting()
+    {
+        is_counting = false;
+    }
+
+    // 随机网络输出，部分anchor置信度超过阈值
+    void makeOutput(std::mt19937& rng, std::vector<float>& output)
+    {
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+        for (size_t ii = 0; ii < output.size(); ii += FEAT_LEN)
+        {
+            for (int k = 0; k < FEAT_LEN; k++)
+                output[ii + k] = uniform(rng);
+            output[ii + 8] = (uniform(rng) < 0.02f) ? 0.8f + 0.2f * uniform(rng) : 0.1f;
+        }
+    }
+
+    bool checkDecode(int iterations)
+    {
+        DecodeBuffer buffer;
+        initDecodeBuffer(buffer);
+        std::mt19937 rng(0);
+        std::vector<std::vector<float>> outputs(8, std::vector<float>(buffer.grid_strides.size() * FEAT_LEN));
+        for (auto& output : outputs)
+            makeOutput(rng, output);
+
+        Eigen::Matrix<float, 3, 3> transform_matrix;
+        transform_matrix << 3, 0, 0,
+                            0, 3, -96,
+                            0, 0, 1;
+        std::vector<ArmorObject> objects;
+        objects.reserve(128);
+        // 预热，缓冲区增长至最大所需容量
+        for (auto& output : outputs)
+            decodeOutputs(output.data(), buffer, objects, transform_matrix);
+
+        startCounting();
+        for (int ii = 0; ii < iterations; ++ii)
+            decodeOutputs(outputs[ii % outputs.size()].data(), buffer, objects, transform_matrix);
+        stopCounting();
+
+        printf("decode: %ld allocations in %d frames\n", caller_alloc_num.load(), iterations);
+        return caller_alloc_num == 0;
+    }
+
+    /**
+     * @param type CV_8UC3为BGR图像，CV_8UC1为原始BayerBG8图像(去马赛克与缩放合并的路径)
+     */
+    bool checkDetect(ArmorDetector& detector, int type, int iterations)
+    {
+        cv::Mat src(1024, 1280, type);
+        cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+        std::vector<ArmorObject> objects;
+        objects.reserve(128);
+        for (int ii = 0; ii < 20; ++ii)
+            detector.detect(src, objects);
+
+        startCounting();
+        for (int ii = 0; ii < iterations; ++ii)
+            detector.detect(src, objects);
+        stopCounting();
+
+        printf(
+            "detect(%s): %.2f allocations/frame in caller thread, %.2f allocations/frame in other threads (%d frames)\n",
+            type == CV_8UC1 ? "bayer" : "bgr",
+            caller_alloc_num.load() / (double)iterations, other_alloc_num.load() / (double)iterations, iterations
+        );
+        return caller_alloc_num == 0;
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    is_caller = true;
+    std::string model_path = (argc > 1) ? argv[1] : "";
+    int iterations = (argc > 2) ? atoi(argv[2]) : 200;
+
+    bool is_pass = checkDecode(iterations);
+    if (!model_path.empty())
+    {
+        ArmorDetector detector;
+        detector.initModel(model_path);
+        detector.warmUp(3);
+        is_pass = checkDetect(detector, CV_8UC3, iterations) && is_pass;
+        is_pass = checkDetect(detector, CV_8UC1, iterations) && is_pass;
+    }
+
+    printf("%s\n", is_pass ? "PASS" : "FAIL");
+    return is_pass ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-07-01 20:16:05
+ * @LastEditTime: 2023-07-01 20:16:05
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/benchmark/batch_benchmark.cpp
+ */
+/**
+ * @brief 多客户端共享推理服务组批效果对比
+ * 每个客户端一个线程(相当于component_container_mt中并行执行的各检测节点)反复detect：
+ * local: 各客户端独立initModel，互不组批；
+ * service: 各客户端共享InferenceService，统计总吞吐、单帧耗时及平均批大小。
+ * 另以单客户端使用服务与本地模型对比，验证无其他客户端时不等待max_wait。
+ *
+ * 用法：ros2 run armor_detector batch_benchmark <model.xml> [clients] [iterations] [max_wait(ms)]
+ */
+#include "../include/inference/inference_api2.hpp"
+#include "../include/inference/inference_service.hpp"
+
+//c++
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace armor_detector;
+
+namespace
+{
+    struct BatchResult
+    {
+        double fps;         //所有客户端的总吞吐
+        double latency;     //单帧detect平均耗时(ms)
+    };
+
+    BatchResult run(std::vector<std::unique_ptr<ArmorDetector>>& detectors, int iterations)
+    {
+        std::vector<cv::Mat> srcs(detectors.size());
+        for (auto& src : srcs)
+        {
+            src.create(1024, 1280, CV_8UC3);
+            cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+        }
+
+        std::vector<double> latencies(detectors.size(), 0.0);
+        std::vector<std::thread> threads;
+        auto st = std::chrono::steady_clock::now();
+        for (size_t ii = 0; ii < detectors.size(); ++ii)
+        {
+            threads.emplace_back([&, ii]()
+            {
+                std::vector<ArmorObject> objects;
+                objects.reserve(128);
+                for (int jj = 0; jj < iterations; ++jj)
+                {
+                    auto frame_st = std::chrono::steady_clock::now();
+                    detectors[ii]->detect(srcs[ii], objects);
+                    latencies[ii] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_st).count();
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - st).count();
+
+        double latency = 0.0;
+        for (auto time : latencies)
+            latency += time;
+        int frame_num = iterations * detectors.size();
+        return {frame_num / duration, latency / frame_num};
+    }
+
+    void report(const char* name, const BatchResult& result)
+    {
+        printf("%-10s fps: %8.1f  latency: %7.2fms\n", name, result.fps, result.latency);
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <model.xml> [clients] [iterations] [max_wait(ms)]\n", argv[0]);
+        return 1;
+    }
+    std::string model_path = argv[1];
+    int clients = (argc > 2) ? atoi(argv[2]) : 3;
+    int iterations = (argc > 3) ? atoi(argv[3]) : 200;
+    InferServiceParam param;
+    param.max_batch = clients;
+    param.max_wait = (argc > 4) ? atof(argv[4]) : 4.0;
+
+    // 单客户端：服务不应比本地模型多出max_wait的等待
+    {
+        std::vector<std::unique_ptr<ArmorDetector>> detectors;
+        detectors.emplace_back(std::make_unique<ArmorDetector>());
+        detectors.back()->initModel(model_path);
+        detectors.back()->warmUp(3);
+        report("local x1", run(detectors, iterations));
+    }
+    {
+        auto service = InferenceService::acquire(model_path, param);
+        if (!service)
+            return 1;
+        std::vector<std::unique_ptr<ArmorDetector>> detectors;
+        detectors.emplace_back(std::make_unique<ArmorDetector>());
+        detectors.back()->initService(service);
+        detectors.back()->warmUp(3);
+        report("service x1", run(detectors, iterations));
+    }
+
+    // 多客户端
+    {
+        std::vector<std::unique_ptr<ArmorDetector>> detectors;
+        for (int ii = 0; ii < clients; ++ii)
+        {
+            detectors.emplace_back(std::make_unique<ArmorDetector>());
+            detectors.back()->initModel(model_path);
+            detectors.back()->warmUp(3);
+        }
+        report("local", run(detectors, iterations));
+    }
+    {
+        std::vector<std::unique_ptr<ArmorDetector>> detectors;
+        std::shared_ptr<InferenceService> service;
+        for (int ii = 0; ii < clients; ++ii)
+        {
+            service = InferenceService::acquire(model_path, param);
+            if (!service)
+                return 1;
+            detectors.emplace_back(std::make_unique<ArmorDetector>());
+            detectors.back()->initService(service);
+            detectors.back()->warmUp(3);
+        }
+        uint64_t batch_st = service->batchCount();
+        uint64_t frame_st = service->frameCount();
+        report("service", run(detectors, iterations));
+        printf("average batch: %.2f (max batch %d, max wait %.1fms, %d requests)\n",
+            (service->frameCount() - frame_st) / (double)std::max<uint64_t>(1, service->batchCount() - batch_st),
+            param.max_batch, param.max_wait, service->num_requests_);
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-22 21:05:19
+ * @LastEditTime: 2023-06-22 21:05:19
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/benchmark/nms_benchmark.cpp
+ */
+/**
+ * @brief 网络输出解码(候选框生成、排序、NMS及合并)耗时对比
+ * 原实现：逐帧生成网格、全部anchor解码、递归快排候选框对象、逐对比较的NMS；
+ * 新实现：decodeOutputs(置信度预筛选、下标top-K、SoA位掩码NMS、角点累加合并)。
+ * 以随机生成的网络输出模拟哨兵视角下多车同框的密集场景，每块装甲板由多个相邻anchor命中，
+ * 同时输出两者检测结果的数量及角点(合并平均后)最大差值。
+ *
+ * 用法：ros2 run armor_detector nms_benchmark [iterations]
+ */
+#include "../include/inference/inference_api2.hpp"
+
+//c++
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace armor_detector;
+
+namespace
+{
+    constexpr int INPUT_SIZE = 416;
+    constexpr int NUM_COLORS = 8;
+    constexpr int NUM_CLASSES = 8;
+    constexpr int FEAT_LEN = 9 + NUM_COLORS + NUM_CLASSES;
+    constexpr int TOPK = 128;
+    constexpr float NMS_THRESH = 0.3;
+    constexpr float BBOX_CONF_THRESH = 0.75;
+    constexpr float MERGE_CONF_ERROR = 0.15;
+    constexpr float MERGE_MIN_IOU = 0.9;
+
+    int argmax(const float* ptr, int len)
+    {
+        int max_arg = 0;
+        for (int i = 1; i < len; i++)
+        {
+            if (ptr[i] > ptr[max_arg]) max_arg = i;
+        }
+        return max_arg;
+    }
+
+    // 与检测器中原有的解码流程一致，候选框对象带有堆上的角点数组
+    struct RefObject : ArmorObject
+    {
+        std::vector<cv::Point2f> pts;
+    };
+
+    void qsortReference(std::vector<RefObject>& objects, int left, int right)
+    {
+        int i = left;
+        int j = right;
+        float p = objects[(left + right) / 2].prob;
+        while (i <= j)
+        {
+            while (objects[i].prob > p)
+                i++;
+            while (objects[j].prob < p)
+                j--;
+            if (i <= j)
+            {
+                std::swap(objects[i], objects[j]);
+                i++;
+                j--;
+            }
+        }
+        if (left < j) qsortReference(objects, left, j);
+        if (i < right) qsortReference(objects, i, right);
+    }
+
+    void decodeReference(const float* prob, std::vector<ArmorObject>& objects, Eigen::Matrix<float, 3, 3>& transform_matrix)
+    {
+        std::vector<GridAndStride> grid_strides;
+        for (int stride : {8, 16, 32})
+        {
+            for (int g1 = 0; g1 < INPUT_SIZE / stride; g1++)
+            {
+                for (int g0 = 0; g0 < INPUT_SIZE / stride; g0++)
+                    grid_strides.push_back({g0, g1, stride});
+            }
+        }
+
+        std::vector<RefObject> proposals;
+        for (int anchor_idx = 0; anchor_idx < (int)grid_strides.size(); anchor_idx++)
+        {
+            const float* feat = prob + anchor_idx * FEAT_LEN;
+            if (feat[8] < BBOX_CONF_THRESH)
+                continue;
+
+            const GridAndStride& gs = grid_strides[anchor_idx];
+            Eigen::Matrix<float, 3, 4> apex_norm;
+            apex_norm << (feat[0] + gs.grid0) * gs.stride, (feat[2] + gs.grid0) * gs.stride, (feat[4] + gs.grid0) * gs.stride, (feat[6] + gs.grid0) * gs.stride,
+                         (feat[1] + gs.grid1) * gs.stride, (feat[3] + gs.grid1) * gs.stride, (feat[5] + gs.grid1) * gs.stride, (feat[7] + gs.grid1) * gs.stride,
+                         1, 1, 1, 1;
+            Eigen::Matrix<float, 3, 4> apex_dst = transform_matrix * apex_norm;
+
+            RefObject obj;
+            for (int i = 0; i < 4; i++)
+            {
+                obj.apex[i] = cv::Point2f(apex_dst(0, i), apex_dst(1, i));
+                obj.pts.push_back(obj.apex[i]);
+            }
+            std::vector<cv::Point2f> tmp(obj.apex, obj.apex + 4);
+            obj.rect = cv::boundingRect(tmp);
+            obj.cls = argmax(feat + 9 + NUM_COLORS, NUM_CLASSES);
+            obj.color = argmax(feat + 9, NUM_COLORS);
+            obj.prob = feat[8];
+            proposals.push_back(obj);
+        }
+        if (!proposals.empty())
+            qsortReference(proposals, 0, proposals.size() - 1);
+        if (proposals.size() >= TOPK)
+            proposals.resize(TOPK);
+
+        std::vector<int> picked;
+        for (int i = 0; i < (int)proposals.size(); i++)
+        {
+            RefObject& a = proposals[i];
+            bool keep = true;
+            for (int j : picked)
+            {
+                RefObject& b = proposals[j];
+                float inter_area = (a.rect & b.rect).area();
+                float iou = inter_area / (a.rect.area() + b.rect.area() - inter_area);
+                if (iou > NMS_THRESH || std::isnan(iou))
+                {
+                    keep = false;
+                    if (iou > MERGE_MIN_IOU && std::abs(a.prob - b.prob) < MERGE_CONF_ERROR && a.cls == b.cls && a.color == b.color)
+                    {
+                        for (int k = 0; k < 4; k++)
+                            b.pts.push_back(a.apex[k]);
+                    }
+                }
+            }
+            if (keep)
+                picked.push_back(i);
+        }
+        // 对合并的角点求平均
+        objects.clear();
+        for (int i : picked)
+        {
+            RefObject& object = proposals[i];
+            int n = object.pts.size() / 4;
+            for (int k = 0; k < 4; k++)
+            {
+                cv::Point2f sum(0, 0);
+                for (int m = 0; m < n; m++)
+                    sum += object.pts[4 * m + k];
+                object.apex[k] = sum / (float)n;
+            }
+            objects.push_back(object);
+        }
+    }
+
+    /**
+     * @brief 生成密集场景的网络输出
+     * 每辆车可见两块装甲板，每块装甲板由周围各尺度的多个anchor命中，角点带少量抖动；
+     * 部分anchor类别预测错误，另有随机的零散误检
+     */
+    void makeScene(int robot_num, std::mt19937& rng, std::vector<float>& output)
+    {
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+        std::normal_distribution<float> jitter(0.f, 0.4f);
+        std::fill(output.begin(), output.end(), 0.f);
+
+        std::vector<GridAndStride> grid_strides;
+        for (int stride : {8, 16, 32})
+        {
+            for (int g1 = 0; g1 < INPUT_SIZE / stride; g1++)
+            {
+                for (int g0 = 0; g0 < INPUT_SIZE / stride; g0++)
+                    grid_strides.push_back({g0, g1, stride});
+            }
+        }
+
+        for (int armor = 0; armor < robot_num * 2; armor++)
+        {
+            float w = 10.f + 30.f * uniform(rng);
+            float h = w * (0.4f + 0.2f * uniform(rng));
+            float cx = w + (INPUT_SIZE - 2 * w) * uniform(rng);
+            float cy = h + (INPUT_SIZE - 2 * h) * uniform(rng);
+            float apex[8] = {cx - w / 2, cy - h / 2, cx - w / 2, cy + h / 2, cx + w / 2, cy + h / 2, cx + w / 2, cy - h / 2};
+            int color = rng() % 2;
+            int cls = rng() % NUM_CLASSES;
+
+            for (int anchor_idx = 0; anchor_idx < (int)grid_strides.size(); anchor_idx++)
+            {
+                const GridAndStride& gs = grid_strides[anchor_idx];
+                float gx = (gs.grid0 + 0.5f) * gs.stride;
+                float gy = (gs.grid1 + 0.5f) * gs.stride;
+                if (std::abs(gx - cx) > w / 2 + gs.stride / 2 || std::abs(gy - cy) > h / 2 + gs.stride / 2)
+                    continue;
+
+                float* feat = output.data() + anchor_idx * FEAT_LEN;
+                float prob = 0.7f + 0.28f * uniform(rng);
+                if (prob <= feat[8])
+                    continue;
+                for (int i = 0; i < 4; i++)
+                {
+                    feat[2 * i] = (apex[2 * i] + jitter(rng)) / gs.stride - gs.grid0;
+                    feat[2 * i + 1] = (apex[2 * i + 1] + jitter(rng)) / gs.stride - gs.grid1;
+                }
+                feat[8] = prob;
+                std::fill(feat + 9, feat + FEAT_LEN, 0.f);
+                feat[9 + color] = 1.f;
+                feat[9 + NUM_COLORS + ((uniform(rng) < 0.1f) ? (int)(rng() % NUM_CLASSES) : cls)] = 1.f;
+            }
+        }
+
+        // 零散误检
+        for (int ii = 0; ii < robot_num; ii++)
+        {
+            int anchor_idx = rng() % grid_strides.size();
+            float* feat = output.data() + anchor_idx * FEAT_LEN;
+            if (feat[8] > 0.f)
+                continue;
+            for (int i = 0; i < 8; i++)
+                feat[i] = 2.f * uniform(rng) - 0.5f;
+            feat[8] = 0.76f;
+            feat[9] = 1.f;
+            feat[9 + NUM_COLORS] = 1.f;
+        }
+    }
+
+    float maxApexDiff(const std::vector<ArmorObject>& ref, const std::vector<ArmorObject>& test)
+    {
+        float max_diff = 0.f;
+        for (const auto& a : ref)
+        {
+            float min_diff = FLT_MAX;
+            for (const auto& b : test)
+            {
+                if (a.cls != b.cls || a.color != b.color)
+                    continue;
+                float diff = 0.f;
+                for (int i = 0; i < 4; i++)
+                    diff = std::max(diff, (float)cv::norm(a.apex[i] - b.apex[i]));
+                min_diff = std::min(min_diff, diff);
+            }
+            max_diff = std::max(max_diff, min_diff);
+        }
+        return max_diff;
+    }
+
+    void runCase(int robot_num, int iterations)
+    {
+        const int num_anchors = (52 * 52 + 26 * 26 + 13 * 13);
+        std::mt19937 rng(robot_num);
+        std::vector<std::vector<float>> scenes(16, std::vector<float>(num_anchors * FEAT_LEN));
+        for (auto& scene : scenes)
+            makeScene(robot_num, rng, scene);
+
+        Eigen::Matrix<float, 3, 3> transform_matrix;
+        transform_matrix << 1280.f / INPUT_SIZE, 0, 0,
+                            0, 1280.f / INPUT_SIZE, -128,
+                            0, 0, 1;
+        DecodeBuffer buffer;
+        initDecodeBuffer(buffer);
+        std::vector<ArmorObject> ref_objects;
+        std::vector<ArmorObject> objects;
+
+        int proposal_num = 0;
+        int object_num = 0;
+        bool is_count_equal = true;
+        float max_diff = 0.f;
+        for (auto& scene : scenes)
+        {
+            decodeReference(scene.data(), ref_objects, transform_matrix);
+            decodeOutputs(scene.data(), buffer, objects, transform_matrix);
+            proposal_num += buffer.order.size();
+            object_num += objects.size();
+            is_count_equal = is_count_equal && ref_objects.size() == objects.size();
+            max_diff = std::max(max_diff, maxApexDiff(ref_objects, objects));
+        }
+
+        auto st = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            decodeReference(scenes[ii % scenes.size()].data(), ref_objects, transform_matrix);
+        }
+        auto mid = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            decodeOutputs(scenes[ii % scenes.size()].data(), buffer, objects, transform_matrix);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double ref_us = std::chrono::duration<double, std::micro>(mid - st).count() / iterations;
+        double new_us = std::chrono::duration<double, std::micro>(end - mid).count() / iterations;
+        printf(
+            "robots: %2d  proposals: %5.1f  objects: %5.1f  reference: %8.1fus  new: %7.1fus(%.2fx)  count_equal: %d  max_apex_diff: %.4f\n",
+            robot_num, proposal_num / (double)scenes.size(), object_num / (double)scenes.size(),
+            ref_us, new_us, ref_us / new_us, (int)is_count_equal, max_diff
+        );
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+
+    // 单车至哨兵视角下全场多车同框
+    runCase(0, iterations);
+    runCase(1, iterations);
+    runCase(4, iterations);
+    runCase(8, iterations);
+    runCase(14, iterations);
+    return 0;
+}
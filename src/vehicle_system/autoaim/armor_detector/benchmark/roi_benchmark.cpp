@@ -0,0 +1,167 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-27 20:05:18
+ * @LastEditTime: 2023-06-27 20:05:18
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/benchmark/roi_benchmark.cpp
+ */
+/**
+ * @brief ROI裁剪端到端检测耗时对比(回放视频或图像序列)
+ * full: 全图检测；
+ * roi copy: 按ROI拷贝后检测(原有方式)；
+ * roi view: ROI视图直接送入预处理(当前方式)。
+ * ROI以全图检测到的最大装甲板为中心(无目标时为图像中心)，偏移取偶数。
+ * 统计裁剪及裁剪+检测的平均与p95耗时，bayer参数将回放图像转换为BayerBG8以模拟原始图像输入。
+ *
+ * 用法：ros2 run armor_detector roi_benchmark <model.xml> <video|image_pattern> [roi_size] [max_frames] [bayer]
+ */
+#include "../include/inference/inference_api2.hpp"
+
+//c++
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace armor_detector;
+
+namespace
+{
+    struct Stat
+    {
+        std::vector<double> crop;
+        std::vector<double> total;
+    };
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        size_t idx = std::min(values.size() - 1, (size_t)(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + idx, values.end());
+        return values[idx];
+    }
+
+    double mean(const std::vector<double>& values)
+    {
+        double sum = 0.0;
+        for (auto value : values)
+            sum += value;
+        return values.empty() ? 0.0 : sum / values.size();
+    }
+
+    void report(const char* name, const Stat& stat, int detected)
+    {
+        printf(
+            "%-9s crop: %6.3fms (p95 %6.3fms)  crop+detect: %7.3fms (p95 %7.3fms)  detected frames: %d\n",
+            name, mean(stat.crop), percentile(stat.crop, 0.95), mean(stat.total), percentile(stat.total, 0.95), detected
+        );
+    }
+
+    // BGR图像按BGGR排列采样为单通道Bayer图像
+    cv::Mat toBayer(const cv::Mat& bgr)
+    {
+        cv::Mat bayer(bgr.rows & ~1, bgr.cols & ~1, CV_8UC1);
+        for (int y = 0; y < bayer.rows; ++y)
+        {
+            const cv::Vec3b* src = bgr.ptr<cv::Vec3b>(y);
+            uchar* dst = bayer.ptr<uchar>(y);
+            for (int x = 0; x < bayer.cols; ++x)
+            {
+                int channel = (y & 1) + (x & 1);    //BG/GR
+                dst[x] = src[x][channel];
+            }
+        }
+        return bayer;
+    }
+
+    cv::Rect centeredRoi(const cv::Point2f& center, int roi_size, const cv::Size& img_size)
+    {
+        int w = std::min(roi_size, img_size.width) & ~1;
+        int h = std::min(roi_size, img_size.height) & ~1;
+        int x = std::max(0, std::min((int)center.x - w / 2, img_size.width - w)) & ~1;
+        int y = std::max(0, std::min((int)center.y - h / 2, img_size.height - h)) & ~1;
+        return cv::Rect(x, y, w, h);
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s <model.xml> <video|image_pattern> [roi_size] [max_frames] [bayer]\n", argv[0]);
+        return 1;
+    }
+    std::string model_path = argv[1];
+    std::string sequence_path = argv[2];
+    int roi_size = (argc > 3) ? atoi(argv[3]) : 640;
+    int max_frames = (argc > 4) ? atoi(argv[4]) : 300;
+    bool use_bayer = (argc > 5) && strcmp(argv[5], "bayer") == 0;
+
+    // 预先读入内存，解码耗时不计入
+    std::vector<cv::Mat> frames;
+    cv::VideoCapture capture(sequence_path);
+    cv::Mat frame;
+    while ((int)frames.size() < max_frames && capture.read(frame))
+    {
+        frames.emplace_back(use_bayer ? toBayer(frame) : frame.clone());
+    }
+    if (frames.empty())
+    {
+        printf("No frames read from %s\n", sequence_path.c_str());
+        return 1;
+    }
+    printf("%zu frames %dx%d%s, roi %d\n", frames.size(), frames[0].cols, frames[0].rows, use_bayer ? " (bayer)" : "", roi_size);
+
+    ArmorDetector detector;
+    detector.initModel(model_path);
+    detector.warmUp(10);
+
+    Stat full_stat, copy_stat, view_stat;
+    int full_detected = 0, copy_detected = 0, view_detected = 0;
+    std::vector<ArmorObject> objects;
+    cv::Mat roi_img;
+    for (auto& img : frames)
+    {
+        auto st = std::chrono::steady_clock::now();
+        bool is_detected = detector.detect(img, objects);
+        full_stat.crop.emplace_back(0.0);
+        full_stat.total.emplace_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count());
+        full_detected += is_detected;
+
+        cv::Point2f center(img.cols / 2.f, img.rows / 2.f);
+        if (is_detected)
+        {
+            auto largest = std::max_element(objects.begin(), objects.end(), [](const ArmorObject& prev, const ArmorObject& next)
+            {
+                return prev.area < next.area;
+            });
+            center = (largest->apex[0] + largest->apex[1] + largest->apex[2] + largest->apex[3]) / 4.f;
+        }
+        cv::Rect roi = centeredRoi(center, roi_size, img.size());
+
+        st = std::chrono::steady_clock::now();
+        img(roi).copyTo(roi_img);
+        auto crop_end = std::chrono::steady_clock::now();
+        copy_detected += detector.detect(roi_img, objects);
+        auto end = std::chrono::steady_clock::now();
+        copy_stat.crop.emplace_back(std::chrono::duration<double, std::milli>(crop_end - st).count());
+        copy_stat.total.emplace_back(std::chrono::duration<double, std::milli>(end - st).count());
+
+        st = std::chrono::steady_clock::now();
+        cv::Mat roi_view = img(roi);
+        crop_end = std::chrono::steady_clock::now();
+        view_detected += detector.detect(roi_view, objects);
+        end = std::chrono::steady_clock::now();
+        view_stat.crop.emplace_back(std::chrono::duration<double, std::milli>(crop_end - st).count());
+        view_stat.total.emplace_back(std::chrono::duration<double, std::milli>(end - st).count());
+    }
+
+    report("full", full_stat, full_detected);
+    report("roi copy", copy_stat, copy_detected);
+    report("roi view", view_stat, view_detected);
+    return 0;
+}
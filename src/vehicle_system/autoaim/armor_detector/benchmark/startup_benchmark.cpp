@@ -0,0 +1,106 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-19 21:37:52
+ * @LastEditTime: 2023-06-19 21:37:52
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/benchmark/startup_benchmark.cpp
+ */
+/**
+ * @brief 检测器启动耗时对比
+ * no cache: 每次read_model + compile_model(原有方式)；
+ * cold: 缓存未命中，编译后导出到缓存；
+ * warm: 由缓存import_model。
+ * 每项同时统计首帧推理耗时，二者之和即重启后恢复检测所需时间。
+ *
+ * 用法：ros2 run armor_detector startup_benchmark <model.xml> [cache_dir] [warm_runs]
+ */
+#include "../include/inference/inference_api2.hpp"
+
+//c++
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+//linux
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace armor_detector;
+
+namespace
+{
+    struct StartupTime
+    {
+        double init;
+        double first_infer;
+        bool is_cache_hit;
+    };
+
+    StartupTime startup(const std::string& model_path, const std::string& cache_dir)
+    {
+        ArmorDetector detector;
+        detector.initModel(model_path, cache_dir);
+
+        auto st = std::chrono::steady_clock::now();
+        detector.warmUp(1);
+        auto end = std::chrono::steady_clock::now();
+        return {detector.init_time_, std::chrono::duration<double, std::milli>(end - st).count(), detector.is_cache_hit_};
+    }
+
+    void clearCache(const std::string& cache_dir)
+    {
+        DIR* dir = opendir(cache_dir.c_str());
+        if (dir == nullptr)
+            return;
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 5 && name.substr(name.size() - 5) == ".blob")
+                std::remove((cache_dir + "/" + name).c_str());
+        }
+        closedir(dir);
+    }
+
+    void report(const char* name, const StartupTime& time)
+    {
+        printf(
+            "%-9s init: %9.1fms  first infer: %7.1fms  total: %9.1fms  cache hit: %d\n",
+            name, time.init, time.first_infer, time.init + time.first_infer, (int)time.is_cache_hit
+        );
+    }
+} //namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <model.xml> [cache_dir] [warm_runs]\n", argv[0]);
+        return 1;
+    }
+    std::string model_path = argv[1];
+    std::string cache_dir = (argc > 2) ? argv[2] : "/tmp/armor_detector_startup_benchmark_" + std::to_string(getpid());
+    int warm_runs = (argc > 3) ? atoi(argv[3]) : 3;
+
+    report("no cache", startup(model_path, ""));
+
+    clearCache(cache_dir);
+    report("cold", startup(model_path, cache_dir));
+
+    double warm_total = 0.0;
+    for (int ii = 0; ii < warm_runs; ++ii)
+    {
+        StartupTime time = startup(model_path, cache_dir);
+        report("warm", time);
+        warm_total += time.init + time.first_infer;
+    }
+    if (warm_runs > 0)
+        printf("warm average total: %.1fms\n", warm_total / warm_runs);
+
+    if (argc <= 2)
+    {   //未指定缓存目录时清理临时缓存
+        clearCache(cache_dir);
+        rmdir(cache_dir.c_str());
+    }
+    return 0;
+}
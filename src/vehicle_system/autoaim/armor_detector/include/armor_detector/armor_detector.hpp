@@ -40,9 +40,19 @@ namespace armor_detector
 
         // void run();
         bool armor_detect(TaskData &src, bool& is_target_lost);
+        void resetPipeline();
+        bool isTiledMode(int mode);
+        bool isFlowFrame(int mode);
+        bool trackObjects(const TaskData& src);
+        void updateFlowTracks(const TaskData& src);
+        void scheduleTiles(const Size2i& img_size, const Point2i& img_offset);
         bool gyro_detector(TaskData &src, global_interface::msg::Autoaim& target_info, ObjHPMsg hp = ObjHPMsg(), DecisionMsg decision_msg = DecisionMsg());
 
-        Point2i cropImageByROI(Mat &img);
+        Point2i cropImageByROI(Mat &img, const Point2i& img_offset, const Size2i& full_size, int64_t timestamp, const Eigen::Matrix3d& rmat_imu);
+        bool predictRoiCenter(int64_t timestamp, const Eigen::Matrix3d& rmat_imu, Point2i& center, Point2f& margin);
+        void updateTargetMotion(const Armor& target, bool is_spinning, bool is_switched);
+        void updateRoiStat(const Size2i& input_size, const Size2i& full_size);
+        Point2i cropImage(Mat &img, const Rect& roi, const Point2i& img_offset);
         ArmorTracker* chooseTargetTracker(TaskData& src, vector<ArmorTracker*> trackers);
         int chooseTargetID(TaskData& src);
         int chooseTargetID(TaskData& src, std::vector<Armor>& armors, ObjHPMsg hp = ObjHPMsg(), DecisionMsg decision_msg = DecisionMsg());
@@ -59,10 +69,14 @@ namespace armor_detector
         atomic<int> target_id_ = -1; 
 
         bool is_init_;
+        Rect roi_request_;  //期望相机下一帧采集的硬件ROI(全幅坐标)，为空表示全幅
         ofstream data_save_;
         bool is_save_data_;
         atomic<int> mode_;
 
+        // 流水线推理时armor_detect输出的是更早提交的帧(src被替换为该帧)，流水线未填满时无结果
+        bool is_result_ready_ = false;
+
     private:
         Armor last_armor_;
         std::vector<ArmorObject> objects_;
@@ -100,6 +114,75 @@ namespace armor_detector
         
         Point2i roi_offset_;
         Size2i input_size_;
+
+        // 预测ROI所用的目标运动估计
+        Eigen::Vector3d last_target_world_ = Eigen::Vector3d::Zero();
+        Eigen::Vector3d target_velocity_ = Eigen::Vector3d::Zero();    //世界系速度
+        int64_t last_target_timestamp_ = 0;
+        bool is_velocity_valid_ = false;
+        bool is_last_target_spinning_ = false;
+
+        // ROI帧与全图帧的目标丢失统计(仅统计上一帧存在目标的帧)
+        struct RoiStat
+        {
+            int64_t roi_frames = 0;
+            int64_t roi_misses = 0;
+            int64_t full_frames = 0;
+            int64_t full_misses = 0;
+            double saved_ratio_sum = 0.0;   //ROI帧节省的像素比例之和
+            bool is_pending = false;        //待结算的上一结果帧
+            bool is_pending_roi = false;
+            double pending_saved_ratio = 0.0;
+        };
+        RoiStat roi_stat_;
+
+        // 推理间隔帧的光流角点跟踪
+        struct FlowState
+        {
+            std::vector<ArmorObject> objects;   //上一帧确认的装甲板，角点为全幅坐标
+            std::vector<ArmorObject> result;    //本帧跟踪结果，角点为输入图像坐标
+            Mat prev_gray;                      //上一帧跟踪区域灰度图
+            Mat gray;
+            Rect rect;                          //跟踪区域(全幅坐标)
+            std::vector<Point2f> prev_pts;
+            std::vector<Point2f> next_pts;
+            std::vector<Point2f> back_pts;
+            std::vector<uchar> status;
+            std::vector<uchar> back_status;
+            std::vector<float> err;
+            int frame_cnt = 0;                  //距上次推理的帧数
+        };
+        FlowState flow_;
+
+        // 候选装甲板PnP槽位，逐帧复用
+        struct PnpSlot
+        {
+            Armor armor;
+            std::vector<Point2f> points_pic;
+            TargetType target_type;
+            int pnp_method;
+            bool is_valid = false;
+        };
+        std::vector<PnpSlot> pnp_slots_;
+        void solveArmorPnp(PnpSlot& slot);
+
+        // 流水线中在途帧的上下文，与推理请求按相同顺序提交、取回
+        struct PipelineFrame
+        {
+            TaskData src;
+            Mat input;
+            Point2i roi_offset;
+            rclcpp::Time time_start;
+            rclcpp::Time time_crop;
+        };
+        std::deque<PipelineFrame> pipeline_frames_;
+
+        // 分块推理
+        std::vector<Rect> tiles_;           //当前帧的分块(输入图像坐标)
+        std::vector<Rect> search_tiles_;    //无目标时轮询的搜索网格
+        int search_idx_ = 0;
+        Size2i search_img_size_;
+        int search_tile_size_ = 0;
         
     private:
         SwitchStatus last_last_status_;
@@ -14,6 +14,7 @@
 #include <cv_bridge/cv_bridge.h>
 #include <sensor_msgs/msg/image.hpp>
 #include <sensor_msgs/msg/camera_info.hpp>
+#include <sensor_msgs/msg/region_of_interest.hpp>
 #include <image_transport/image_transport.hpp>
 #include <ament_index_cpp/get_package_share_directory.hpp>
 #include <tf2/LinearMath/Quaternion.h>
@@ -43,6 +44,10 @@ namespace armor_detector
         // Pub target armor msg.
         rclcpp::Publisher<AutoaimMsg>::SharedPtr armor_msg_pub_;
 
+        // Pub hardware roi request to camera.
+        rclcpp::Publisher<sensor_msgs::msg::RegionOfInterest>::SharedPtr roi_request_pub_;
+        void publishRoiRequest(const cv::Rect& roi);
+
     private:    
         // Params callback.
         bool updateParam();
@@ -54,12 +59,24 @@ namespace armor_detector
         std::shared_ptr<image_transport::Subscriber> img_msg_sub_;
         void imageCallback(const sensor_msgs::msg::Image::ConstSharedPtr &img_msg);
 
+        // 启用硬件ROI时同步订阅camera_info以获取ROI偏移
+        std::shared_ptr<image_transport::CameraSubscriber> camera_sub_;
+        void cameraCallback(const sensor_msgs::msg::Image::ConstSharedPtr &img_msg, const sensor_msgs::msg::CameraInfo::ConstSharedPtr &info_msg);
+
         // Subscribe serial msg.
         SerialMsg serial_msg_;
         Mutex serial_msg_mutex_;
         rclcpp::Subscription<SerialMsg>::SharedPtr serial_msg_sub_;
         void sensorMsgCallback(const SerialMsg& serial_msg);
 
+        // 模型保温
+        int keep_warm_interval_;
+        int64_t last_infer_ns_;
+        void keepWarm();
+
+        // 流水线中在途帧对应的图像消息
+        std::deque<sensor_msgs::msg::Image::ConstSharedPtr> inflight_imgs_;
+
     public:
         Mutex param_mutex_;
         DetectorParam detector_params_;
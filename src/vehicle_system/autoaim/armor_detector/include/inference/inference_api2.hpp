@@ -9,9 +9,15 @@
 #define INFERENCE_API2_HPP_
 
 //c++
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <chrono>
 #include <iterator>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
@@ -26,15 +32,100 @@
 #include <Eigen/Core>
 
 #include "../../global_user/include/global_user/global_user.hpp"
+#include "../../global_user/include/global_user/preprocess.hpp"
+#include "../../global_user/include/global_user/postprocess.hpp"
+#include "../../global_user/include/global_user/model_cache.hpp"
+#include "./inference_service.hpp"
 
 using namespace global_user;
 namespace armor_detector
 {
-    struct ArmorObject : Object
+    /**
+     * @brief 装甲板检测结果
+     * 不含堆上成员，拷贝不分配内存；NMS合并的候选框角点累加到pts_sum，解码结束时取平均写入apex
+     */
+    struct ArmorObject
     {
+        cv::Rect_<float> rect;
+        int cls;
+        int color;
+        float prob;
         int area;
         cv::Point2f apex[4];
+        cv::Point2f pts_sum[4];     //合并的候选框角点之和(含自身)
+        int pts_num;                //合并的候选框数量(含自身)
     };
+    // 旧版OpenCV的cv::Point2f带有自定义拷贝构造，此时仅能保证无堆上成员
+    static_assert(!std::is_trivially_copyable<cv::Point2f>::value || std::is_trivially_copyable<ArmorObject>::value,
+        "ArmorObject should be trivially copyable");
+
+    /**
+     * @brief 单帧推理各阶段耗时(ms)
+     */
+    struct InferTiming
+    {
+        double preprocess = 0.0;    //letterbox缩放及填充输入张量
+        double infer = 0.0;         //提交推理至推理完成
+        double wait = 0.0;          //取结果时阻塞等待的时间
+        double decode = 0.0;        //解码及NMS
+    };
+
+    /**
+     * @brief 解码所用的网格及中间结果，initModel时分配，逐帧复用
+     */
+    struct DecodeBuffer
+    {
+        std::vector<GridAndStride> grid_strides;   //各anchor的网格坐标及步长
+        std::vector<int> anchors;                   //通过置信度预筛选的anchor下标
+        std::vector<ArmorObject> proposals;         //候选框
+        std::vector<int> order;                     //按置信度降序的前TOPK个候选框下标
+        std::vector<int> picked;                    //NMS保留的候选框下标
+
+        // NMS所用SoA，按order排列
+        std::vector<float> box_x0, box_y0, box_x1, box_y1;
+        std::vector<float> box_area;
+        std::vector<float> box_prob;
+        std::vector<int> box_label;                 //类别与颜色的组合
+        std::vector<float> iou;
+        std::vector<uint64_t> suppress_masks;       //每个保留框对其后各框的抑制位
+        std::vector<uint64_t> merge_masks;          //每个保留框对其后各框的合并位
+    };
+
+    /**
+     * @brief 生成网格并预分配解码缓冲区
+     */
+    void initDecodeBuffer(DecodeBuffer& buffer);
+
+    /**
+     * @brief 解码网络输出：置信度预筛选、top-K、NMS及候选框合并
+     * @param prob 网络输出
+     * @param buffer 由initDecodeBuffer初始化的缓冲区
+     * @param objects 检测结果，合并的候选框角点已取平均
+     * @param transform_matrix 网络输入坐标到原图坐标的变换矩阵
+     */
+    void decodeOutputs(const float* prob, DecodeBuffer& buffer, std::vector<ArmorObject>& objects, Eigen::Matrix<float, 3, 3> &transform_matrix);
+
+    /**
+     * @brief 合并多次推理(全图及分块)在原图坐标下的检测结果，按置信度NMS，不做角点平均
+     * @param buffer 解码缓冲区(复用其中的候选框及NMS缓冲)
+     * @param objects 待合并的检测结果，输出合并后的结果
+     */
+    void mergeObjects(DecodeBuffer& buffer, std::vector<ArmorObject>& objects);
+
+    /**
+     * @brief 计算四边形面积
+     */
+    float calcTetragonArea(cv::Point2f pts[4]);
+
+    /**
+     * @brief 同目录下存在量化模型(<模型名>_int8.xml，由scripts/quantize_int8.py生成)且启用时返回其路径
+     */
+    std::string resolveModelPath(const std::string& path, bool use_int8, bool& is_int8);
+
+    /**
+     * @brief 读取模型并融入u8 NHWC输入预处理
+     */
+    std::shared_ptr<ov::Model> readDetectorModel(ov::Core& core, const std::string& path);
 
     class ArmorDetector
     {
@@ -42,7 +133,79 @@ namespace armor_detector
         ArmorDetector();
         ~ArmorDetector();
         bool detect(cv::Mat &src, std::vector<ArmorObject>& objects);
-        bool initModel(std::string path);
+        /**
+         * @brief 初始化模型
+         * 
+         * @param path 模型xml路径
+         * @param cache_dir 编译模型缓存目录，为空时不缓存(每次启动重新编译)
+         * @param use_int8 同目录下存在量化模型(<模型名>_int8.xml，由scripts/quantize_int8.py生成)时优先加载
+         */
+        bool initModel(std::string path, std::string cache_dir = "", bool use_int8 = false);
+        void warmUp(int iterations = 1);
+
+        /**
+         * @brief 改用共享推理服务(替代initModel)
+         * detect在本线程完成预处理及解码，推理由服务与其他检测器组批执行；不支持流水线及分块推理
+         */
+        bool initService(std::shared_ptr<InferenceService> service);
+
+        bool is_int8_ = false;      //是否加载了INT8量化模型
+        bool is_cache_hit_ = false; //本次启动是否由缓存导入
+        double init_time_ = 0.0;    //模型初始化耗时(ms)
+
+        /**
+         * @brief 设置流水线深度(需在initModel之后调用)
+         * 深度为1时仅使用detect同步推理；大于1时创建depth个推理请求，
+         * 以submit/fetch交替提交与取回，当前帧的预处理与前一帧的推理重叠
+         */
+        bool setPipelineDepth(int depth);
+        int pipelineDepth() const;
+        int inflightNum() const;
+        // 预处理并异步提交一帧，无空闲推理请求时返回false
+        bool submit(cv::Mat &src);
+        // 等待最早提交的一帧推理完成并解码，无在途帧时返回false
+        bool fetch(std::vector<ArmorObject>& objects);
+        // 等待并丢弃所有在途帧
+        void drain();
+
+        /**
+         * @brief 分块推理：全图粗检测及各分块(原图分辨率)依次预处理并异步提交，
+         * 当前分块的预处理与前一分块的推理重叠，结果在原图坐标下NMS合并。
+         * 分块内贴近分块边缘(非图像边缘)的截断目标被丢弃，由相邻分块或全图结果补充。
+         * 
+         * @param src 原图
+         * @param tiles 分块区域(原图坐标)，Bayer图像需保证偏移为偶数
+         * @param objects 合并后的检测结果
+         */
+        bool detectTiles(cv::Mat &src, const std::vector<cv::Rect>& tiles, std::vector<ArmorObject>& objects);
+
+        InferTiming timing_;    //最近一帧的各阶段耗时
+
+    private:
+        struct InferSlot
+        {
+            ov::InferRequest request;
+            ov::Tensor input_tensor;
+            ov::Tensor output_tensor;
+            Eigen::Matrix<float, 3, 3> transform_matrix;
+            std::chrono::steady_clock::time_point submit_time;
+            std::atomic<int64_t> done_ns{0};    //推理完成时刻，由推理线程回调写入
+        };
+
+        void preprocess(cv::Mat &src, ov::Tensor& tensor, Eigen::Matrix<float, 3, 3>& transform_matrix);
+        bool postprocess(ov::Tensor& output_tensor, Eigen::Matrix<float, 3, 3>& transform_matrix, std::vector<ArmorObject>& objects);
+
+        std::vector<std::unique_ptr<InferSlot>> slots_;  //环形队列
+        int head_ = 0;      //最早提交的在途槽位
+        int inflight_ = 0;
+
+        DecodeBuffer decode_buffer_;
+
+        std::vector<std::unique_ptr<InferSlot>> tile_slots_;    //分块推理请求，首个用于全图
+        std::vector<ArmorObject> tile_objects_;
+
+        std::shared_ptr<InferenceService> service_;
+
     private:
         int dw, dh;
         float rescale_ratio;
@@ -52,6 +215,7 @@ namespace armor_detector
         ov::CompiledModel compiled_model; // 可执行网络
         ov::InferRequest infer_request;   // 推理请求
         ov::Tensor input_tensor;
+        ov::Tensor output_tensor;
         
         std::string input_name;
         std::string output_name;
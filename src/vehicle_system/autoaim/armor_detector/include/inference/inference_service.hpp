@@ -0,0 +1,129 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-26 21:12:40
+ * @LastEditTime: 2023-06-26 21:12:40
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/include/inference/inference_service.hpp
+ */
+#ifndef INFERENCE_SERVICE_HPP_
+#define INFERENCE_SERVICE_HPP_
+
+//c++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//openvino
+#include <openvino/openvino.hpp>
+
+namespace armor_detector
+{
+    /**
+     * @brief 共享推理服务配置
+     */
+    struct InferServiceParam
+    {
+        int max_batch = 4;          //单次推理的最大批大小
+        double max_wait = 4.0;      //帧在队列中的最长等待时间(ms)，超时即以当前帧数组批
+        int num_streams = 0;        //CPU推理流数，0为自动(THROUGHPUT)
+        std::string cache_dir;      //编译模型缓存目录
+        bool use_int8 = false;
+    };
+
+    /**
+     * @brief 多相机共享的批推理服务
+     * 同一进程(组件容器)内的多个检测节点按模型路径共享一个以动态批编译、THROUGHPUT模式运行的模型，
+     * 各节点提交已预处理的单帧输入，组批线程凑满max_batch或最早一帧等待超过max_wait后组批推理，
+     * 各推理流并行执行多个批次。输入输出为u8 NHWC/f32，与ArmorDetector的单帧张量一致。
+     * infer()阻塞至结果返回，每个客户端至多一帧在途：所有客户端的帧均已排队或在推理时不再有帧可到达，
+     * 此时立即组批而不等待max_wait(单客户端即每帧直接推理)。
+     */
+    class InferenceService
+    {
+    public:
+        /**
+         * @brief 获取模型对应的共享服务，不存在时创建(配置以首个创建者为准，不一致时告警)
+         * 每次获取计为一个客户端，返回的指针释放时注销
+         *
+         * @param path 模型xml路径
+         * @param param 服务配置
+         * @return 失败时返回nullptr
+         */
+        static std::shared_ptr<InferenceService> acquire(const std::string& path, const InferServiceParam& param);
+        ~InferenceService();
+
+        /**
+         * @brief 提交单帧并阻塞等待结果
+         *
+         * @param input 单帧输入(inputSize()个u8)
+         * @param output 单帧输出(outputSize()个float)
+         */
+        bool infer(const uint8_t* input, float* output);
+
+        size_t inputSize() const { return input_size_; }
+        size_t outputSize() const { return output_size_; }
+        uint64_t batchCount() const { return batch_cnt_; }
+        uint64_t frameCount() const { return frame_cnt_; }
+
+        bool is_int8_ = false;
+        bool is_cache_hit_ = false;
+        double init_time_ = 0.0;    //模型初始化耗时(ms)
+        int num_requests_ = 0;      //并行推理请求数
+
+    private:
+        InferenceService() = default;
+        bool init(const std::string& path, const InferServiceParam& param);
+        void addClient();
+        void removeClient();
+        void run();
+
+        struct Job
+        {
+            const uint8_t* input;
+            float* output;
+            std::chrono::steady_clock::time_point submit_time;
+            std::promise<bool> done;
+        };
+
+        struct BatchSlot
+        {
+            ov::InferRequest request;
+            ov::Tensor input_tensor;    //max_batch帧的输入内存
+            std::vector<Job*> jobs;
+            bool is_busy = false;
+        };
+
+        InferServiceParam param_;
+        ov::Core core_;
+        ov::CompiledModel compiled_model_;
+        std::vector<std::unique_ptr<BatchSlot>> slots_;
+        ov::Shape frame_shape_;     //单帧输入形状(HWC)
+        size_t input_size_ = 0;
+        size_t output_size_ = 0;
+
+        std::mutex mutex_;
+        std::condition_variable queue_cond_;
+        std::condition_variable slot_cond_;
+        std::deque<Job*> queue_;
+        int num_clients_ = 0;
+        int inflight_jobs_ = 0;     //已取出组批、尚未完成的帧数
+        bool is_running_ = false;
+        std::thread batch_thread_;
+
+        std::atomic<uint64_t> batch_cnt_{0};
+        std::atomic<uint64_t> frame_cnt_{0};
+    };
+} //namespace armor_detector
+
+#endif
@@ -186,6 +186,21 @@ namespace armor_detector
         double armor_roi_expand_ratio_width;
         double armor_roi_expand_ratio_height;
         double armor_conf_high_thresh;
+        double max_img_delay; //图像时间戳(曝光中点)到收图时刻的最大允许延迟(ms)，超过则丢弃
+
+        bool use_predictive_roi;      //按目标运动预测ROI中心及余量
+        double roi_velocity_margin;   //ROI余量相对预测位移的倍数
+        double roi_spin_radius;       //陀螺时ROI横向余量所用的车体半径(m)
+
+        int parallel_pnp_min;     //候选装甲板数不少于该值时并行PnP
+        int track_interval;       //推理间隔帧数，其间以光流跟踪角点，1为每帧推理
+        double max_flow_error;    //光流前后向跟踪残差阈值(像素)，超过则改为推理
+        int flow_margin;          //光流跟踪区域相对装甲板ROI的外扩像素
+
+        std::vector<int64_t> tiled_modes; //启用分块推理的模式
+        int tiles_per_frame;  //每帧原分辨率分块数(不含全图)
+        int tile_size;        //分块边长
+        int tile_overlap;     //搜索网格相邻分块重叠像素
 
         DetectorParam()
         {
@@ -206,6 +221,21 @@ namespace armor_detector
             armor_roi_expand_ratio_width = 1.1;
             armor_roi_expand_ratio_height = 1.5;
             armor_conf_high_thresh = 0.82;
+            max_img_delay = 25.0;
+
+            use_predictive_roi = true;
+            roi_velocity_margin = 2.0;
+            roi_spin_radius = 0.25;
+
+            parallel_pnp_min = 3;
+            track_interval = 1;
+            max_flow_error = 1.0;
+            flow_margin = 48;
+
+            tiled_modes = {};
+            tiles_per_frame = 2;
+            tile_size = 416;
+            tile_overlap = 64;
         }
     };
 
@@ -213,6 +243,7 @@ namespace armor_detector
     {
         bool use_imu;
         bool use_roi;
+        bool use_hw_roi;
         bool show_aim_cross;
         bool show_img;
         bool show_crop_img;
@@ -227,6 +258,7 @@ namespace armor_detector
         {
             use_imu = true;
             use_roi = false;
+            use_hw_roi = false;
             show_img = false;
             show_fps = false;
             save_data = false;
@@ -244,6 +276,7 @@ namespace armor_detector
         std::string camera_name;
         std::string camera_param_path;
         std::string network_path;
+        std::string model_cache_path;   //编译模型缓存目录，为空时不缓存
         std::string save_path;
     };
 
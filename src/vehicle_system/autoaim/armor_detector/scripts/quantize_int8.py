@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+'''
+Description: This is a ros-based project!
+Author: Liu Biao
+Date: 2023-06-20 19:12:40
+LastEditTime: 2023-06-20 19:12:40
+FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/scripts/quantize_int8.py
+'''
+'''
+装甲板检测模型INT8训练后量化(NNCF)及精度回归检查。
+
+数据集为检测器save_dataset(autoLabel)保存的目录(<时间戳>.jpg + <时间戳>.txt)，
+按文件名排序后每隔holdout_step张取一张作为留出集，其余作为校准集。
+量化后在留出集上分别运行FP32与INT8模型，以FP32的检测结果为基准统计：
+    召回率(FP32目标被INT8检出的比例)、类别/颜色一致率、四点平均及最大误差(原图像素)、INT8误检数、推理耗时。
+任一指标超出阈值时返回非零且不保存INT8模型(除非--force)，通过后保存为<模型名>_int8.xml/.bin，
+与原模型放在同一目录，检测器启动时(use_int8: true)优先加载。
+
+依赖：pip install openvino nncf opencv-python numpy
+
+用法：
+    python3 quantize_int8.py --model ../model/best_06_02.xml --dataset ~/dataset/armor
+    python3 quantize_int8.py --model ../model/best_06_02.xml --dataset ~/dataset/armor --check-only
+'''
+import argparse
+import glob
+import os
+import sys
+import time
+
+import cv2
+import numpy as np
+
+try:
+    import openvino.runtime as ov
+except ImportError:
+    import openvino as ov
+
+# 与inference_api2.cpp保持一致
+INPUT_W = 416
+INPUT_H = 416
+NUM_CLASSES = 8
+NUM_COLORS = 8
+TOPK = 128
+NMS_THRESH = 0.3
+BBOX_CONF_THRESH = 0.75
+MERGE_CONF_ERROR = 0.15
+MERGE_MIN_IOU = 0.9
+STRIDES = (8, 16, 32)
+
+
+def letterbox(img):
+    '''
+    与letterboxToImage一致的缩放补边，返回网络输入(1x3xHxW float，BGR)及网络坐标到原图坐标的变换矩阵
+    '''
+    r = min(INPUT_W / img.shape[1], INPUT_H / img.shape[0])
+    unpad_w = int(r * img.shape[1])
+    unpad_h = int(r * img.shape[0])
+    dw = (INPUT_W - unpad_w) // 2
+    dh = (INPUT_H - unpad_h) // 2
+
+    out = np.zeros((INPUT_H, INPUT_W, 3), dtype=np.uint8)
+    out[dh:dh + unpad_h, dw:dw + unpad_w] = cv2.resize(img, (unpad_w, unpad_h))
+    transform = np.array([[1.0 / r, 0, -dw / r],
+                          [0, 1.0 / r, -dh / r],
+                          [0, 0, 1]], dtype=np.float32)
+    tensor = out.transpose(2, 0, 1)[np.newaxis].astype(np.float32)
+    return tensor, transform
+
+
+def generate_grids():
+    grids = []
+    for stride in STRIDES:
+        ys, xs = np.meshgrid(np.arange(INPUT_H // stride), np.arange(INPUT_W // stride), indexing='ij')
+        grids.append(np.stack([xs.ravel(), ys.ravel(), np.full(xs.size, stride)], axis=1))
+    return np.concatenate(grids).astype(np.float32)
+
+
+GRIDS = generate_grids()
+
+
+def bbox_iou(a, b):
+    ix = max(0.0, min(a[2], b[2]) - max(a[0], b[0]))
+    iy = max(0.0, min(a[3], b[3]) - max(a[1], b[1]))
+    inter = ix * iy
+    union = (a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter
+    return inter / union if union > 0 else 1.0
+
+
+def decode(output, transform):
+    '''
+    与decodeOutputs + postprocess一致：阈值过滤、按置信度排序取TOPK、NMS并合并高度重叠的同类目标
+    @return list of dict(apex: 4x2原图坐标, cls, color, prob)
+    '''
+    feat = output.reshape(-1, 9 + NUM_COLORS + NUM_CLASSES)
+    keep = feat[:, 8] >= BBOX_CONF_THRESH
+    feat = feat[keep]
+    grids = GRIDS[keep]
+
+    pts = (feat[:, :8].reshape(-1, 4, 2) + grids[:, np.newaxis, :2]) * grids[:, 2, np.newaxis, np.newaxis]
+    pts = np.concatenate([pts, np.ones((pts.shape[0], 4, 1), dtype=np.float32)], axis=2) @ transform.T
+    pts = pts[:, :, :2]
+
+    order = np.argsort(-feat[:, 8], kind='stable')[:TOPK]
+    proposals = []
+    for idx in order:
+        apex = pts[idx]
+        proposals.append({
+            'apex': apex,
+            'pts': [apex],
+            'rect': (apex[:, 0].min(), apex[:, 1].min(), apex[:, 0].max(), apex[:, 1].max()),
+            'prob': float(feat[idx, 8]),
+            'color': int(np.argmax(feat[idx, 9:9 + NUM_COLORS])),
+            'cls': int(np.argmax(feat[idx, 9 + NUM_COLORS:])),
+        })
+
+    picked = []
+    for a in proposals:
+        is_keep = True
+        for b in picked:
+            iou = bbox_iou(a['rect'], b['rect'])
+            if iou > NMS_THRESH:
+                is_keep = False
+                if (iou > MERGE_MIN_IOU and abs(a['prob'] - b['prob']) < MERGE_CONF_ERROR
+                        and a['cls'] == b['cls'] and a['color'] == b['color']):
+                    b['pts'].append(a['apex'])
+        if is_keep:
+            picked.append(a)
+
+    for obj in picked:
+        obj['apex'] = np.mean(obj['pts'], axis=0)
+    return picked
+
+
+def match(ref_objs, test_objs):
+    '''
+    按四点平均距离贪心匹配，返回[(ref, test)]及未匹配的test数
+    '''
+    pairs = []
+    used = set()
+    for ref in ref_objs:
+        best, best_dist = None, None
+        for ii, test in enumerate(test_objs):
+            if ii in used or bbox_iou(ref['rect'], test['rect']) < 0.5:
+                continue
+            dist = np.linalg.norm(ref['apex'] - test['apex'], axis=1).mean()
+            if best_dist is None or dist < best_dist:
+                best, best_dist = ii, dist
+        if best is not None:
+            used.add(best)
+            pairs.append((ref, test_objs[best]))
+    return pairs, len(test_objs) - len(used)
+
+
+def load_images(paths):
+    for path in paths:
+        img = cv2.imread(path, cv2.IMREAD_COLOR)
+        if img is None:
+            print('Skip unreadable image: {}'.format(path))
+            continue
+        yield path, img
+
+
+def split_dataset(dataset, holdout_step):
+    paths = sorted(glob.glob(os.path.join(dataset, '*.jpg')))
+    if not paths:
+        sys.exit('No image found in {}'.format(dataset))
+    # 按时间戳等间隔留出，避免留出集与校准集来自不同场景
+    holdout = paths[::holdout_step]
+    calib = [p for ii, p in enumerate(paths) if ii % holdout_step != 0]
+    return calib, holdout
+
+
+def quantize(model, calib_paths, subset_size):
+    import nncf
+
+    def transform_fn(path):
+        return letterbox(cv2.imread(path, cv2.IMREAD_COLOR))[0]
+
+    calib_paths = [p for p in calib_paths if cv2.imread(p, cv2.IMREAD_COLOR) is not None]
+    dataset = nncf.Dataset(calib_paths, transform_fn)
+    # MIXED：权重对称、激活非对称量化，检测头回归输出精度损失小于PERFORMANCE
+    return nncf.quantize(
+        model,
+        dataset,
+        preset=nncf.QuantizationPreset.MIXED,
+        subset_size=min(subset_size, len(calib_paths)),
+    )
+
+
+def save_model(model, xml_path):
+    if hasattr(ov, 'save_model'):
+        ov.save_model(model, xml_path, compress_to_fp16=False)
+    else:
+        ov.serialize(model, xml_path)
+
+
+def evaluate(core, fp32_model, int8_model, holdout_paths):
+    fp32 = core.compile_model(fp32_model, 'CPU', {'PERFORMANCE_HINT': 'LATENCY'})
+    int8 = core.compile_model(int8_model, 'CPU', {'PERFORMANCE_HINT': 'LATENCY'})
+
+    stat = {'ref_num': 0, 'matched': 0, 'cls_agree': 0, 'color_agree': 0,
+            'false_positive': 0, 'apex_errors': [], 'fp32_time': 0.0, 'int8_time': 0.0, 'frames': 0}
+    for _, img in load_images(holdout_paths):
+        tensor, transform = letterbox(img)
+
+        st = time.perf_counter()
+        fp32_out = fp32(tensor)[fp32.output(0)]
+        mid = time.perf_counter()
+        int8_out = int8(tensor)[int8.output(0)]
+        end = time.perf_counter()
+        stat['fp32_time'] += mid - st
+        stat['int8_time'] += end - mid
+        stat['frames'] += 1
+
+        ref_objs = decode(fp32_out, transform)
+        test_objs = decode(int8_out, transform)
+        pairs, false_positive = match(ref_objs, test_objs)
+
+        stat['ref_num'] += len(ref_objs)
+        stat['matched'] += len(pairs)
+        stat['false_positive'] += false_positive
+        for ref, test in pairs:
+            stat['cls_agree'] += int(ref['cls'] == test['cls'])
+            stat['color_agree'] += int(ref['color'] == test['color'])
+            stat['apex_errors'].extend(np.linalg.norm(ref['apex'] - test['apex'], axis=1).tolist())
+    return stat
+
+
+def report(stat, args):
+    if stat['frames'] == 0 or stat['ref_num'] == 0:
+        print('No target detected by FP32 model on held-out set, cannot evaluate.')
+        return False
+
+    recall = stat['matched'] / stat['ref_num']
+    cls_agree = stat['cls_agree'] / max(stat['matched'], 1)
+    color_agree = stat['color_agree'] / max(stat['matched'], 1)
+    errors = np.array(stat['apex_errors']) if stat['apex_errors'] else np.zeros(1)
+    fp_rate = stat['false_positive'] / stat['ref_num']
+
+    checks = [
+        ('recall', recall, '>=', args.min_recall, recall >= args.min_recall),
+        ('class agreement', cls_agree, '>=', args.min_class_agreement, cls_agree >= args.min_class_agreement),
+        ('color agreement', color_agree, '>=', args.min_class_agreement, color_agree >= args.min_class_agreement),
+        ('mean apex error(px)', errors.mean(), '<=', args.max_apex_error, errors.mean() <= args.max_apex_error),
+        ('p95 apex error(px)', np.percentile(errors, 95), '<=', args.max_apex_error_p95,
+         np.percentile(errors, 95) <= args.max_apex_error_p95),
+        ('false positive rate', fp_rate, '<=', args.max_false_positive, fp_rate <= args.max_false_positive),
+    ]
+
+    print('Held-out frames: {}  FP32 targets: {}  matched: {}'.format(stat['frames'], stat['ref_num'], stat['matched']))
+    print('Latency  FP32: {:.2f}ms  INT8: {:.2f}ms  max apex error: {:.2f}px'.format(
+        stat['fp32_time'] * 1000 / stat['frames'], stat['int8_time'] * 1000 / stat['frames'], errors.max()))
+    is_pass = True
+    for name, value, op, thresh, ok in checks:
+        print('  {:<22s}{:8.4f} {} {:<8.4f} {}'.format(name, value, op, thresh, 'PASS' if ok else 'FAIL'))
+        is_pass = is_pass and ok
+    return is_pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description='INT8 post-training quantization for armor detector')
+    parser.add_argument('--model', required=True, help='FP32 IR(.xml)')
+    parser.add_argument('--dataset', required=True, help='autoLabel dataset directory')
+    parser.add_argument('--output', default='', help='INT8 IR path, default <model>_int8.xml')
+    parser.add_argument('--holdout-step', type=int, default=5, help='every N-th image is held out for evaluation')
+    parser.add_argument('--subset-size', type=int, default=300, help='calibration samples')
+    parser.add_argument('--min-recall', type=float, default=0.98)
+    parser.add_argument('--min-class-agreement', type=float, default=0.99)
+    parser.add_argument('--max-apex-error', type=float, default=1.0)
+    parser.add_argument('--max-apex-error-p95', type=float, default=2.5)
+    parser.add_argument('--max-false-positive', type=float, default=0.02)
+    parser.add_argument('--check-only', action='store_true', help='evaluate existing INT8 IR without quantizing')
+    parser.add_argument('--force', action='store_true', help='save INT8 IR even if the check fails')
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.model)[0] + '_int8.xml'
+    calib_paths, holdout_paths = split_dataset(args.dataset, max(args.holdout_step, 2))
+    print('Calibration images: {}  held-out images: {}'.format(len(calib_paths), len(holdout_paths)))
+
+    core = ov.Core()
+    fp32_model = core.read_model(args.model)
+    if args.check_only:
+        int8_model = core.read_model(output)
+    else:
+        st = time.perf_counter()
+        int8_model = quantize(fp32_model, calib_paths, args.subset_size)
+        print('Quantized in {:.1f}s'.format(time.perf_counter() - st))
+
+    is_pass = report(evaluate(core, fp32_model, int8_model, holdout_paths), args)
+
+    if not args.check_only:
+        if is_pass or args.force:
+            save_model(int8_model, output)
+            print('INT8 model saved to {}'.format(output))
+        else:
+            print('Accuracy check failed, INT8 model not saved.')
+    elif not is_pass:
+        print('Accuracy check failed, remove {} or re-quantize.'.format(output))
+    return 0 if is_pass else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -57,32 +57,101 @@ namespace armor_detector
     bool Detector::armor_detect(TaskData &src, bool& is_target_lost)
     {
         time_start_ = steady_clock_.now();
-        last_timestamp_ = now_;
-        now_ = src.timestamp;
         auto input = src.img;
-        
-        rmat_imu_ = src.quat.toRotationMatrix();
+        Size2i full_size = (src.sensor_size.area() > 0) ? src.sensor_size : input.size();
+        Point2i roi_offset;
 
-        if (debug_params_.use_roi)
+        //推理间隔帧以光流跟踪上一帧确认的装甲板角点，跟踪残差过大时仍进行推理
+        bool is_flow_frame = isFlowFrame(src.mode) && trackObjects(src);
+        bool is_tiled = !is_flow_frame && isTiledMode(src.mode);
+        if (is_flow_frame)
+        {   //光流跟踪帧不裁剪，沿用上一次的硬件ROI请求
+            roi_offset = src.img_offset;
+        }
+        else if (is_tiled)
+        {   //分块推理模式：全图粗检测+原分辨率分块检测远距离目标，不裁剪
+            roi_request_ = Rect();
+            roi_offset = src.img_offset;
+        }
+        else if (debug_params_.use_roi)
         {   //启用roi
+            roi_request_ = Rect();
             //吊射模式采用固定ROI
             if (src.mode == AUTOAIM_SLING)
             {
-                input(Range(600, 1024), Range(432, 848)).copyTo(input);
-                roi_offset_ = cv::Point2d((float)432, (float)600);
+                roi_request_ = Rect(432, 600, 416, 424);
+                roi_offset = cropImage(input, roi_request_, src.img_offset);
             }
             else
             {
-                roi_offset_ = cropImageByROI(input);
+                roi_offset = cropImageByROI(input, src.img_offset, full_size, src.timestamp, src.quat.toRotationMatrix());
             }
             RCLCPP_INFO_ONCE(logger_, "Using roi...");
         }
+        else
+        {   //图像可能已由相机按硬件ROI采集
+            roi_request_ = Rect();
+            roi_offset = src.img_offset;
+        }
 
         time_crop_ = steady_clock_.now();
 
         objects_.clear();
         new_armors_.clear();
-        if (!armor_detector_.detect(input, objects_))
+        bool is_detected = false;
+        if (is_flow_frame)
+        {
+            objects_.assign(flow_.result.begin(), flow_.result.end());
+            is_detected = !objects_.empty();
+        }
+        else if (is_tiled)
+        {   //分块推理为同步调用，流水线中的在途帧直接丢弃
+            if (!pipeline_frames_.empty())
+            {
+                resetPipeline();
+            }
+            scheduleTiles(input.size(), roi_offset);
+            is_detected = armor_detector_.detectTiles(input, tiles_, objects_);
+        }
+        else if (armor_detector_.pipelineDepth() <= 1)
+        {
+            is_detected = armor_detector_.detect(input, objects_);
+        }
+        else
+        {   //流水线推理：提交当前帧后取回最早提交帧的结果，其后的处理均针对该帧
+            if (!armor_detector_.submit(input))
+            {
+                is_result_ready_ = false;
+                return false;
+            }
+            pipeline_frames_.push_back({src, input, roi_offset, time_start_, time_crop_});
+            if (armor_detector_.inflightNum() < armor_detector_.pipelineDepth())
+            {   //流水线尚未填满
+                is_result_ready_ = false;
+                return false;
+            }
+
+            is_detected = armor_detector_.fetch(objects_);
+            PipelineFrame& frame = pipeline_frames_.front();
+            src = frame.src;
+            input = frame.input;
+            roi_offset = frame.roi_offset;
+            time_start_ = frame.time_start;
+            time_crop_ = frame.time_crop;
+            pipeline_frames_.pop_front();
+        }
+        is_result_ready_ = true;
+
+        last_timestamp_ = now_;
+        now_ = src.timestamp;
+        rmat_imu_ = src.quat.toRotationMatrix();
+        roi_offset_ = roi_offset;
+        if (!is_flow_frame)
+        {   //仅统计推理帧
+            updateRoiStat(input.size(), full_size);
+        }
+
+        if (!is_detected)
         {   //若未检测到目标
             if (debug_params_.show_aim_cross)
             {
@@ -93,13 +162,14 @@ namespace armor_detector
             lost_cnt_++;
             is_last_target_exists_ = false;
             last_target_area_ = 0.0;
+            flow_.objects.clear();
 
             return false;
         }
         time_infer_ = steady_clock_.now();
         
         //将对象排序，保留面积较大的对象
-        sort(objects_.begin(), objects_.end(), [](ArmorObject& prev, ArmorObject& next)
+        sort(objects_.begin(), objects_.end(), [](const ArmorObject& prev, const ArmorObject& next)
         {
             return prev.area > next.area;
         });
@@ -109,7 +179,8 @@ namespace armor_detector
             objects_.resize(this->detector_params_.max_armors_cnt);
         
         //生成装甲板对象
-        for (auto object : objects_)
+        int pnp_slot_num = 0;
+        for (const auto& object : objects_)
         {
             //TODO:加入紫色装甲板限制通过条件
             if (detector_params_.color == RED)
@@ -183,7 +254,7 @@ namespace armor_detector
                 if (!last_armors_.empty())
                 {
                     bool is_this_armor_available = false;
-                    for (auto last_armor : last_armors_)
+                    for (const auto& last_armor : last_armors_)
                     {
                         if (last_armor.roi.contains(armor.center2d))
                         {
@@ -252,36 +323,39 @@ namespace armor_detector
             // }
             RCLCPP_WARN_THROTTLE(logger_, steady_clock_, 50, "ID: %d target_type: %s", armor.id, target_type == 0 ? "SMALL_ARMOR" : "BIG_ARMOR");
 
-            // 单目PnP
-            auto pnp_result = coordsolver_.pnp(points_pic, rmat_imu_, target_type, pnp_method);
-            if (!pnp_result.is_solver_success)
-            {
-                continue;
-            }
-            
-            //防止装甲板类型出错导致解算问题，首先尝试切换装甲板类型，若仍无效则直接跳过该装甲板
-            if (!isPnpSolverValidation(pnp_result.armor_cam))
+            armor.area = object.area;
+            //PnP求解推迟至筛选完成后，候选装甲板按原顺序占用预分配槽位
+            if (pnp_slot_num >= (int)pnp_slots_.size())
+                pnp_slots_.resize(pnp_slot_num + 1);
+            PnpSlot& slot = pnp_slots_[pnp_slot_num++];
+            slot.points_pic.assign(points_pic.begin(), points_pic.end());
+            slot.armor = std::move(armor);
+            slot.target_type = target_type;
+            slot.pnp_method = pnp_method;
+        }
+
+        //各候选装甲板的PnP相互独立，候选较多时并行求解
+        if (pnp_slot_num >= detector_params_.parallel_pnp_min && pnp_slot_num > 1)
+        {
+            cv::parallel_for_(cv::Range(0, pnp_slot_num), [this](const cv::Range& range)
             {
-                target_type = (target_type == SMALL) ? BIG : SMALL;
-                pnp_result = coordsolver_.pnp(points_pic, rmat_imu_, target_type, SOLVEPNP_IPPE);
-                if (!pnp_result.is_solver_success)
-                {
-                    continue;
-                }
-                if (!isPnpSolverValidation(pnp_result.armor_cam))
-                {
-                    continue;
-                }
-            }
+                for (int ii = range.start; ii < range.end; ++ii)
+                    solveArmorPnp(pnp_slots_[ii]);
+            });
+        }
+        else
+        {
+            for (int ii = 0; ii < pnp_slot_num; ++ii)
+                solveArmorPnp(pnp_slots_[ii]);
+        }
 
-            armor.armor3d_world = pnp_result.armor_world;
-            armor.armor3d_cam = pnp_result.armor_cam;
-            armor.euler = pnp_result.euler;
-            armor.rmat = pnp_result.rmat;
-            armor.area = object.area;
-            armor.rangle = pnp_result.rangle;
-            new_armors_.emplace_back(armor);
+        //按候选顺序输出，与串行处理结果一致
+        for (int ii = 0; ii < pnp_slot_num; ++ii)
+        {
+            if (pnp_slots_[ii].is_valid)
+                new_armors_.emplace_back(pnp_slots_[ii].armor);
         }
+        updateFlowTracks(src);
 
         if (debug_params_.show_crop_img)
         {
@@ -313,10 +387,10 @@ namespace armor_detector
         }
         else
         {
-            if(save_dataset_)
+            if(save_dataset_ && !is_flow_frame)
             {
                 bool is_init = false;
-                for(auto armor : new_armors_)
+                for(auto& armor : new_armors_)
                 {
                     vector<cv::Point2d> cornor_points(armor.apex2d, armor.apex2d + 4);
                     autoLabel(is_init, src.img, file_, path_prefix_, now_,
@@ -329,6 +403,291 @@ namespace armor_detector
         return true;
     }
 
+    /**
+     * @brief 等待并丢弃流水线中的在途帧，避免模式切换后输出过期结果
+     */
+    void Detector::resetPipeline()
+    {
+        armor_detector_.drain();
+        pipeline_frames_.clear();
+        is_result_ready_ = false;
+    }
+
+    /**
+     * @brief 单个候选装甲板的PnP解算及校验，结果写回槽位
+     * 解算失败或结果无效时切换装甲板类型重试一次，仍无效则丢弃；
+     * 仅读取coordsolver_及当前帧姿态，可在多个线程中对不同槽位并行调用
+     * 
+     * @param slot 候选装甲板槽位
+     */
+    void Detector::solveArmorPnp(PnpSlot& slot)
+    {
+        slot.is_valid = false;
+        // 单目PnP
+        auto pnp_result = coordsolver_.pnp(slot.points_pic, rmat_imu_, slot.target_type, slot.pnp_method);
+        if (!pnp_result.is_solver_success)
+        {
+            return;
+        }
+        
+        //防止装甲板类型出错导致解算问题，首先尝试切换装甲板类型，若仍无效则直接跳过该装甲板
+        if (!isPnpSolverValidation(pnp_result.armor_cam))
+        {
+            slot.target_type = (slot.target_type == SMALL) ? BIG : SMALL;
+            pnp_result = coordsolver_.pnp(slot.points_pic, rmat_imu_, slot.target_type, SOLVEPNP_IPPE);
+            if (!pnp_result.is_solver_success)
+            {
+                return;
+            }
+            if (!isPnpSolverValidation(pnp_result.armor_cam))
+            {
+                return;
+            }
+        }
+
+        Armor& armor = slot.armor;
+        armor.armor3d_world = pnp_result.armor_world;
+        armor.armor3d_cam = pnp_result.armor_cam;
+        armor.euler = pnp_result.euler;
+        armor.rmat = pnp_result.rmat;
+        armor.rangle = pnp_result.rangle;
+        slot.is_valid = true;
+    }
+
+    namespace
+    {
+        // 跟踪区域转为灰度图，单通道输入为BayerBG8(BGGR)原始图像，OpenCV中对应COLOR_BayerRG2GRAY
+        inline void toGray(const Mat& img, Mat& gray)
+        {
+            if (img.type() == CV_8UC1)
+                cvtColor(img, gray, COLOR_BayerRG2GRAY);
+            else
+                cvtColor(img, gray, COLOR_BGR2GRAY);
+        }
+    } //namespace
+
+    /**
+     * @brief 本帧是否以光流跟踪代替推理
+     * 每track_interval帧推理一次，流水线推理及分块推理模式下不启用
+     * 
+     * @param mode 自瞄模式
+     */
+    bool Detector::isFlowFrame(int mode)
+    {
+        if (detector_params_.track_interval <= 1 || armor_detector_.pipelineDepth() > 1 || isTiledMode(mode) || flow_.objects.empty())
+        {
+            flow_.frame_cnt = 0;
+            return false;
+        }
+        if (flow_.frame_cnt + 1 >= detector_params_.track_interval)
+        {
+            flow_.frame_cnt = 0;
+            return false;
+        }
+        flow_.frame_cnt++;
+        return true;
+    }
+
+    /**
+     * @brief 金字塔LK光流跟踪上一帧装甲板的四个角点
+     * 以前后向跟踪误差作为残差，任一角点跟踪失败或残差超过max_flow_error时返回false(改为推理)
+     * 
+     * @param src 当前帧
+     * @return 跟踪成功时结果写入flow_.result(输入图像坐标)
+     */
+    bool Detector::trackObjects(const TaskData& src)
+    {
+        flow_.result.clear();
+        Rect img_rect(src.img_offset, src.img.size());
+        if (flow_.objects.empty() || flow_.prev_gray.empty() || (flow_.rect & img_rect) != flow_.rect)
+        {
+            flow_.frame_cnt = 0;
+            return false;
+        }
+        toGray(src.img(Rect(flow_.rect.tl() - src.img_offset, flow_.rect.size())), flow_.gray);
+
+        Point2f rect_tl(flow_.rect.tl());
+        flow_.prev_pts.clear();
+        for (const auto& object : flow_.objects)
+        {
+            for (int k = 0; k < 4; k++)
+                flow_.prev_pts.emplace_back(object.apex[k] - rect_tl);
+        }
+
+        const Size win_size(15, 15);
+        const int max_level = 2;
+        calcOpticalFlowPyrLK(flow_.prev_gray, flow_.gray, flow_.prev_pts, flow_.next_pts, flow_.status, flow_.err, win_size, max_level);
+        calcOpticalFlowPyrLK(flow_.gray, flow_.prev_gray, flow_.next_pts, flow_.back_pts, flow_.back_status, flow_.err, win_size, max_level);
+
+        double max_residual = 0.0;
+        for (size_t ii = 0; ii < flow_.prev_pts.size(); ++ii)
+        {
+            if (!flow_.status[ii] || !flow_.back_status[ii])
+            {
+                max_residual = DBL_MAX;
+                break;
+            }
+            max_residual = std::max(max_residual, cv::norm(flow_.back_pts[ii] - flow_.prev_pts[ii]));
+        }
+        if (max_residual > detector_params_.max_flow_error)
+        {
+            RCLCPP_WARN_THROTTLE(logger_, steady_clock_, 500, "Flow residual: %.2fpx, fallback to inference...", max_residual);
+            flow_.frame_cnt = 0;
+            return false;
+        }
+
+        // 跟踪区域坐标转换为输入图像坐标
+        Point2f offset = rect_tl - Point2f(src.img_offset);
+        for (size_t ii = 0; ii < flow_.objects.size(); ++ii)
+        {
+            ArmorObject object = flow_.objects[ii];
+            float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+            for (int k = 0; k < 4; k++)
+            {
+                object.apex[k] = flow_.next_pts[ii * 4 + k] + offset;
+                x0 = std::min(x0, object.apex[k].x);
+                y0 = std::min(y0, object.apex[k].y);
+                x1 = std::max(x1, object.apex[k].x);
+                y1 = std::max(y1, object.apex[k].y);
+            }
+            object.rect = Rect_<float>(x0, y0, x1 - x0, y1 - y0);
+            object.area = (int)(calcTetragonArea(object.apex));
+            flow_.result.emplace_back(object);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 记录本帧确认的装甲板及其周围区域的灰度图，供后续帧光流跟踪
+     * 
+     * @param src 当前帧
+     */
+    void Detector::updateFlowTracks(const TaskData& src)
+    {
+        flow_.objects.clear();
+        if (detector_params_.track_interval <= 1 || new_armors_.empty())
+            return;
+
+        Rect rect;
+        int margin = detector_params_.flow_margin;
+        for (const auto& armor : new_armors_)
+        {
+            ArmorObject object;
+            object.cls = armor.id;
+            object.color = armor.color;
+            object.prob = armor.conf;
+            object.area = armor.area;
+            object.pts_num = 1;
+            for (int k = 0; k < 4; k++)
+            {
+                object.apex[k] = armor.apex2d[k];
+                object.pts_sum[k] = armor.apex2d[k];
+            }
+            flow_.objects.emplace_back(object);
+
+            Rect region(armor.roi.x - margin, armor.roi.y - margin, armor.roi.width + 2 * margin, armor.roi.height + 2 * margin);
+            rect = (rect.area() == 0) ? region : (rect | region);
+        }
+        rect &= Rect(src.img_offset, src.img.size());
+        // 偏移及尺寸取偶数，保证Bayer图像的BGGR相位不变
+        rect.x = (rect.x + 1) & ~1;
+        rect.y = (rect.y + 1) & ~1;
+        rect.width = std::max(0, rect.width - 1) & ~1;
+        rect.height = std::max(0, rect.height - 1) & ~1;
+        if (rect.area() == 0)
+        {
+            flow_.objects.clear();
+            return;
+        }
+
+        flow_.rect = rect;
+        toGray(src.img(Rect(rect.tl() - src.img_offset, rect.size())), flow_.prev_gray);
+    }
+
+    /**
+     * @brief 当前模式是否启用分块推理
+     * 
+     * @param mode 自瞄模式
+     */
+    bool Detector::isTiledMode(int mode)
+    {
+        const auto& modes = detector_params_.tiled_modes;
+        return std::find(modes.begin(), modes.end(), (int64_t)mode) != modes.end();
+    }
+
+    /**
+     * @brief 分块推理的分块调度
+     * 上一帧存在目标时首个分块跟随目标中心，其余分块按搜索网格自图像中心向外轮询，
+     * 每帧共tiles_per_frame个分块，偏移量均为偶数以保持Bayer相位
+     * 
+     * @param img_size 输入图像尺寸
+     * @param img_offset 输入图像在全幅图像中的偏移
+     */
+    void Detector::scheduleTiles(const Size2i& img_size, const Point2i& img_offset)
+    {
+        tiles_.clear();
+        int tile_size = std::min(detector_params_.tile_size, std::min(img_size.width, img_size.height)) & ~1;
+        if (tile_size <= 0 || detector_params_.tiles_per_frame <= 0)
+            return;
+
+        auto clampTile = [&](Point2i tl) -> Rect
+        {
+            tl.x = std::max(0, std::min(tl.x, img_size.width - tile_size)) & ~1;
+            tl.y = std::max(0, std::min(tl.y, img_size.height - tile_size)) & ~1;
+            return Rect(tl, Size2i(tile_size, tile_size));
+        };
+
+        //跟踪分块
+        if (is_last_target_exists_)
+        {
+            Point2i center = last_roi_center_ - img_offset;
+            tiles_.emplace_back(clampTile(center - Point2i(tile_size / 2, tile_size / 2)));
+        }
+
+        //图像或分块尺寸变化时重新生成搜索网格
+        if (search_img_size_ != img_size || search_tile_size_ != tile_size)
+        {
+            search_img_size_ = img_size;
+            search_tile_size_ = tile_size;
+            search_tiles_.clear();
+            search_idx_ = 0;
+
+            int step = std::max(2, tile_size - detector_params_.tile_overlap);
+            std::vector<int> xs, ys;
+            for (int x = 0; ; x += step)
+            {
+                xs.emplace_back(std::min(x, img_size.width - tile_size));
+                if (x + tile_size >= img_size.width)
+                    break;
+            }
+            for (int y = 0; ; y += step)
+            {
+                ys.emplace_back(std::min(y, img_size.height - tile_size));
+                if (y + tile_size >= img_size.height)
+                    break;
+            }
+            for (auto y : ys)
+                for (auto x : xs)
+                    search_tiles_.emplace_back(clampTile(Point2i(x, y)));
+
+            //自图像中心向外搜索
+            Point2i img_center(img_size.width / 2, img_size.height / 2);
+            std::stable_sort(search_tiles_.begin(), search_tiles_.end(), [&](const Rect& prev, const Rect& next)
+            {
+                Point2i d0 = prev.tl() + Point2i(tile_size / 2, tile_size / 2) - img_center;
+                Point2i d1 = next.tl() + Point2i(tile_size / 2, tile_size / 2) - img_center;
+                return d0.dot(d0) < d1.dot(d1);
+            });
+        }
+
+        int search_num = std::min((int)search_tiles_.size(), detector_params_.tiles_per_frame - (int)tiles_.size());
+        for (int ii = 0; ii < search_num; ++ii)
+        {
+            tiles_.emplace_back(search_tiles_[search_idx_]);
+            search_idx_ = (search_idx_ + 1) % search_tiles_.size();
+        }
+    }
+
     /**
      * @brief 车辆小陀螺状态检测
      * 
@@ -643,7 +1002,7 @@ namespace armor_detector
             armor_msg.point3d_world.y = target.armor3d_world[1];
             armor_msg.point3d_world.z = target.armor3d_world[2];
             armor_msg.is_last_exists = false;
-            for (auto last_armor : last_armors_)
+            for (const auto& last_armor : last_armors_)
             {
                 if (last_armor.id == target.id && last_armor.roi.contains(target.center2d))
                 {
@@ -709,6 +1068,7 @@ namespace armor_detector
         //获取装甲板中心与装甲板面积以下一次ROI截取使用
         // last_roi_center_ = Point2i(512,640);
         last_roi_center_ = target.center2d;
+        updateTargetMotion(target, is_target_spinning, autoaim_msg.target_switched || autoaim_msg.spinning_switched);
         last_armor_ = target;
         lost_cnt_ = 0;
         last_target_area_ = target.area;
@@ -762,6 +1122,17 @@ namespace armor_detector
             RCLCPP_INFO_THROTTLE(logger_, steady_clock_, 20, "-----------TIME------------");
             RCLCPP_INFO_THROTTLE(logger_, steady_clock_, 20, "Crop:  %lfms", (dr_crop_ns / 1e6));
             RCLCPP_INFO_THROTTLE(logger_, steady_clock_, 20, "Infer: %lfms", (dr_infer_ns / 1e6));
+            RCLCPP_INFO_THROTTLE(
+                logger_, 
+                steady_clock_, 
+                20, 
+                "Stage(depth:%d): preprocess:%.2fms infer:%.2fms wait:%.2fms decode:%.2fms", 
+                armor_detector_.pipelineDepth(),
+                armor_detector_.timing_.preprocess,
+                armor_detector_.timing_.infer,
+                armor_detector_.timing_.wait,
+                armor_detector_.timing_.decode
+            );
             RCLCPP_INFO_THROTTLE(logger_, steady_clock_, 20, "Total: %lfms", (dr_full_ns / 1e6));
 
             if(is_save_data_)
@@ -790,7 +1161,7 @@ namespace armor_detector
      */
     void Detector::showArmors(TaskData& src)
     {
-        for (auto armor : new_armors_)
+        for (const auto& armor : new_armors_)
         {
             char ch[10];
             sprintf(ch, "%.3f", armor.conf);
@@ -898,13 +1269,19 @@ namespace armor_detector
 
     /**
      * @brief 图像ROI裁剪
+     * ROI按全幅坐标计算并记入roi_request_，供相机下一帧采用硬件ROI；
+     * 输入图像本身可能已是相机的硬件ROI，此时只裁剪两者的交集
      * 
      * @param img 原图像
-     * @return Point2i 裁剪的偏移量
+     * @param img_offset 原图像在全幅图像中的偏移
+     * @param full_size 全幅图像尺寸
+     * @param timestamp 当前帧时间戳(ns)
+     * @param rmat_imu 当前帧IMU姿态
+     * @return Point2i 裁剪后图像在全幅图像中的偏移量
      */
-    Point2i Detector::cropImageByROI(Mat &img)
+    Point2i Detector::cropImageByROI(Mat &img, const Point2i& img_offset, const Size2i& full_size, int64_t timestamp, const Eigen::Matrix3d& rmat_imu)
     {
-        double area_ratio = last_target_area_ / img.size().area();
+        double area_ratio = last_target_area_ / full_size.area();
         
         //若上次不存在目标
         if (!is_last_target_exists_)
@@ -912,40 +1289,185 @@ namespace armor_detector
             //当丢失目标帧数过多或lost_cnt为初值
             if (lost_cnt_ > detector_params_.max_lost_cnt || lost_cnt_ == 0 || area_ratio == 0.0)
             {
-                return Point2i(0,0);
+                return img_offset;
             }
         }
         
         //若目标大小大于阈值
         if (area_ratio > detector_params_.no_crop_ratio)
         {
-            return Point2i(0,0);
+            return img_offset;
         }
 
-        int max_expand = (img.size().height - input_size_.width) / 32;
+        int max_expand = (full_size.height - input_size_.width) / 32;
         double cropped_ratio = (detector_params_.no_crop_ratio / detector_params_.full_crop_ratio) / max_expand;
         int expand_value = ((int)(area_ratio / detector_params_.full_crop_ratio / cropped_ratio)) * 32;
         Size2i cropped_size = input_size_ + Size2i(expand_value, expand_value);
         // Size2i crooped_size = (input_size + (no_crop_thres / max))
 
+        Point2i roi_center = last_roi_center_;
+        Point2f margin;
+        if (detector_params_.use_predictive_roi && predictRoiCenter(timestamp, rmat_imu, roi_center, margin))
+        {   //按预测位移余量扩大ROI，仍取32的倍数
+            cropped_size.width += ((int)(2 * margin.x) + 31) / 32 * 32;
+            cropped_size.height += ((int)(2 * margin.y) + 31) / 32 * 32;
+            if (cropped_size.width >= full_size.width && cropped_size.height >= full_size.height)
+                return img_offset;
+            cropped_size.width = std::min(cropped_size.width, full_size.width & ~1);
+            cropped_size.height = std::min(cropped_size.height, full_size.height & ~1);
+        }
+
         //处理X越界
-        if (last_roi_center_.x <= cropped_size.width / 2)
-            last_roi_center_.x = cropped_size.width / 2;
-        else if (last_roi_center_.x >= (img.size().width - cropped_size.width / 2))
-            last_roi_center_.x = img.size().width - cropped_size.width / 2;
+        if (roi_center.x <= cropped_size.width / 2)
+            roi_center.x = cropped_size.width / 2;
+        else if (roi_center.x >= (full_size.width - cropped_size.width / 2))
+            roi_center.x = full_size.width - cropped_size.width / 2;
         //处理Y越界
-        if (last_roi_center_.y <= cropped_size.height / 2)
-            last_roi_center_.y = cropped_size.height / 2;
-        else if (last_roi_center_.y >= (img.size().height - cropped_size.height / 2))
-            last_roi_center_.y = img.size().height - cropped_size.height / 2;
+        if (roi_center.y <= cropped_size.height / 2)
+            roi_center.y = cropped_size.height / 2;
+        else if (roi_center.y >= (full_size.height - cropped_size.height / 2))
+            roi_center.y = full_size.height - cropped_size.height / 2;
         
         //左上角顶点
-        auto offset = last_roi_center_ - Point2i(cropped_size.width / 2, cropped_size.height / 2);
+        auto offset = roi_center - Point2i(cropped_size.width / 2, cropped_size.height / 2);
+        // 偏移量取偶数，保证裁剪后Bayer图像的BGGR相位不变
+        offset.x &= ~1;
+        offset.y &= ~1;
         // auto offset = last_roi_center_ - Point2i(roi_width / 2, roi_height / 2);
-        Rect roi_rect = Rect(offset, cropped_size);
-        img(roi_rect).copyTo(img);
+        roi_request_ = Rect(offset, cropped_size);
+
+        return cropImage(img, roi_request_, img_offset);
+    }
+
+    /**
+     * @brief 预测当前帧目标在全幅图像中的位置
+     * 上一帧目标的世界坐标按估计速度外推至当前帧，以当前帧姿态转换至相机系后重投影(同时补偿自身转动)；
+     * 余量为预测位移的roi_velocity_margin倍，陀螺时横向再加车体半径的投影(装甲板可能切换至另一侧)
+     * 
+     * @param timestamp 当前帧时间戳(ns)
+     * @param rmat_imu 当前帧IMU姿态
+     * @param center 预测的ROI中心(全幅坐标)
+     * @param margin ROI单侧余量(像素)
+     * @return 上一帧目标不存在或间隔过长时返回false
+     */
+    bool Detector::predictRoiCenter(int64_t timestamp, const Eigen::Matrix3d& rmat_imu, Point2i& center, Point2f& margin)
+    {
+        if (!is_last_target_exists_ || last_target_timestamp_ == 0)
+            return false;
+        double dt = (timestamp - last_target_timestamp_) / 1e9;
+        if (dt <= 0.0 || dt > 0.1)
+            return false;
+
+        Eigen::Vector3d velocity = is_last_target_spinning_ ? Eigen::Vector3d::Zero() : target_velocity_;
+        Eigen::Vector3d last_cam = coordsolver_.worldToCam(last_target_world_, rmat_imu);
+        Eigen::Vector3d pred_cam = coordsolver_.worldToCam(last_target_world_ + velocity * dt, rmat_imu);
+        if (last_cam[2] <= 0.0 || pred_cam[2] <= 0.0)
+            return false;
+
+        Point2f last_px = coordsolver_.reproject(last_cam);
+        Point2f pred_px = coordsolver_.reproject(pred_cam);
+        Point2f step = pred_px - last_px;
+        margin = Point2f(std::abs(step.x), std::abs(step.y)) * (float)detector_params_.roi_velocity_margin;
+        if (is_last_target_spinning_)
+        {
+            Eigen::Vector3d side_cam = pred_cam + Eigen::Vector3d(detector_params_.roi_spin_radius, 0.0, 0.0);
+            margin.x += std::abs(coordsolver_.reproject(side_cam).x - pred_px.x);
+        }
+
+        center = Point2i(pred_px);
+        return true;
+    }
+
+    /**
+     * @brief 更新目标运动估计(世界系速度)，供下一帧预测ROI
+     * 
+     * @param target 本帧目标装甲板
+     * @param is_spinning 目标是否处于陀螺状态
+     * @param is_switched 目标或装甲板是否切换
+     */
+    void Detector::updateTargetMotion(const Armor& target, bool is_spinning, bool is_switched)
+    {
+        double dt = (now_ - last_target_timestamp_) / 1e9;
+        if (is_last_target_exists_ && !is_switched && !is_spinning && dt > 0.0 && dt < 0.1)
+        {
+            Eigen::Vector3d velocity = (target.armor3d_world - last_target_world_) / dt;
+            //一阶低通
+            target_velocity_ = is_velocity_valid_ ? Eigen::Vector3d(0.5 * target_velocity_ + 0.5 * velocity) : velocity;
+            is_velocity_valid_ = true;
+        }
+        else
+        {
+            target_velocity_.setZero();
+            is_velocity_valid_ = false;
+        }
+        last_target_world_ = target.armor3d_world;
+        last_target_timestamp_ = now_;
+        is_last_target_spinning_ = is_spinning;
+    }
+
+    /**
+     * @brief 统计ROI帧与全图帧的目标丢失率
+     * 每个结果帧调用一次：先结算上一结果帧(其检测结果此时已反映在is_last_target_exists_中)，
+     * 仅统计上一帧存在目标、即期望检测到目标的帧
+     * 
+     * @param input_size 本帧推理输入尺寸
+     * @param full_size 全幅图像尺寸
+     */
+    void Detector::updateRoiStat(const Size2i& input_size, const Size2i& full_size)
+    {
+        if (roi_stat_.is_pending)
+        {
+            bool is_miss = !is_last_target_exists_;
+            if (roi_stat_.is_pending_roi)
+            {
+                roi_stat_.roi_frames++;
+                roi_stat_.roi_misses += is_miss;
+                roi_stat_.saved_ratio_sum += roi_stat_.pending_saved_ratio;
+            }
+            else
+            {
+                roi_stat_.full_frames++;
+                roi_stat_.full_misses += is_miss;
+            }
+        }
+
+        roi_stat_.is_pending = is_last_target_exists_;
+        roi_stat_.is_pending_roi = input_size.area() < full_size.area();
+        roi_stat_.pending_saved_ratio = 1.0 - (double)input_size.area() / full_size.area();
+
+        if (roi_stat_.roi_frames > 0)
+        {
+            RCLCPP_INFO_THROTTLE(
+                logger_,
+                steady_clock_,
+                5000,
+                "ROI frames: %ld miss rate: %.2f%% pixels saved: %.1f%% | full frames: %ld miss rate: %.2f%%",
+                roi_stat_.roi_frames,
+                roi_stat_.roi_misses * 100.0 / roi_stat_.roi_frames,
+                roi_stat_.saved_ratio_sum * 100.0 / roi_stat_.roi_frames,
+                roi_stat_.full_frames,
+                roi_stat_.full_frames > 0 ? roi_stat_.full_misses * 100.0 / roi_stat_.full_frames : 0.0
+            );
+        }
+    }
+
+    /**
+     * @brief 按全幅坐标下的ROI裁剪图像
+     * 
+     * @param img 原图像，输出为原图像数据上的ROI视图
+     * @param roi 全幅坐标下的ROI
+     * @param img_offset 原图像在全幅图像中的偏移
+     * @return Point2i 裁剪后图像在全幅图像中的偏移量
+     */
+    Point2i Detector::cropImage(Mat &img, const Rect& roi, const Point2i& img_offset)
+    {
+        Rect roi_rect = Rect(roi.tl() - img_offset, roi.size()) & Rect(Point2i(0, 0), img.size());
+        if (roi_rect.area() == 0 || roi_rect.size() == img.size())
+            return img_offset;
 
-        return offset;
+        // 裁剪为原图的视图，不拷贝像素；预处理按行步长读取，直接由视图缩放写入输入张量
+        img = img(roi_rect);
+        return img_offset + roi_rect.tl();
     }
 
     /**
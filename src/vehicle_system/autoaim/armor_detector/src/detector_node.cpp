@@ -27,7 +27,34 @@ namespace armor_detector
         if (!detector_->is_init_)
         {
             RCLCPP_INFO(this->get_logger(), "Initializing network model...");
-            detector_->armor_detector_.initModel(path_params_.network_path);
+            bool use_int8 = this->declare_parameter<bool>("use_int8", true);
+            // 多相机时同一容器内的检测节点共享批推理服务
+            bool use_infer_service = this->declare_parameter<bool>("use_infer_service", false);
+            InferServiceParam service_param;
+            service_param.max_batch = this->declare_parameter<int>("infer_max_batch", 4);
+            service_param.max_wait = this->declare_parameter<double>("infer_max_wait", 4.0);
+            service_param.num_streams = this->declare_parameter<int>("infer_streams", 0);
+            service_param.cache_dir = path_params_.model_cache_path;
+            service_param.use_int8 = use_int8;
+            bool is_service_ready = false;
+            if (use_infer_service)
+            {
+                auto service = InferenceService::acquire(path_params_.network_path, service_param);
+                is_service_ready = detector_->armor_detector_.initService(service);
+                if (!is_service_ready)
+                    RCLCPP_ERROR(this->get_logger(), "Acquire inference service failed, fallback to local model...");
+                else
+                    RCLCPP_WARN(this->get_logger(), "Using shared inference service with %d requests...", service->num_requests_);
+            }
+            if (!is_service_ready)
+                detector_->armor_detector_.initModel(path_params_.network_path, path_params_.model_cache_path, use_int8);
+            RCLCPP_WARN(
+                this->get_logger(),
+                "%s model %s in %.1fms",
+                detector_->armor_detector_.is_int8_ ? "INT8" : "FP32",
+                detector_->armor_detector_.is_cache_hit_ ? "imported from cache" : "compiled",
+                detector_->armor_detector_.init_time_
+            );
             detector_->coordsolver_.loadParam(path_params_.camera_param_path, path_params_.camera_name);
             if(detector_->is_save_data_)
             {
@@ -36,6 +63,19 @@ namespace armor_detector
             }
             detector_->is_init_ = true;
         }
+
+        // 推理流水线深度，大于1时当前帧预处理与前一帧推理重叠，输出结果滞后depth-1帧
+        int pipeline_depth = this->declare_parameter<int>("pipeline_depth", 1);
+        if (!detector_->armor_detector_.setPipelineDepth(pipeline_depth))
+        {
+            RCLCPP_ERROR(this->get_logger(), "Set pipeline depth %d failed, fallback to sync inference...", pipeline_depth);
+        }
+
+        // 启动时预热模型，非自瞄模式下低频推理保温
+        int warmup_iterations = this->declare_parameter<int>("warmup_iterations", 3);
+        keep_warm_interval_ = this->declare_parameter<int>("keep_warm_interval", 1000);
+        detector_->armor_detector_.warmUp(warmup_iterations);
+        last_infer_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
         
         // QoS    
         rclcpp::QoS qos(0);
@@ -54,6 +94,9 @@ namespace armor_detector
         // armor_msg pub.
         armor_msg_pub_ = this->create_publisher<AutoaimMsg>("/armor_detector/armor_msg", qos);
 
+        // roi request pub.
+        roi_request_pub_ = this->create_publisher<sensor_msgs::msg::RegionOfInterest>("/armor_detector/roi_request", qos);
+
         // initialize serial msg
         serial_msg_.imu.header.frame_id = "imu_link";
         this->declare_parameter<int>("mode", 1);
@@ -71,15 +114,30 @@ namespace armor_detector
         // Subscriptions transport type.
         std::string transport_type = "raw";
         std::string camera_topic = "/image";
-        img_msg_sub_ = std::make_shared<image_transport::Subscriber>(
-            image_transport::create_subscription(
-                this, 
-                camera_topic,
-                std::bind(&DetectorNode::imageCallback, this, _1), 
-                transport_type, 
-                rmw_qos
-            )
-        );
+        if (debug_.use_hw_roi)
+        {   // 硬件ROI的偏移随camera_info.roi传递，与图像按时间戳同步
+            camera_sub_ = std::make_shared<image_transport::CameraSubscriber>(
+                image_transport::create_camera_subscription(
+                    this, 
+                    camera_topic,
+                    std::bind(&DetectorNode::cameraCallback, this, _1, _2), 
+                    transport_type, 
+                    rmw_qos
+                )
+            );
+        }
+        else
+        {
+            img_msg_sub_ = std::make_shared<image_transport::Subscriber>(
+                image_transport::create_subscription(
+                    this, 
+                    camera_topic,
+                    std::bind(&DetectorNode::imageCallback, this, _1), 
+                    transport_type, 
+                    rmw_qos
+                )
+            );
+        }
 
         bool debug = false;
         this->declare_parameter<bool>("debug", true);
@@ -111,11 +169,41 @@ namespace armor_detector
     }
 
     /**
-     * @brief 图像数据回调
+     * @brief 非当前模式时按keep_warm_interval低频推理一次，保持模型处于热状态，
+     * 模式切换后第一帧即可按正常耗时完成检测
+     */
+    void DetectorNode::keepWarm()
+    {
+        if (keep_warm_interval_ <= 0)
+            return;
+
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (now_ns - last_infer_ns_ < (int64_t)keep_warm_interval_ * 1000000)
+            return;
+
+        param_mutex_.lock();
+        detector_->armor_detector_.warmUp(1);
+        param_mutex_.unlock();
+        last_infer_ns_ = now_ns;
+    }
+
+    /**
+     * @brief 图像数据回调（全幅图像）
      * 
      * @param img_msg 图像传感器数据
      */
     void DetectorNode::imageCallback(const sensor_msgs::msg::Image::ConstSharedPtr &img_msg)
+    {
+        cameraCallback(img_msg, nullptr);
+    }
+
+    /**
+     * @brief 图像及相机信息回调
+     * 
+     * @param img_msg 图像传感器数据
+     * @param info_msg 相机信息，roi为相机硬件ROI(全零为全幅)，width/height为全幅尺寸；为空时按全幅处理
+     */
+    void DetectorNode::cameraCallback(const sensor_msgs::msg::Image::ConstSharedPtr &img_msg, const sensor_msgs::msg::CameraInfo::ConstSharedPtr &info_msg)
     {
         int mode = mode_;
         RCLCPP_INFO_THROTTLE(
@@ -131,13 +219,28 @@ namespace armor_detector
             mode_ != SENTRY_NORMAL
         ))
         {
+            if (img_msg && debug_.use_hw_roi)
+            {   //非自瞄模式下恢复全幅采集
+                publishRoiRequest(cv::Rect());
+            }
+            if (img_msg)
+            {
+                if (!inflight_imgs_.empty())
+                {   //丢弃流水线中的在途帧
+                    param_mutex_.lock();
+                    detector_->resetPipeline();
+                    param_mutex_.unlock();
+                    inflight_imgs_.clear();
+                }
+                keepWarm();
+            }
             return;
         }
 
         rclcpp::Time img_stamp = img_msg->header.stamp;
         rclcpp::Time now = this->get_clock()->now();
         double duration = (now.nanoseconds() - img_stamp.nanoseconds()) / 1e6;
-        if (duration > 20.0)
+        if (duration > this->detector_params_.max_img_delay)
             return;
 
         TaskData src;
@@ -148,7 +251,25 @@ namespace armor_detector
 
         rclcpp::Time stamp = img_msg->header.stamp;
         src.timestamp = stamp.nanoseconds();
-        src.img = cv_bridge::toCvShare(img_msg, "bgr8")->image;
+        bool need_bgr = debug_.show_img || debug_.show_all_armors || debug_.show_aim_cross || debug_.show_fps || debug_.save_dataset;
+        if (img_msg->encoding == sensor_msgs::image_encodings::BAYER_BGGR8 && !need_bgr)
+        {   // 原始Bayer图像直接送入推理，去马赛克与letterbox缩放在预处理中一次完成
+            src.img = cv_bridge::toCvShare(img_msg)->image;
+        }
+        else
+        {   // 需要在图像上绘制调试信息时仍转换为bgr8
+            src.img = cv_bridge::toCvShare(img_msg, "bgr8")->image;
+        }
+        if (info_msg && info_msg->roi.width > 0 && info_msg->roi.height > 0 && info_msg->width > 0 && info_msg->height > 0)
+        {
+            src.img_offset = cv::Point2i(info_msg->roi.x_offset, info_msg->roi.y_offset);
+            src.sensor_size = cv::Size2i(info_msg->width, info_msg->height);
+        }
+        else
+        {
+            src.img_offset = cv::Point2i(0, 0);
+            src.sensor_size = src.img.size();
+        }
         Eigen::Matrix3d rmat_imu = Eigen::Matrix3d::Identity();
         src.quat = Eigen::Quaterniond(rmat_imu);
 
@@ -177,7 +298,36 @@ namespace armor_detector
         );
         
         param_mutex_.lock();
-        if (detector_->armor_detect(src, armor_msg.is_target_lost))
+        bool is_pipelined = detector_->armor_detector_.pipelineDepth() > 1;
+        if (is_pipelined)
+        {   //在途帧的图像可能直接引用消息内存，需持有消息直至该帧结果取回
+            inflight_imgs_.push_back(img_msg);
+        }
+        bool is_detected = detector_->armor_detect(src, armor_msg.is_target_lost);
+        sensor_msgs::msg::Image::ConstSharedPtr result_msg = img_msg;
+        if (is_pipelined)
+        {
+            if (!detector_->is_result_ready_)
+            {   //流水线未填满(或当前帧未能提交)
+                if ((int)inflight_imgs_.size() > detector_->armor_detector_.inflightNum())
+                {
+                    inflight_imgs_.pop_back();
+                }
+                if (debug_.use_hw_roi)
+                {
+                    publishRoiRequest(detector_->roi_request_);
+                }
+                param_mutex_.unlock();
+                return;
+            }
+            // src已替换为结果对应的帧
+            while ((int)inflight_imgs_.size() > detector_->armor_detector_.inflightNum())
+            {
+                result_msg = inflight_imgs_.front();
+                inflight_imgs_.pop_front();
+            }
+        }
+        if (is_detected)
         {   
             if (detector_->gyro_detector(src, armor_msg))
             {
@@ -196,10 +346,15 @@ namespace armor_detector
                 );
             }
         }
+        if (debug_.use_hw_roi)
+        {
+            publishRoiRequest(detector_->roi_request_);
+        }
         param_mutex_.unlock();
+        last_infer_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 
         armor_msg.header.frame_id = "gimbal_link";
-        armor_msg.header.stamp = img_msg->header.stamp;
+        armor_msg.header.stamp = result_msg->header.stamp;
         armor_msg.quat_imu.w = src.quat.w();
         armor_msg.quat_imu.x = src.quat.x();
         armor_msg.quat_imu.y = src.quat.y();
@@ -241,6 +396,23 @@ namespace armor_detector
         }
     }
 
+    /**
+     * @brief 向相机发布期望的硬件ROI(全幅坐标)，宽高为0表示全幅采集
+     * 相机端按32像素对齐后生效，并在一段时间未收到请求时自动恢复全幅
+     * 
+     * @param roi 
+     */
+    void DetectorNode::publishRoiRequest(const cv::Rect& roi)
+    {
+        sensor_msgs::msg::RegionOfInterest roi_msg;
+        roi_msg.x_offset = roi.x;
+        roi_msg.y_offset = roi.y;
+        roi_msg.width = roi.width;
+        roi_msg.height = roi.height;
+        roi_msg.do_rectify = false;
+        roi_request_pub_->publish(roi_msg);
+    }
+
     /**
      * @brief 参数回调函数
      * 
@@ -285,16 +457,30 @@ namespace armor_detector
         this->declare_parameter<double>("armor_roi_expand_ratio_width", 1.1);
         this->declare_parameter<double>("armor_roi_expand_ratio_height", 1.5);
         this->declare_parameter<double>("armor_conf_high_thresh", 0.82);
+        this->declare_parameter<double>("max_img_delay", 25.0);
+        this->declare_parameter<bool>("use_predictive_roi", true);
+        this->declare_parameter<double>("roi_velocity_margin", 2.0);
+        this->declare_parameter<double>("roi_spin_radius", 0.25);
+        this->declare_parameter<int>("parallel_pnp_min", 3);
+        this->declare_parameter<int>("track_interval", 1);
+        this->declare_parameter<double>("max_flow_error", 1.0);
+        this->declare_parameter<int>("flow_margin", 48);
+        this->declare_parameter<std::vector<int64_t>>("tiled_modes", std::vector<int64_t>{});
+        this->declare_parameter<int>("tiles_per_frame", 2);
+        this->declare_parameter<int>("tile_size", 416);
+        this->declare_parameter<int>("tile_overlap", 64);
         
         //TODO:Set by your own path.
         this->declare_parameter("camera_name", "KE0200110075"); //相机型号
         this->declare_parameter("camera_param_path", "/config/camera.yaml");
         this->declare_parameter("network_path", "/model/opt-0527-002.xml");
+        this->declare_parameter("model_cache_path", "/model/cache");
         this->declare_parameter("save_path", "/data/info.txt");
         
         //Debug.
         this->declare_parameter("use_imu", true);
         this->declare_parameter("use_roi", true);
+        this->declare_parameter("use_hw_roi", false);
         this->declare_parameter("show_img", false);
         this->declare_parameter("show_crop_img", false);
         this->declare_parameter("show_aim_cross", false);
@@ -339,11 +525,24 @@ namespace armor_detector
         detector_params_.no_crop_ratio = this->get_parameter("no_crop_ratio").as_double();
         detector_params_.full_crop_ratio = this->get_parameter("full_crop_ratio").as_double();
         detector_params_.armor_conf_high_thresh = this->get_parameter("armor_conf_high_thresh").as_double();
+        detector_params_.max_img_delay = this->get_parameter("max_img_delay").as_double();
+        detector_params_.use_predictive_roi = this->get_parameter("use_predictive_roi").as_bool();
+        detector_params_.roi_velocity_margin = this->get_parameter("roi_velocity_margin").as_double();
+        detector_params_.roi_spin_radius = this->get_parameter("roi_spin_radius").as_double();
+        detector_params_.parallel_pnp_min = this->get_parameter("parallel_pnp_min").as_int();
+        detector_params_.track_interval = this->get_parameter("track_interval").as_int();
+        detector_params_.max_flow_error = this->get_parameter("max_flow_error").as_double();
+        detector_params_.flow_margin = this->get_parameter("flow_margin").as_int();
+        detector_params_.tiled_modes = this->get_parameter("tiled_modes").as_integer_array();
+        detector_params_.tiles_per_frame = this->get_parameter("tiles_per_frame").as_int();
+        detector_params_.tile_size = this->get_parameter("tile_size").as_int();
+        detector_params_.tile_overlap = this->get_parameter("tile_overlap").as_int();
         detector_params_.armor_roi_expand_ratio_width = this->get_parameter("armor_roi_expand_ratio_width").as_double();
         detector_params_.armor_roi_expand_ratio_height = this->get_parameter("armor_roi_expand_ratio_height").as_double();
 
         debug_.use_imu = this->get_parameter("use_imu").as_bool();
         debug_.use_roi = this->get_parameter("use_roi").as_bool();
+        debug_.use_hw_roi = this->get_parameter("use_hw_roi").as_bool();
         debug_.show_img = this->get_parameter("show_img").as_bool();
         debug_.show_crop_img = this->get_parameter("show_crop_img").as_bool();
         debug_.show_aim_cross = this->get_parameter("show_aim_cross").as_bool();
@@ -369,6 +568,8 @@ namespace armor_detector
         path_params_.camera_name = this->get_parameter("camera_name").as_string();
         path_params_.camera_param_path = pkg_share_directory[0] + this->get_parameter("camera_param_path").as_string();
         path_params_.network_path = pkg_share_directory[1] + this->get_parameter("network_path").as_string();
+        std::string model_cache_path = this->get_parameter("model_cache_path").as_string();
+        path_params_.model_cache_path = model_cache_path.empty() ? "" : pkg_share_directory[1] + model_cache_path;
         path_params_.save_path = pkg_share_directory[0] + this->get_parameter("save_path").as_string();
 
         return true;
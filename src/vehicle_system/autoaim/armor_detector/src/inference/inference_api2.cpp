@@ -14,6 +14,7 @@ static constexpr int INPUT_H = 416;    // Height of input
 static constexpr int NUM_CLASSES = 8;  // Number of classes
 static constexpr int NUM_COLORS = 8;   // Number of color
 static constexpr int TOPK = 128;       // TopK
+static constexpr int NMS_WORDS = (TOPK + 63) / 64;  // NMS位掩码的64位字数
 static constexpr float NMS_THRESH = 0.3;
 static constexpr float BBOX_CONF_THRESH = 0.75;
 static constexpr float MERGE_CONF_ERROR = 0.15;
@@ -30,13 +31,28 @@ namespace armor_detector
         return max_arg;
     }
 
+    namespace
+    {
+        // 原始Bayer缩放的横向查找表，按线程缓存，输入尺寸不变时跨帧复用
+        struct BayerResizeTable
+        {
+            cv::Size src_size;
+            std::vector<int> x0_tab;
+            std::vector<int> x1_tab;
+            std::vector<float> fx_tab;
+        };
+    } //namespace
+
     /**
-     * @brief Resize the image using letterbox
-     * @param img Image before resize
+     * @brief Demosaic and resize a BayerBG8 image using letterbox in one pass
+     * 每个2x2的BGGR单元视为一个采样点(B, 两个G的均值, R)，在单元网格上双线性插值，
+     * 直接写入网络输入尺寸的BGR图像(可为输入张量内存)，省去全分辨率去马赛克及中间图像。
+     * 变换矩阵与letterboxToImage一致，仍对应原图全分辨率坐标。
+     * @param img BayerBG8 image before resize(宽高为偶数)
+     * @param out Image after resize(INPUT_H x INPUT_W, CV_8UC3)
      * @param transform_matrix Transform Matrix of Resize
-     * @return Image after resize
      */
-    inline cv::Mat scaledResize(cv::Mat& img, Eigen::Matrix<float,3,3> &transform_matrix)
+    inline void scaledResizeBayer(cv::Mat& img, cv::Mat& out, Eigen::Matrix<float,3,3> &transform_matrix)
     {
         float r = std::min(INPUT_W / (img.cols * 1.0), INPUT_H / (img.rows * 1.0));
         int unpad_w = r * img.cols;
@@ -51,13 +67,71 @@ namespace armor_detector
         transform_matrix << 1.0 / r, 0, -dw / r,
                             0, 1.0 / r, -dh / r,
                             0, 0, 1;
-        
-        cv::Mat re;
-        cv::resize(img, re, cv::Size(unpad_w,unpad_h));
-        cv::Mat out;
-        cv::copyMakeBorder(re, out, dh, dh, dw, dw, cv::BORDER_CONSTANT);
 
-        return out;
+        out.setTo(cv::Scalar::all(0));
+        int quad_w = img.cols / 2;
+        int quad_h = img.rows / 2;
+        if (quad_w == 0 || quad_h == 0)
+            return;
+
+        // 输出像素中心映射回原图：x = (u + 0.5) / r - 0.5，单元中心位于原图 2 * i + 0.5
+        auto mapToQuad = [](int dst, float r, int quad_len, int& q0, int& q1, float& f)
+        {
+            float q = ((dst + 0.5f) / r - 1.0f) * 0.5f;
+            q = std::min(std::max(q, 0.0f), (float)(quad_len - 1));
+            q0 = (int)q;
+            q1 = std::min(q0 + 1, quad_len - 1);
+            f = q - q0;
+        };
+
+        thread_local BayerResizeTable table;
+        if (table.src_size != img.size())
+        {
+            table.x0_tab.resize(unpad_w);
+            table.x1_tab.resize(unpad_w);
+            table.fx_tab.resize(unpad_w);
+            for (int u = 0; u < unpad_w; ++u)
+            {
+                mapToQuad(u, r, quad_w, table.x0_tab[u], table.x1_tab[u], table.fx_tab[u]);
+                table.x0_tab[u] *= 2;
+                table.x1_tab[u] *= 2;
+            }
+            table.src_size = img.size();
+        }
+        const int* x0_tab = table.x0_tab.data();
+        const int* x1_tab = table.x1_tab.data();
+        const float* fx_tab = table.fx_tab.data();
+
+        for (int v = 0; v < unpad_h; ++v)
+        {
+            int y0, y1;
+            float fy;
+            mapToQuad(v, r, quad_h, y0, y1, fy);
+            const uchar* b0 = img.ptr<uchar>(2 * y0);      // 单元第一行 B G
+            const uchar* r0 = img.ptr<uchar>(2 * y0 + 1);  // 单元第二行 G R
+            const uchar* b1 = img.ptr<uchar>(2 * y1);
+            const uchar* r1 = img.ptr<uchar>(2 * y1 + 1);
+            uchar* dst = out.ptr<uchar>(v + dh) + dw * 3;
+
+            for (int u = 0; u < unpad_w; ++u, dst += 3)
+            {
+                int xa = x0_tab[u];
+                int xb = x1_tab[u];
+                float fx = fx_tab[u];
+                float w00 = (1.0f - fx) * (1.0f - fy);
+                float w01 = fx * (1.0f - fy);
+                float w10 = (1.0f - fx) * fy;
+                float w11 = fx * fy;
+
+                float blue = w00 * b0[xa] + w01 * b0[xb] + w10 * b1[xa] + w11 * b1[xb];
+                float green = 0.5f * (w00 * (b0[xa + 1] + r0[xa]) + w01 * (b0[xb + 1] + r0[xb]) +
+                                      w10 * (b1[xa + 1] + r1[xa]) + w11 * (b1[xb + 1] + r1[xb]));
+                float red = w00 * r0[xa + 1] + w01 * r0[xb + 1] + w10 * r1[xa + 1] + w11 * r1[xb + 1];
+                dst[0] = cv::saturate_cast<uchar>(blue);
+                dst[1] = cv::saturate_cast<uchar>(green);
+                dst[2] = cv::saturate_cast<uchar>(red);
+            }
+        }
     }
 
     /**
@@ -88,211 +162,251 @@ namespace armor_detector
 
     /**
      * @brief Generate Proposal
-     * @param grid_strides Grid strides
+     * 仅解码通过置信度预筛选的anchor，结果写入复用的候选框缓冲区(按全部anchor预分配)，不分配内存
+     * @param grid_strides Grid strides(initModel时生成)
      * @param feat_ptr Original predition result.
-     * @param prob_threshold Confidence Threshold.
-     * @param objects Objects proposed.
+     * @param anchors 通过预筛选的anchor下标
+     * @param anchor_num 通过预筛选的anchor数量
+     * @param proposals 候选框缓冲区，容量不足时扩充
+     * @return 候选框数量
      */
-    static void generateYoloxProposals(std::vector<GridAndStride> grid_strides, const float* feat_ptr,
-                                        Eigen::Matrix<float,3,3> &transform_matrix,float prob_threshold,
-                                        std::vector<ArmorObject>& objects)
+    static int generateYoloxProposals(const std::vector<GridAndStride>& grid_strides, const float* feat_ptr,
+                                        Eigen::Matrix<float,3,3> &transform_matrix, const int* anchors, int anchor_num,
+                                        std::vector<ArmorObject>& proposals)
     {
-        const int num_anchors = grid_strides.size();
-        //Travel all the anchors
-        for (int anchor_idx = 0; anchor_idx < num_anchors; anchor_idx++)
+        if ((int)proposals.size() < anchor_num)
+            proposals.resize(anchor_num);
+
+        // 变换矩阵仅包含缩放与平移，直接展开计算
+        const float m00 = transform_matrix(0, 0), m01 = transform_matrix(0, 1), m02 = transform_matrix(0, 2);
+        const float m10 = transform_matrix(1, 0), m11 = transform_matrix(1, 1), m12 = transform_matrix(1, 2);
+
+        for (int ii = 0; ii < anchor_num; ii++)
         {
+            const int anchor_idx = anchors[ii];
             const int grid0 = grid_strides[anchor_idx].grid0;
             const int grid1 = grid_strides[anchor_idx].grid1;
             const int stride = grid_strides[anchor_idx].stride;
-            const int basic_pos = anchor_idx * (9 + (NUM_COLORS) + NUM_CLASSES);
+            const float* feat = feat_ptr + anchor_idx * (9 + (NUM_COLORS) + NUM_CLASSES);
+
+            ArmorObject& obj = proposals[ii];
 
             // yolox/models/yolo_head.py decode logic
             //  outputs[..., :2] = (outputs[..., :2] + grids) * strides
-            //  outputs[..., 2:4] = torch.exp(outputs[..., 2:4]) * strides
-            float x_1 = (feat_ptr[basic_pos + 0] + grid0) * stride;
-            float y_1 = (feat_ptr[basic_pos + 1] + grid1) * stride;
-            float x_2 = (feat_ptr[basic_pos + 2] + grid0) * stride;
-            float y_2 = (feat_ptr[basic_pos + 3] + grid1) * stride;
-            float x_3 = (feat_ptr[basic_pos + 4] + grid0) * stride;
-            float y_3 = (feat_ptr[basic_pos + 5] + grid1) * stride;
-            float x_4 = (feat_ptr[basic_pos + 6] + grid0) * stride;
-            float y_4 = (feat_ptr[basic_pos + 7] + grid1) * stride;
-            
-            float box_objectness = (feat_ptr[basic_pos + 8]);
-            int box_color = argmax(feat_ptr + basic_pos + 9, NUM_COLORS);
-            int box_class = argmax(feat_ptr + basic_pos + 9 + NUM_COLORS, NUM_CLASSES);
-
-            // cout << "output:" << endl;
-            // for (int ii = 0; ii < 25; ii++)
-            // {
-            //     cout << feat_ptr[basic_pos + ii] << " ";
-            // }
-            // cout << endl;
-            // float color_conf = (feat_ptr[basic_pos + 9 + box_color]);
-            // float cls_conf = (feat_ptr[basic_pos + 9 + NUM_COLORS + box_class]);
-            // float box_prob = (box_objectness + cls_conf + color_conf) / 3.0;
-            float box_prob = box_objectness;
-            if (box_prob >= prob_threshold)
+            float min_x = FLT_MAX, min_y = FLT_MAX;
+            float max_x = -FLT_MAX, max_y = -FLT_MAX;
+            for (int i = 0; i < 4; i++)
             {
-                ArmorObject obj;
-
-                Eigen::Matrix<float,3,4> apex_norm;
-                Eigen::Matrix<float,3,4> apex_dst;
-
-                apex_norm << x_1, x_2, x_3, x_4,
-                             y_1, y_2, y_3, y_4,
-                             1,   1,   1,   1;
-                
-                apex_dst = transform_matrix * apex_norm;
-
-                for (int i = 0; i < 4; i++)
-                {
-                    obj.apex[i] = cv::Point2f(apex_dst(0,i), apex_dst(1,i));
-                    obj.pts.push_back(obj.apex[i]);
-                }
-                
-                std::vector<cv::Point2f> tmp(obj.apex, obj.apex + 4);
-                obj.rect = cv::boundingRect(tmp);
-                obj.cls = box_class;
-                obj.color = box_color;
-                obj.prob = box_prob;
-
-                // cout << "output:";
-                // for (int i = 0; i < 4; i++)
-                // {
-                //     cout << " " << "(" << obj.pts[i].x << "," << obj.pts[i].y << ") "; 
-                // }
-                // cout << "obj_prob:" << obj.prob << " obj_color:" << obj.color << " obj_cls:" << obj.cls << endl;
-
-                objects.push_back(obj);
+                float x = (feat[2 * i] + grid0) * stride;
+                float y = (feat[2 * i + 1] + grid1) * stride;
+                obj.apex[i] = cv::Point2f(m00 * x + m01 * y + m02, m10 * x + m11 * y + m12);
+                obj.pts_sum[i] = obj.apex[i];
+
+                min_x = std::min(min_x, obj.apex[i].x);
+                min_y = std::min(min_y, obj.apex[i].y);
+                max_x = std::max(max_x, obj.apex[i].x);
+                max_y = std::max(max_y, obj.apex[i].y);
             }
+
+            // 与cv::boundingRect(Point2f)的取整方式一致
+            int x0 = cvFloor(min_x), y0 = cvFloor(min_y);
+            obj.rect = cv::Rect_<float>(x0, y0, cvFloor(max_x) - x0 + 1, cvFloor(max_y) - y0 + 1);
+            obj.cls = argmax(feat + 9 + NUM_COLORS, NUM_CLASSES);
+            obj.color = argmax(feat + 9, NUM_COLORS);
+            obj.prob = feat[8];
+            obj.pts_num = 1;
         } // point anchor loop
+        return anchor_num;
     }
 
     /**
-     * @brief Calculate intersection area between two objects.
-     * @param a Object a.
-     * @param b Object b.
-     * @return Area of intersection.
+     * @brief 按置信度选出前TOPK个候选框并降序排列，仅移动下标
+     * @param proposals 候选框
+     * @param count 候选框数量
+     * @param order 排序后的候选框下标
      */
-    static inline float intersection_area(const ArmorObject& a, const ArmorObject& b)
+    static void topKSorted(const std::vector<ArmorObject>& proposals, int count, std::vector<int>& order)
     {
-        cv::Rect_<float> inter = a.rect & b.rect;
-        return inter.area();
+        order.resize(count);
+        for (int i = 0; i < count; i++)
+            order[i] = i;
+
+        // 置信度相同时按下标排序，保证结果确定
+        auto greater = [&proposals](int a, int b)
+        {
+            return proposals[a].prob > proposals[b].prob || (proposals[a].prob == proposals[b].prob && a < b);
+        };
+        if (count > TOPK)
+        {
+            std::nth_element(order.begin(), order.begin() + TOPK, order.end(), greater);
+            order.resize(TOPK);
+        }
+        std::sort(order.begin(), order.end(), greater);
     }
 
-    static void qsort_descent_inplace(std::vector<ArmorObject>& faceobjects, int left, int right)
+    /**
+     * @brief 计算第i个框与其后各框的IoU，生成抑制及合并位掩码
+     * IoU计算在SoA数组上逐元素进行，便于编译器向量化
+     */
+    static void nmsRow(DecodeBuffer& buffer, int i, int n, float nms_threshold, uint64_t* suppress, uint64_t* merge)
     {
-        int i = left;
-        int j = right;
-        float p = faceobjects[(left + right) / 2].prob;
-
-        while (i <= j)
+        float* iou = buffer.iou.data();
+        const float ax0 = buffer.box_x0[i], ay0 = buffer.box_y0[i];
+        const float ax1 = buffer.box_x1[i], ay1 = buffer.box_y1[i];
+        const float area = buffer.box_area[i];
+        for (int j = i + 1; j < n; j++)
         {
-            while (faceobjects[i].prob > p)
-                i++;
-
-            while (faceobjects[j].prob < p)
-                j--;
+            float w = std::min(ax1, buffer.box_x1[j]) - std::max(ax0, buffer.box_x0[j]);
+            float h = std::min(ay1, buffer.box_y1[j]) - std::max(ay0, buffer.box_y0[j]);
+            float inter_area = std::max(w, 0.f) * std::max(h, 0.f);
+            iou[j] = inter_area / (area + buffer.box_area[j] - inter_area);
+        }
 
-            if (i <= j)
+        for (int k = 0; k < NMS_WORDS; k++)
+        {
+            suppress[k] = 0;
+            merge[k] = 0;
+        }
+        const float prob = buffer.box_prob[i];
+        const int label = buffer.box_label[i];
+        for (int j = i + 1; j < n; j++)
+        {
+            // IoU为nan时同样抑制
+            if (!(iou[j] <= nms_threshold))
             {
-                // swap
-                std::swap(faceobjects[i], faceobjects[j]);
-                i++;
-                j--;
+                suppress[j >> 6] |= 1ULL << (j & 63);
+                //Stored for Merge
+                if (iou[j] > MERGE_MIN_IOU && std::abs(buffer.box_prob[j] - prob) < MERGE_CONF_ERROR && buffer.box_label[j] == label)
+                    merge[j >> 6] |= 1ULL << (j & 63);
             }
         }
-        // #pragma omp parallel sections
-        // {
-        //     #pragma omp section
-        //     {
-        //         if (left < j) qsort_descent_inplace(faceobjects, left, j);
-        //     }
-        //     #pragma omp section
-        //     {
-        //         if (i < right) qsort_descent_inplace(faceobjects, i, right);
-        //     }
-        // }
-        if (left < j) qsort_descent_inplace(faceobjects, left, j);
-        if (i < right) qsort_descent_inplace(faceobjects, i, right);
-    }
-
-    static void qsort_descent_inplace(std::vector<ArmorObject>& objects)
-    {
-        if (objects.empty())
-            return;
-
-        qsort_descent_inplace(objects, 0, objects.size() - 1);
     }
 
-    static void nms_sorted_bboxes(std::vector<ArmorObject>& faceobjects, std::vector<int>& picked, float nms_threshold)
+    /**
+     * @brief 对按置信度降序排列的候选框做NMS
+     * 框的坐标、面积、置信度按SoA存放；仅为保留的框计算与其后各框的抑制位掩码，
+     * 被抑制的框按位查找需并入的保留框。合并规则与原实现一致：
+     * IoU大于MERGE_MIN_IOU、置信度差小于MERGE_CONF_ERROR且类别颜色相同时，角点累加到保留框的pts_sum
+     * @param buffer 解码缓冲区，order为排序后的候选框下标，结果写入picked
+     * @param nms_threshold NMS阈值
+     * @param is_merge 是否合并角点
+     */
+    static void nmsBitmask(DecodeBuffer& buffer, float nms_threshold, bool is_merge = true)
     {
-        picked.clear();
-        const int n = faceobjects.size();
-
-        std::vector<float> areas(n);
+        const int n = buffer.order.size();
+        buffer.picked.clear();
+
+        buffer.box_x0.resize(n);
+        buffer.box_y0.resize(n);
+        buffer.box_x1.resize(n);
+        buffer.box_y1.resize(n);
+        buffer.box_area.resize(n);
+        buffer.box_prob.resize(n);
+        buffer.box_label.resize(n);
+        buffer.iou.resize(n);
         for (int i = 0; i < n; i++)
         {
-            areas[i] = faceobjects[i].rect.area();
+            const ArmorObject& obj = buffer.proposals[buffer.order[i]];
+            buffer.box_x0[i] = obj.rect.x;
+            buffer.box_y0[i] = obj.rect.y;
+            buffer.box_x1[i] = obj.rect.x + obj.rect.width;
+            buffer.box_y1[i] = obj.rect.y + obj.rect.height;
+            buffer.box_area[i] = obj.rect.area();
+            buffer.box_prob[i] = obj.prob;
+            buffer.box_label[i] = obj.cls * NUM_COLORS + obj.color;
         }
 
+        uint64_t removed[NMS_WORDS] = {0};
         for (int i = 0; i < n; i++)
         {
-            ArmorObject& a = faceobjects[i];
-            int keep = 1;
-            for (int j = 0; j < (int)picked.size(); j++)
+            const uint64_t bit = 1ULL << (i & 63);
+            if (removed[i >> 6] & bit)
             {
-                ArmorObject& b = faceobjects[picked[j]];
-                // intersection over union
-                float inter_area = intersection_area(a, b);
-                float union_area = areas[i] + areas[picked[j]] - inter_area;
-                float iou = inter_area / union_area;
-                if (iou > nms_threshold || isnan(iou))
+                if (!is_merge)
+                    continue;
+                const ArmorObject& a = buffer.proposals[buffer.order[i]];
+                for (int p = 0; p < (int)buffer.picked.size(); p++)
                 {
-                    keep = 0;
-                    //Stored for Merge
-                    if (iou > MERGE_MIN_IOU && abs(a.prob - b.prob) < MERGE_CONF_ERROR 
-                                            && a.cls == b.cls && a.color == b.color)
+                    if (buffer.merge_masks[p * NMS_WORDS + (i >> 6)] & bit)
                     {
-                        for (int i = 0; i < 4; i++)
-                        {
-                            b.pts.push_back(a.apex[i]);
-                        }
+                        ArmorObject& b = buffer.proposals[buffer.picked[p]];
+                        for (int k = 0; k < 4; k++)
+                            b.pts_sum[k] += a.apex[k];
+                        b.pts_num++;
                     }
-                    // cout<<b.pts_x.size()<<endl;
                 }
+                continue;
             }
-            if (keep)
-                picked.push_back(i);
+
+            int p = buffer.picked.size();
+            buffer.picked.push_back(buffer.order[i]);
+            uint64_t* suppress = &buffer.suppress_masks[p * NMS_WORDS];
+            nmsRow(buffer, i, n, nms_threshold, suppress, &buffer.merge_masks[p * NMS_WORDS]);
+            for (int k = 0; k < NMS_WORDS; k++)
+                removed[k] |= suppress[k];
         }
     }
 
-    /**
-     * @brief Decode outputs.
-     * @param prob Original predition output.
-     * @param objects Vector of objects predicted.
-     * @param img_w Width of Image.
-     * @param img_h Height of Image.
-     */
-    static void decodeOutputs(const float* prob, std::vector<ArmorObject>& objects, Eigen::Matrix<float, 3, 3> &transform_matrix)
+    void initDecodeBuffer(DecodeBuffer& buffer)
     {
-        std::vector<ArmorObject> proposals;
+        // 网格只与输入尺寸有关，生成一次；解码缓冲区按全部anchor预分配
         std::vector<int> strides = {8, 16, 32};
-        std::vector<GridAndStride> grid_strides;
-
-        generate_grids_and_stride(INPUT_W, INPUT_H, strides, grid_strides);
-        generateYoloxProposals(grid_strides, prob, transform_matrix, BBOX_CONF_THRESH, proposals);
-        qsort_descent_inplace(proposals);
-        if (proposals.size() >= TOPK) 
-            proposals.resize(TOPK);
-        std::vector<int> picked;
-        nms_sorted_bboxes(proposals, picked, NMS_THRESH);
-        int count = picked.size();
-        objects.resize(count);
-        for (int i = 0; i < count; i++)
+        buffer.grid_strides.clear();
+        generate_grids_and_stride(INPUT_W, INPUT_H, strides, buffer.grid_strides);
+        const int num_anchors = buffer.grid_strides.size();
+        buffer.anchors.resize(num_anchors);
+        buffer.proposals.reserve(num_anchors);
+        buffer.order.reserve(num_anchors);
+        buffer.picked.reserve(TOPK);
+        for (auto* soa : {&buffer.box_x0, &buffer.box_y0, &buffer.box_x1, &buffer.box_y1, &buffer.box_area, &buffer.box_prob, &buffer.iou})
+            soa->reserve(TOPK);
+        buffer.box_label.reserve(TOPK);
+        buffer.suppress_masks.resize(TOPK * NMS_WORDS);
+        buffer.merge_masks.resize(TOPK * NMS_WORDS);
+    }
+
+    void decodeOutputs(const float* prob, DecodeBuffer& buffer, std::vector<ArmorObject>& objects, Eigen::Matrix<float, 3, 3> &transform_matrix)
+    {
+        const int num_anchors = buffer.grid_strides.size();
+        buffer.anchors.resize(num_anchors);
+
+        // 先按置信度预筛选，绝大多数anchor无需解码
+        int anchor_num = selectAboveThreshold(prob + 8, num_anchors, 9 + NUM_COLORS + NUM_CLASSES, BBOX_CONF_THRESH, buffer.anchors.data());
+        int count = generateYoloxProposals(buffer.grid_strides, prob, transform_matrix, buffer.anchors.data(), anchor_num, buffer.proposals);
+        topKSorted(buffer.proposals, count, buffer.order);
+        nmsBitmask(buffer, NMS_THRESH);
+
+        int picked_num = buffer.picked.size();
+        objects.resize(picked_num);
+        for (int i = 0; i < picked_num; i++)
+        {
+            ArmorObject& object = objects[i];
+            object = buffer.proposals[buffer.picked[i]];
+            //对候选框预测角点进行平均,降低误差
+            if (object.pts_num > 1)
+            {
+                for (int k = 0; k < 4; k++)
+                    object.apex[k] = object.pts_sum[k] / (float)object.pts_num;
+            }
+        }
+    }
+
+    void mergeObjects(DecodeBuffer& buffer, std::vector<ArmorObject>& objects)
+    {
+        int count = objects.size();
+        if (count <= 1)
+            return;
+
+        buffer.proposals.assign(objects.begin(), objects.end());
+        topKSorted(buffer.proposals, count, buffer.order);
+        // 各次推理的结果已各自完成合并平均，此处仅去重
+        nmsBitmask(buffer, NMS_THRESH, false);
+
+        int picked_num = buffer.picked.size();
+        objects.resize(picked_num);
+        for (int i = 0; i < picked_num; i++)
         {
-            objects[i] = proposals[picked[i]];
+            objects[i] = buffer.proposals[buffer.picked[i]];
         }
     }
 
@@ -322,6 +436,45 @@ namespace armor_detector
         return calcTriangleArea(&pts[0]) + calcTriangleArea(&pts[1]);
     }
 
+    std::string resolveModelPath(const std::string& path, bool use_int8, bool& is_int8)
+    {
+        // 量化模型仅在通过精度检查后才会生成，存在即可直接使用
+        is_int8 = false;
+        if (use_int8)
+        {
+            std::string int8_path = path.substr(0, path.find_last_of('.')) + "_int8.xml";
+            std::string int8_bin_path = path.substr(0, path.find_last_of('.')) + "_int8.bin";
+            if (std::ifstream(int8_path).good() && std::ifstream(int8_bin_path).good())
+            {
+                is_int8 = true;
+                return int8_path;
+            }
+        }
+        return path;
+    }
+
+    std::shared_ptr<ov::Model> readDetectorModel(ov::Core& core, const std::string& path)
+    {
+        std::shared_ptr<ov::Model> model = core.read_model(path);
+
+        // Preprocessing
+        // 输入为letterbox后的u8 NHWC BGR图像，转float与NHWC->NCHW由模型完成，
+        // CPU插件可将其与第一层卷积融合，主机端无需float中间缓冲
+        ov::preprocess::PrePostProcessor ppp(model);
+        ppp.input().tensor()
+            .set_element_type(ov::element::u8)
+            .set_layout("NHWC");
+        ppp.input().preprocess().convert_element_type(ov::element::f32);
+        ppp.input().model().set_layout("NCHW");
+
+        // Set output precision
+        ppp.output().tensor().set_element_type(ov::element::f32);
+        // ppp.output().tensor().set_element_type(ov::element::u8);
+        
+        //将预处理融入原始模型
+        return ppp.build();
+    }
+
     ArmorDetector::ArmorDetector()
     {
     }
@@ -330,7 +483,7 @@ namespace armor_detector
     {
     }
 
-    bool ArmorDetector::initModel(std::string path)
+    bool ArmorDetector::initModel(std::string path, std::string cache_dir, bool use_int8)
     {
         // for(auto &device : core.get_available_devices())
         // {
@@ -338,50 +491,51 @@ namespace armor_detector
         // }
         std::cout << "Start initialize model..." << std::endl;
 
+        path = resolveModelPath(path, use_int8, is_int8_);
+        std::cout << "Model: " << path << (is_int8_ ? " (INT8)" : "") << std::endl;
+
         // Setting Configuration Values
         core.set_property("CPU", ov::enable_profiling(true));
     
-        //Step 1.Create openvino runtime core
-        model = core.read_model(path);
-        // model = core.import_model();
+        auto st = std::chrono::steady_clock::now();
 
-        // Preprocessing
-        ov::preprocess::PrePostProcessor ppp(model);
-        ppp.input().tensor().set_element_type(ov::element::f32);
-        // ppp.input().tensor().set_element_type(ov::element::u8);
-
-        // Set output precision
-        ppp.output().tensor().set_element_type(ov::element::f32);
-        // ppp.output().tensor().set_element_type(ov::element::u8);
-        
-        //将预处理融入原始模型
-        ppp.build(); 
-
-        //Step 2. Compile the model
-        compiled_model = core.compile_model(
-            model,
+        //Step 1.Create openvino runtime core
+        // 读取模型并将预处理融入原始模型，仅在编译缓存未命中时执行
+        auto build_model = [this, &path]()
+        {
+            model = readDetectorModel(core, path);
+            return model;
+        };
+
+        //Step 2. Compile the model(或由缓存导入)
+        // 预处理及编译配置变化时需同步修改config_tag，使旧缓存失效
+        compiled_model = model_cache::compileModel(
+            core,
+            path,
+            cache_dir,
             "CPU",
-            ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)
+            "u8_nhwc|latency|profiling",
+            build_model,
+            {ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)},
+            &is_cache_hit_
             // "AUTO:GPU,CPU", 
-            // ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)
             // ov::hint::inference_precision(ov::element::u8)
         );
+        init_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count();
 
         // compiled_model.set_property(ov::device::priorities("GPU"));
 
-        // Save compiled model
-        // ofstream save_file("src/vehicle_system/autoaim/armor_detector/model/compiled_model.txt", ios::in | ios::binary);
-        // if (save_file)
-        // {
-        //     compiled_model.export_model(save_file);
-        // }
-
         // Async inference
         // infer_request.start_async()
         // infer_request.wait()
 
         // Step 3. Create an Inference Request
         infer_request = compiled_model.create_infer_request();
+        // 输入输出张量在推理请求创建时分配，缓存后逐帧直接使用，避免每帧获取张量对象的开销
+        input_tensor = infer_request.get_input_tensor(0);
+        output_tensor = infer_request.get_output_tensor();
+
+        initDecodeBuffer(decode_buffer_);
 
         // Fill Input Tensors with Data
         // get input tensor by index
@@ -410,104 +564,134 @@ namespace armor_detector
 
         return true;
     }
-
-    bool ArmorDetector::detect(cv::Mat &src, std::vector<ArmorObject>& objects)
+    /**
+     * @brief 以空输入推理若干次
+     * OpenVINO首次推理需分配内存、初始化线程池，提前完成可避免切换模式后的第一帧冷启动
+     * 
+     * @param iterations 推理次数
+     */
+    void ArmorDetector::warmUp(int iterations)
     {
-        if (src.empty())
+        memset(input_tensor.data(), 0, input_tensor.get_byte_size());
+        for (int ii = 0; ii < iterations; ++ii)
         {
-            return false;
+            if (service_)
+                service_->infer(input_tensor.data<uint8_t>(), output_tensor.data<float>());
+            else
+                infer_request.infer();
         }
 
-        cv::Mat pr_img = scaledResize(src, transfrom_matrix);
-        // dw = this->dw;
+        // 流水线各推理请求各自持有输入输出内存，同样需要预热
+        if (inflight_ != 0)
+            return;
+        for (auto& slot : slots_)
+        {
+            memset(slot->input_tensor.data(), 0, slot->input_tensor.get_byte_size());
+            slot->request.infer();
+        }
+    }
 
-        cv::Mat pre;
-        cv::Mat pre_split[3];
-        pr_img.convertTo(pre, CV_32F);
-        cv::split(pre, pre_split);
+    bool ArmorDetector::initService(std::shared_ptr<InferenceService> service)
+    {
+        if (!service)
+            return false;
 
-        // Get input tensor by index
-        input_tensor = infer_request.get_input_tensor(0);
-        
-        // 准备输入
-        infer_request.set_input_tensor(input_tensor);
+        initDecodeBuffer(decode_buffer_);
+        // 单帧输入输出张量由本地分配，推理时与服务的批张量之间拷贝
+        ov::Shape input_shape = {1, INPUT_H, INPUT_W, 3};
+        ov::Shape output_shape = {1, decode_buffer_.grid_strides.size(), 9 + NUM_COLORS + NUM_CLASSES};
+        if (ov::shape_size(input_shape) != service->inputSize() || ov::shape_size(output_shape) != service->outputSize())
+        {
+            std::cout << "Inference service shape mismatch: " << service->inputSize() << " " << service->outputSize() << std::endl;
+            return false;
+        }
+        input_tensor = ov::Tensor(ov::element::u8, input_shape);
+        output_tensor = ov::Tensor(ov::element::f32, output_shape);
+
+        service_ = service;
+        is_int8_ = service->is_int8_;
+        is_cache_hit_ = service->is_cache_hit_;
+        init_time_ = service->init_time_;
+        return true;
+    }
 
-        float* tensor_data = input_tensor.data<float_t>();
-        // u_int8_t* tensor_data = input_tensor.data<u_int8_t>();
+    bool ArmorDetector::setPipelineDepth(int depth)
+    {
+        drain();
+        slots_.clear();
+        head_ = 0;
+        if (depth <= 1)
+            return true;
+        if (service_)
+            return false;
 
-        auto img_offset = INPUT_H * INPUT_W;
-        // Copy img into tensor
-        for(int c = 0; c < 3; c++)
+        try
         {
-            memcpy(tensor_data, pre_split[c].data, INPUT_H * INPUT_W * sizeof(float));
-            // memcpy(tensor_data, pre_split[c].data, INPUT_H * INPUT_W * sizeof(u_int8_t));
-            tensor_data += img_offset;
+            for (int ii = 0; ii < depth; ++ii)
+            {
+                auto slot = std::make_unique<InferSlot>();
+                slot->request = compiled_model.create_infer_request();
+                slot->input_tensor = slot->request.get_input_tensor(0);
+                slot->output_tensor = slot->request.get_output_tensor();
+                InferSlot* slot_ptr = slot.get();
+                // 完成回调在推理线程中执行，仅记录完成时刻
+                slot->request.set_callback([slot_ptr](std::exception_ptr)
+                {
+                    slot_ptr->done_ns.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+                });
+                slots_.emplace_back(std::move(slot));
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << "Create infer requests failed: " << e.what() << std::endl;
+            slots_.clear();
+            return false;
         }
+        return true;
+    }
 
-        // ov::element::Type input_type = ov::element::f32;
-        // ov::Shape input_shape = {1, 3, 416, 416};
+    int ArmorDetector::pipelineDepth() const
+    {
+        return slots_.empty() ? 1 : (int)slots_.size();
+    }
 
-        // // std::shared_ptr<unsigned char> input_data_ptr = pre.data;
-        // auto input_data_ptr = pre.data;
+    int ArmorDetector::inflightNum() const
+    {
+        return inflight_;
+    }
 
-        // // 转换图像数据为ov::Tensor
-        // input_tensor = ov::Tensor(input_type, input_shape, input_data_ptr);
+    /**
+     * @brief 图像letterbox缩放后直接写入推理请求的u8 NHWC输入张量
+     */
+    void ArmorDetector::preprocess(cv::Mat &src, ov::Tensor& tensor, Eigen::Matrix<float, 3, 3>& transform_matrix)
+    {
+        // 以张量内存构造图像，缩放结果直接写入张量
+        cv::Mat tensor_img(INPUT_H, INPUT_W, CV_8UC3, tensor.data<uint8_t>());
 
-        // auto st = std::chrono::steady_clock::now();
-        // 推理
-        infer_request.infer();
-        // auto end = std::chrono::steady_clock::now();
-        // double infer_dt = std::chrono::duration<double,std::milli>(end - st).count();
-        // cout << "infer_time:" << infer_dt << endl;
-        
+        if (src.type() == CV_8UC1)
+        {   // 单通道输入为原始BayerBG8图像，去马赛克与缩放合并完成
+            scaledResizeBayer(src, tensor_img, transform_matrix);
+        }
+        else
+        {
+            letterboxToImage(src, tensor_img, transform_matrix);
+        }
+    }
+
+    /**
+     * @brief 解码推理请求的输出，并计算装甲板面积
+     */
+    bool ArmorDetector::postprocess(ov::Tensor& output_tensor, Eigen::Matrix<float, 3, 3>& transform_matrix, std::vector<ArmorObject>& objects)
+    {
         // 处理推理结果
-        ov::Tensor output_tensor = infer_request.get_output_tensor();
         float* output = output_tensor.data<float_t>();
-        // cout << "output:" << " ";
-        // for (int ii = 0; ii < 25; ii++)
-        // {
-        //     cout << output[ii] << " ";
-        // }
-        // cout << endl;
         // u_int8_t* output = output_tensor.data<u_int8_t>();
-        // std::cout << &output << std::endl;
 
-        // int img_w = src.cols;
-        // int img_h = src.rows;
-        decodeOutputs(output, objects, transfrom_matrix);
+        decodeOutputs(output, decode_buffer_, objects, transform_matrix);
+        // 合并候选框的角点平均已在解码时完成
         for (auto object = objects.begin(); object != objects.end(); ++object)
         {
-            //对候选框预测角点进行平均,降低误差
-            if ((*object).pts.size() >= 8)
-            {
-                auto N = (*object).pts.size();
-                cv::Point2f pts_final[4];
-                for (int i = 0; i < (int)N; i++)
-                {
-                    pts_final[i % 4] += (*object).pts[i];
-                }
-
-                for (int i = 0; i < 4; i++)
-                {
-                    pts_final[i].x = pts_final[i].x / (N / 4);
-                    pts_final[i].y = pts_final[i].y / (N / 4);
-                }
-
-                (*object).apex[0] = pts_final[0];
-                (*object).apex[1] = pts_final[1];
-                (*object).apex[2] = pts_final[2];
-                (*object).apex[3] = pts_final[3];
-            }
-            // cv::Point2f pts_final[4];
-            // for(int ii = 0; ii < 4; ii++)
-            // {
-            //     pts_final[ii] = (*object).pts[ii];
-            // }
-            // (*object).apex[0] = pts_final[0];
-            // (*object).apex[1] = pts_final[1];
-            // (*object).apex[2] = pts_final[2];
-            // (*object).apex[3] = pts_final[3];
-
             // cout << "output:";
             // for (int i = 0; i < 4; i++)
             // {
@@ -524,6 +708,198 @@ namespace armor_detector
             return false;
     }
 
+    bool ArmorDetector::detect(cv::Mat &src, std::vector<ArmorObject>& objects)
+    {
+        if (src.empty())
+        {
+            return false;
+        }
+
+        auto st = std::chrono::steady_clock::now();
+        preprocess(src, input_tensor, transfrom_matrix);
+        auto infer_st = std::chrono::steady_clock::now();
+
+        // 推理
+        if (service_)
+        {
+            if (!service_->infer(input_tensor.data<uint8_t>(), output_tensor.data<float>()))
+            {
+                objects.clear();
+                return false;
+            }
+        }
+        else
+        {
+            infer_request.infer();
+        }
+        auto infer_end = std::chrono::steady_clock::now();
+
+        bool is_detected = postprocess(output_tensor, transfrom_matrix, objects);
+        auto end = std::chrono::steady_clock::now();
+
+        timing_.preprocess = std::chrono::duration<double, std::milli>(infer_st - st).count();
+        timing_.infer = std::chrono::duration<double, std::milli>(infer_end - infer_st).count();
+        timing_.wait = timing_.infer;
+        timing_.decode = std::chrono::duration<double, std::milli>(end - infer_end).count();
+        return is_detected;
+    }
+
+    bool ArmorDetector::submit(cv::Mat &src)
+    {
+        if (src.empty() || slots_.empty() || inflight_ >= (int)slots_.size())
+        {
+            return false;
+        }
+
+        InferSlot& slot = *slots_[(head_ + inflight_) % slots_.size()];
+        auto st = std::chrono::steady_clock::now();
+        preprocess(src, slot.input_tensor, slot.transform_matrix);
+        slot.submit_time = std::chrono::steady_clock::now();
+        slot.done_ns.store(0, std::memory_order_relaxed);
+        slot.request.start_async();
+        ++inflight_;
+
+        timing_.preprocess = std::chrono::duration<double, std::milli>(slot.submit_time - st).count();
+        return true;
+    }
+
+    bool ArmorDetector::fetch(std::vector<ArmorObject>& objects)
+    {
+        if (inflight_ == 0)
+        {
+            return false;
+        }
+
+        InferSlot& slot = *slots_[head_];
+        auto st = std::chrono::steady_clock::now();
+        slot.request.wait();
+        auto wait_end = std::chrono::steady_clock::now();
+        head_ = (head_ + 1) % slots_.size();
+        --inflight_;
+
+        bool is_detected = postprocess(slot.output_tensor, slot.transform_matrix, objects);
+        auto end = std::chrono::steady_clock::now();
+
+        // 完成回调可能晚于wait返回，此时以wait返回时刻近似
+        int64_t done_ns = slot.done_ns.load(std::memory_order_acquire);
+        auto done_time = (done_ns != 0) ? std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(done_ns)) : wait_end;
+        timing_.infer = std::chrono::duration<double, std::milli>(done_time - slot.submit_time).count();
+        timing_.wait = std::chrono::duration<double, std::milli>(wait_end - st).count();
+        timing_.decode = std::chrono::duration<double, std::milli>(end - wait_end).count();
+        return is_detected;
+    }
+
+    bool ArmorDetector::detectTiles(cv::Mat &src, const std::vector<cv::Rect>& tiles, std::vector<ArmorObject>& objects)
+    {
+        objects.clear();
+        if (src.empty())
+        {
+            return false;
+        }
+        if (service_)
+        {
+            return detect(src, objects);
+        }
+
+        // 推理请求按需创建，之后复用
+        const int num = tiles.size() + 1;
+        try
+        {
+            while ((int)tile_slots_.size() < num)
+            {
+                auto slot = std::make_unique<InferSlot>();
+                slot->request = compiled_model.create_infer_request();
+                slot->input_tensor = slot->request.get_input_tensor(0);
+                slot->output_tensor = slot->request.get_output_tensor();
+                tile_slots_.emplace_back(std::move(slot));
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << "Create infer requests failed: " << e.what() << std::endl;
+            return detect(src, objects);
+        }
+
+        auto st = std::chrono::steady_clock::now();
+        cv::Rect img_rect(0, 0, src.cols, src.rows);
+        std::vector<cv::Rect> regions(num, img_rect);
+        for (int ii = 1; ii < num; ++ii)
+        {
+            regions[ii] = tiles[ii - 1] & img_rect;
+        }
+
+        double preprocess_time = 0.0;
+        for (int ii = 0; ii < num; ++ii)
+        {
+            InferSlot& slot = *tile_slots_[ii];
+            if (regions[ii].area() == 0)
+                continue;
+
+            auto pre_st = std::chrono::steady_clock::now();
+            // 分块为原图的视图，不拷贝
+            cv::Mat region_img = src(regions[ii]);
+            preprocess(region_img, slot.input_tensor, slot.transform_matrix);
+            // 分块坐标平移回原图
+            slot.transform_matrix(0, 2) += regions[ii].x;
+            slot.transform_matrix(1, 2) += regions[ii].y;
+            slot.submit_time = std::chrono::steady_clock::now();
+            preprocess_time += std::chrono::duration<double, std::milli>(slot.submit_time - pre_st).count();
+            slot.request.start_async();
+        }
+
+        double wait_time = 0.0;
+        double decode_time = 0.0;
+        const float margin = 2.0f;
+        for (int ii = 0; ii < num; ++ii)
+        {
+            InferSlot& slot = *tile_slots_[ii];
+            if (regions[ii].area() == 0)
+                continue;
+
+            auto slot_st = std::chrono::steady_clock::now();
+            slot.request.wait();
+            auto slot_wait_end = std::chrono::steady_clock::now();
+            postprocess(slot.output_tensor, slot.transform_matrix, tile_objects_);
+
+            const cv::Rect& region = regions[ii];
+            for (const auto& object : tile_objects_)
+            {
+                if (ii > 0)
+                {   // 丢弃被分块边缘截断的目标(分块边缘与图像边缘重合时除外)
+                    const cv::Rect_<float>& rect = object.rect;
+                    if ((region.x > 0 && rect.x < region.x + margin) ||
+                        (region.y > 0 && rect.y < region.y + margin) ||
+                        (region.br().x < src.cols && rect.br().x > region.br().x - margin) ||
+                        (region.br().y < src.rows && rect.br().y > region.br().y - margin))
+                        continue;
+                }
+                objects.push_back(object);
+            }
+            wait_time += std::chrono::duration<double, std::milli>(slot_wait_end - slot_st).count();
+            decode_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot_wait_end).count();
+        }
+
+        auto merge_st = std::chrono::steady_clock::now();
+        mergeObjects(decode_buffer_, objects);
+        auto end = std::chrono::steady_clock::now();
+
+        timing_.preprocess = preprocess_time;
+        timing_.infer = std::chrono::duration<double, std::milli>(end - st).count() - preprocess_time - decode_time;
+        timing_.wait = wait_time;
+        timing_.decode = decode_time + std::chrono::duration<double, std::milli>(end - merge_st).count();
+        return !objects.empty();
+    }
+
+    void ArmorDetector::drain()
+    {
+        while (inflight_ > 0)
+        {
+            slots_[head_]->request.wait();
+            head_ = (head_ + 1) % slots_.size();
+            --inflight_;
+        }
+    }
+
 } //namespace armor_detector
 
 
@@ -0,0 +1,278 @@
+/*
+ * @Description: This is a ros-based project!
+ * @Author: Liu Biao
+ * @Date: 2023-06-26 21:12:40
+ * @LastEditTime: 2023-06-26 21:12:40
+ * @FilePath: /TUP-Vision-2023-Based/src/vehicle_system/autoaim/armor_detector/src/inference/inference_service.cpp
+ */
+#include "../../include/inference/inference_service.hpp"
+#include "../../include/inference/inference_api2.hpp"
+
+namespace armor_detector
+{
+    std::shared_ptr<InferenceService> InferenceService::acquire(const std::string& path, const InferServiceParam& param)
+    {
+        static std::mutex registry_mutex;
+        static std::map<std::string, std::weak_ptr<InferenceService>> registry;
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        auto service = registry[path].lock();
+        if (!service)
+        {
+            service.reset(new InferenceService());
+            if (!service->init(path, param))
+                return nullptr;
+            registry[path] = service;
+        }
+        else if (std::max(1, param.max_batch) != service->param_.max_batch || param.max_wait != service->param_.max_wait)
+        {
+            std::cout << "Inference service for " << path << " already created with max batch " << service->param_.max_batch
+                << ", max wait " << service->param_.max_wait << "ms, ignoring requested max batch " << param.max_batch
+                << ", max wait " << param.max_wait << "ms" << std::endl;
+        }
+
+        // 返回与服务共享对象的客户端指针，释放时注销客户端，服务随最后一个客户端析构
+        service->addClient();
+        return std::shared_ptr<InferenceService>(service.get(), [service](InferenceService* ptr) mutable
+        {
+            ptr->removeClient();
+            service.reset();
+        });
+    }
+
+    InferenceService::~InferenceService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_running_ = false;
+        }
+        queue_cond_.notify_all();
+        if (batch_thread_.joinable())
+            batch_thread_.join();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 等待在途批次完成回调
+        slot_cond_.wait(lock, [this]()
+        {
+            for (auto& slot : slots_)
+            {
+                if (slot->is_busy)
+                    return false;
+            }
+            return true;
+        });
+        for (auto job : queue_)
+            job->done.set_value(false);
+        queue_.clear();
+    }
+
+    bool InferenceService::init(const std::string& path, const InferServiceParam& param)
+    {
+        param_ = param;
+        param_.max_batch = std::max(1, param_.max_batch);
+        std::string model_path = resolveModelPath(path, param_.use_int8, is_int8_);
+        std::cout << "Inference service model: " << model_path << (is_int8_ ? " (INT8)" : "") << std::endl;
+
+        auto st = std::chrono::steady_clock::now();
+        try
+        {
+            // 预处理与ArmorDetector一致，批维度改为[1, max_batch]
+            auto build_model = [this, &model_path]()
+            {
+                std::shared_ptr<ov::Model> model = readDetectorModel(core_, model_path);
+                ov::PartialShape input_shape = model->input().get_partial_shape();
+                input_shape[0] = ov::Dimension(1, param_.max_batch);
+                model->reshape(input_shape);
+                return model;
+            };
+
+            ov::AnyMap config = {ov::hint::performance_mode(ov::hint::PerformanceMode::THROUGHPUT)};
+            if (param_.num_streams > 0)
+                config.emplace(ov::num_streams(param_.num_streams));
+            compiled_model_ = model_cache::compileModel(
+                core_,
+                model_path,
+                param_.cache_dir,
+                "CPU",
+                "u8_nhwc|throughput|batch" + std::to_string(param_.max_batch) + "|streams" + std::to_string(param_.num_streams),
+                build_model,
+                config,
+                &is_cache_hit_
+            );
+
+            // 单帧输入输出尺寸(去除批维度)
+            ov::PartialShape input_shape = compiled_model_.input().get_partial_shape();
+            ov::PartialShape output_shape = compiled_model_.output().get_partial_shape();
+            frame_shape_.clear();
+            input_size_ = 1;
+            for (size_t ii = 1; ii < input_shape.size(); ++ii)
+            {
+                frame_shape_.emplace_back(input_shape[ii].get_length());
+                input_size_ *= input_shape[ii].get_length();
+            }
+            output_size_ = 1;
+            for (size_t ii = 1; ii < output_shape.size(); ++ii)
+                output_size_ *= output_shape[ii].get_length();
+
+            // 推理请求数与推理流数一致，各流并行执行不同批次
+            num_requests_ = std::max(1u, compiled_model_.get_property(ov::optimal_number_of_infer_requests));
+            ov::Shape batch_shape = {(size_t)param_.max_batch};
+            batch_shape.insert(batch_shape.end(), frame_shape_.begin(), frame_shape_.end());
+            for (int ii = 0; ii < num_requests_; ++ii)
+            {
+                auto slot = std::make_unique<BatchSlot>();
+                slot->request = compiled_model_.create_infer_request();
+                slot->input_tensor = ov::Tensor(ov::element::u8, batch_shape);
+                slot->jobs.reserve(param_.max_batch);
+                BatchSlot* slot_ptr = slot.get();
+                // 完成回调在推理线程中执行：拷贝各帧输出并唤醒提交线程
+                slot->request.set_callback([this, slot_ptr](std::exception_ptr ex)
+                {
+                    bool is_ok = (ex == nullptr);
+                    if (is_ok)
+                    {
+                        const float* output = slot_ptr->request.get_output_tensor().data<float>();
+                        for (size_t jj = 0; jj < slot_ptr->jobs.size(); ++jj)
+                            std::copy(output + jj * output_size_, output + (jj + 1) * output_size_, slot_ptr->jobs[jj]->output);
+                    }
+                    // 先于唤醒提交线程扣除在途帧，避免其下一帧按过期计数提前组批
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        inflight_jobs_ -= (int)slot_ptr->jobs.size();
+                    }
+                    for (auto job : slot_ptr->jobs)
+                        job->done.set_value(is_ok);
+                    slot_ptr->jobs.clear();
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    slot_ptr->is_busy = false;
+                    slot_cond_.notify_one();
+                });
+                slots_.emplace_back(std::move(slot));
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << "Initialize inference service failed: " << e.what() << std::endl;
+            return false;
+        }
+        init_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count();
+        std::cout << "Inference service " << (is_cache_hit_ ? "imported from cache" : "compiled") << " in " << init_time_ << "ms, "
+            << num_requests_ << " requests, max batch " << param_.max_batch << std::endl;
+
+        is_running_ = true;
+        batch_thread_ = std::thread(&InferenceService::run, this);
+        return true;
+    }
+
+    void InferenceService::addClient()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++num_clients_;
+    }
+
+    void InferenceService::removeClient()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --num_clients_;
+        }
+        // 客户端减少后排队帧可能已满足立即组批条件
+        queue_cond_.notify_one();
+    }
+
+    bool InferenceService::infer(const uint8_t* input, float* output)
+    {
+        Job job;
+        job.input = input;
+        job.output = output;
+        job.submit_time = std::chrono::steady_clock::now();
+        std::future<bool> result = job.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!is_running_)
+                return false;
+            queue_.push_back(&job);
+        }
+        queue_cond_.notify_one();
+        return result.get();
+    }
+
+    /**
+     * @brief 组批线程：凑满max_batch、所有客户端的帧均已排队或在途，或最早一帧等待超过max_wait后取出一批，
+     * 交给空闲推理请求异步执行
+     */
+    void InferenceService::run()
+    {
+        auto max_wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(param_.max_wait));
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            queue_cond_.wait(lock, [this]() { return !is_running_ || !queue_.empty(); });
+            if (!is_running_)
+                break;
+
+            // 最早一帧到期前继续等待后续帧，其余客户端均无帧可提交时不再等待
+            auto deadline = queue_.front()->submit_time + max_wait;
+            queue_cond_.wait_until(lock, deadline, [this]()
+            {
+                int num = queue_.size();
+                return !is_running_ || num >= param_.max_batch || num + inflight_jobs_ >= num_clients_;
+            });
+            if (!is_running_)
+                break;
+
+            // 等待空闲推理请求，期间到达的帧一并组批
+            BatchSlot* slot = nullptr;
+            slot_cond_.wait(lock, [this, &slot]()
+            {
+                for (auto& candidate : slots_)
+                {
+                    if (!candidate->is_busy)
+                    {
+                        slot = candidate.get();
+                        return true;
+                    }
+                }
+                return false;
+            });
+
+            int batch = std::min((int)queue_.size(), param_.max_batch);
+            for (int ii = 0; ii < batch; ++ii)
+            {
+                slot->jobs.push_back(queue_.front());
+                queue_.pop_front();
+            }
+            slot->is_busy = true;
+            inflight_jobs_ += batch;
+            ++batch_cnt_;
+            frame_cnt_ += batch;
+            lock.unlock();
+
+            uint8_t* batch_input = slot->input_tensor.data<uint8_t>();
+            for (int ii = 0; ii < batch; ++ii)
+                std::copy(slot->jobs[ii]->input, slot->jobs[ii]->input + input_size_, batch_input + ii * input_size_);
+
+            ov::Shape shape = {(size_t)batch};
+            shape.insert(shape.end(), frame_shape_.begin(), frame_shape_.end());
+            try
+            {
+                // 以批张量内存的前batch帧作为本次输入
+                slot->request.set_input_tensor(ov::Tensor(ov::element::u8, shape, batch_input));
+                slot->request.start_async();
+            }
+            catch(const std::exception& e)
+            {
+                std::cout << "Batch inference failed: " << e.what() << std::endl;
+                lock.lock();
+                inflight_jobs_ -= (int)slot->jobs.size();
+                for (auto job : slot->jobs)
+                    job->done.set_value(false);
+                slot->jobs.clear();
+                slot->is_busy = false;
+                continue;
+            }
+            lock.lock();
+        }
+    }
+} //namespace armor_detector
@@ -77,6 +77,7 @@ namespace buff_detector
     {
         string camera_name;
         string network_path;
+        string model_cache_path;    //编译模型缓存目录，为空时不缓存
         string camera_param_path;
         string path_prefix;
 
@@ -84,6 +85,7 @@ namespace buff_detector
         {
             camera_name = "KE0200110075";
             network_path = "src/vehicle_system/buff/model/buff.xml";
+            model_cache_path = "";
             camera_param_path = "src/global_user/config/camera.yaml";
             path_prefix = "src/recorder/buff_dataset";
         }
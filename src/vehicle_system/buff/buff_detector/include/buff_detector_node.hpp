@@ -64,9 +64,14 @@ namespace buff_detector
         rclcpp::Subscription<SerialMsg>::SharedPtr serial_msg_sub_;
         void sensorMsgCallback(const SerialMsg& serial_msg);
 
+        // 模型保温
+        int keep_warm_interval_;
+        int64_t last_infer_ns_;
+        void keepWarm();
+
         // Buff msgs pub.
         rclcpp::Publisher<BuffMsg>::SharedPtr buff_msg_pub_; 
-        int mode_ = 1;
+        atomic<int> mode_ = 1;
 
         Eigen::Vector3d last_center3d_ = {0.0, 0.0, 0.0};
         Eigen::Vector3d last_point3d_cam_ = {0.0, 0.0, 0.0};
@@ -9,6 +9,7 @@
 #define INFERENCE_API2_HPP_
 
 //C++
+#include <chrono>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -25,6 +26,8 @@
 // #include <fmt/color.h>
 
 #include "../../global_user/include/global_user/global_user.hpp"
+#include "../../global_user/include/global_user/preprocess.hpp"
+#include "../../global_user/include/global_user/model_cache.hpp"
 
 using namespace global_user;
 namespace buff_detector
@@ -41,7 +44,17 @@ namespace buff_detector
         ~BuffDetector();
         
         bool detect(cv::Mat &src, std::vector<BuffObject>& objects);
-        bool initModel(std::string path);
+        /**
+         * @brief 初始化模型
+         * 
+         * @param path 模型xml路径
+         * @param cache_dir 编译模型缓存目录，为空时不缓存(每次启动重新编译)
+         */
+        bool initModel(std::string path, std::string cache_dir = "");
+        void warmUp(int iterations = 1);
+
+        bool is_cache_hit_ = false; //本次启动是否由缓存导入
+        double init_time_ = 0.0;    //模型初始化耗时(ms)
     private:
         int dw, dh;
         float rescale_ratio;
@@ -28,11 +28,23 @@ namespace buff_detector
         if (!detector_->is_initialized_)
         {
             RCLCPP_INFO(this->get_logger(), "Initializing detector class");
-            detector_->buff_detector_.initModel(path_param_.network_path);
+            detector_->buff_detector_.initModel(path_param_.network_path, path_param_.model_cache_path);
+            RCLCPP_WARN(
+                this->get_logger(),
+                "Model %s in %.1fms",
+                detector_->buff_detector_.is_cache_hit_ ? "imported from cache" : "compiled",
+                detector_->buff_detector_.init_time_
+            );
             detector_->coordsolver_.loadParam(path_param_.camera_param_path, path_param_.camera_name);
             detector_->is_initialized_ = true;
         }
 
+        // 启动时预热模型，非能量机关模式下低频推理保温
+        int warmup_iterations = this->declare_parameter<int>("warmup_iterations", 3);
+        keep_warm_interval_ = this->declare_parameter<int>("keep_warm_interval", 1000);
+        detector_->buff_detector_.warmUp(warmup_iterations);
+        last_infer_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
         // QoS    
         rclcpp::QoS qos(0);
         qos.keep_last(5);
@@ -101,6 +113,25 @@ namespace buff_detector
         return;
     }
     
+    /**
+     * @brief 非当前模式时按keep_warm_interval低频推理一次，保持模型处于热状态，
+     * 模式切换后第一帧即可按正常耗时完成检测
+     */
+    void BuffDetectorNode::keepWarm()
+    {
+        if (keep_warm_interval_ <= 0)
+            return;
+
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (now_ns - last_infer_ns_ < (int64_t)keep_warm_interval_ * 1000000)
+            return;
+
+        param_mutex_.lock();
+        detector_->buff_detector_.warmUp(1);
+        param_mutex_.unlock();
+        last_infer_ns_ = now_ns;
+    }
+
     void BuffDetectorNode::imageCallback(const sensor_msgs::msg::Image::ConstSharedPtr &img_msg)
     {   
         RCLCPP_INFO_THROTTLE(
@@ -108,11 +139,17 @@ namespace buff_detector
             *this->get_clock(),
             100, 
             "buff_mode: %d",
-            mode_
+            mode_.load()
         );
 
         if (!img_msg || (mode_ != SMALL_BUFF && mode_ != BIG_BUFF))
+        {
+            if (img_msg)
+            {
+                keepWarm();
+            }
             return;
+        }
         
         TaskData src;
         auto img = cv_bridge::toCvShare(img_msg, "bgr8")->image;
@@ -204,6 +241,7 @@ namespace buff_detector
             last_point3d_world_ = {0.0, 0.0, 0.0};
         }
         param_mutex_.unlock();
+        last_infer_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
         
         // Publish buff msg.
         buff_msg.header.frame_id = "gimbal_link2";
@@ -260,6 +298,7 @@ namespace buff_detector
         this->declare_parameter<std::string>("camera_name", "KE0200110075");
         this->declare_parameter<std::string>("camera_param_path", "/config/camera.yaml");
         this->declare_parameter<std::string>("network_path", "/model/buff.xml");
+        this->declare_parameter<std::string>("model_cache_path", "/model/cache");
         this->declare_parameter<std::string>("path_prefix", "/recorder/buff_dataset/");
         
         string pkg_share_pth[3] = 
@@ -271,6 +310,8 @@ namespace buff_detector
         this->path_param_.camera_name = this->get_parameter("camera_name").as_string();
         this->path_param_.camera_param_path = pkg_share_pth[0] + this->get_parameter("camera_param_path").as_string();
         this->path_param_.network_path = pkg_share_pth[1] + this->get_parameter("network_path").as_string();
+        std::string model_cache_path = this->get_parameter("model_cache_path").as_string();
+        this->path_param_.model_cache_path = model_cache_path.empty() ? "" : pkg_share_pth[1] + model_cache_path;
         this->path_param_.path_prefix = pkg_share_pth[2] + this->get_parameter("path_prefix").as_string();
 
         this->declare_parameter<bool>("use_imu", false);
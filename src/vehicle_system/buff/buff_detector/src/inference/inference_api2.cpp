@@ -34,36 +34,6 @@ namespace buff_detector
         return max_arg;
     }
 
-    /**
-     * @brief Resize the image using letterbox
-     * @param img Image before resize
-     * @param transform_matrix Transform Matrix of Resize
-     * @return Image after resize
-     */
-    inline cv::Mat scaledResize(cv::Mat& img, Eigen::Matrix<float,3,3> &transform_matrix)
-    {
-        float r = std::min(INPUT_W / (img.cols * 1.0), INPUT_H / (img.rows * 1.0));
-        int unpad_w = r * img.cols;
-        int unpad_h = r * img.rows;
-        
-        int dw = INPUT_W - unpad_w;
-        int dh = INPUT_H - unpad_h;
-
-        dw /= 2;
-        dh /= 2;
-        
-        transform_matrix << 1.0 / r, 0, -dw / r,
-                            0, 1.0 / r, -dh / r,
-                            0, 0, 1;
-        
-        cv::Mat re;
-        cv::resize(img, re, cv::Size(unpad_w,unpad_h));
-        cv::Mat out;
-        cv::copyMakeBorder(re, out, dh, dh, dw, dw, cv::BORDER_CONSTANT);
-
-        return out;
-    }
-
     /**
      * @brief Generate grids and stride.
      * @param target_w Width of input.
@@ -354,7 +324,7 @@ namespace buff_detector
     {
     }
 
-    bool BuffDetector::initModel(std::string path)
+    bool BuffDetector::initModel(std::string path, std::string cache_dir)
     {
         // for(auto &device : core.get_available_devices())
         // {
@@ -368,28 +338,46 @@ namespace buff_detector
         // Setting Configuration Values.
         core.set_property("CPU", ov::enable_profiling(true));
 
-        // Step 1.Create openvino runtime core
-        model = core.read_model(path);
-
-        // Preprocessing.
-        ov::preprocess::PrePostProcessor ppp(model);
-        ppp.input().tensor().set_element_type(ov::element::f32);
+        auto st = std::chrono::steady_clock::now();
 
-        // set output precision.
-        ppp.output().tensor().set_element_type(ov::element::f32);
-        
-        // 将预处理融入原始模型.
-        ppp.build(); 
-
-        // Step 2. Compile the model
-        compiled_model = core.compile_model(
-            model,
+        // Step 1.Create openvino runtime core
+        // 读取模型并将预处理融入原始模型，仅在编译缓存未命中时执行.
+        auto build_model = [this, &path]()
+        {
+            model = core.read_model(path);
+
+            // Preprocessing.
+            // 输入为letterbox后的u8 NHWC BGR图像，转float与NHWC->NCHW由模型完成.
+            ov::preprocess::PrePostProcessor ppp(model);
+            ppp.input().tensor()
+                .set_element_type(ov::element::u8)
+                .set_layout("NHWC");
+            ppp.input().preprocess().convert_element_type(ov::element::f32);
+            ppp.input().model().set_layout("NCHW");
+
+            // set output precision.
+            ppp.output().tensor().set_element_type(ov::element::f32);
+            
+            // 将预处理融入原始模型.
+            model = ppp.build();
+            return model;
+        };
+
+        // Step 2. Compile the model(或由缓存导入).
+        // 预处理及编译配置变化时需同步修改config_tag，使旧缓存失效.
+        compiled_model = model_cache::compileModel(
+            core,
+            path,
+            cache_dir,
             "CPU",
-            ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)
+            "u8_nhwc|latency|profiling",
+            build_model,
+            {ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)},
+            &is_cache_hit_
             // "AUTO:GPU,CPU", 
-            // ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)
             // ov::hint::inference_precision(ov::element::u8)
             );
+        init_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - st).count();
 
         // compiled_model.set_property(ov::device::priorities("GPU"));
 
@@ -424,6 +412,22 @@ namespace buff_detector
         return true;
     }
 
+    /**
+     * @brief 以空输入推理若干次
+     * OpenVINO首次推理需分配内存、初始化线程池，提前完成可避免切换模式后的第一帧冷启动
+     * 
+     * @param iterations 推理次数
+     */
+    void BuffDetector::warmUp(int iterations)
+    {
+        ov::Tensor tensor = infer_request.get_input_tensor(0);
+        memset(tensor.data(), 0, tensor.get_byte_size());
+        for (int ii = 0; ii < iterations; ++ii)
+        {
+            infer_request.infer();
+        }
+    }
+
     bool BuffDetector::detect(cv::Mat &src, std::vector<BuffObject>& objects)
     {
         if (src.empty())
@@ -433,33 +437,12 @@ namespace buff_detector
         }
         // cout << 123 << endl;
         
-        cv::Mat pr_img = scaledResize(src, transfrom_matrix);
-        // dw = this->dw;
-
-        cv::Mat pre;
-        cv::Mat pre_split[3];
-        pr_img.convertTo(pre, CV_32F);
-        cv::split(pre, pre_split);
-
-        // cout << 789 << endl;
-
         // Get input tensor by index
         input_tensor = infer_request.get_input_tensor(0);
-        
-        // 准备输入
-        infer_request.set_input_tensor(input_tensor);
 
-        // cout << 000 << endl;
-
-        float* tensor_data = input_tensor.data<float_t>();
-        
-        auto img_offset = INPUT_H * INPUT_W;
-        // Copy img into tensor
-        for(int c = 0; c < 3; c++)
-        {
-            memcpy(tensor_data, pre_split[c].data, INPUT_H * INPUT_W * sizeof(float));
-            tensor_data += img_offset;
-        }
+        // 以张量内存构造图像，letterbox缩放结果直接写入u8 NHWC输入张量
+        cv::Mat tensor_img(INPUT_H, INPUT_W, CV_8UC3, input_tensor.data<uint8_t>());
+        letterboxToImage(src, tensor_img, transfrom_matrix);
 
         // cout << 345 << endl;
 